@@ -0,0 +1,247 @@
+/*** bdcal.c -- business day calendars
+ *
+ * Copyright (C) 2020 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of echse.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bdcal.h"
+#include "evstrm.h"
+#include "scale.h"
+#include "nifty.h"
+
+/* compiled years per calendar, direct-mapped */
+#define NYEARS	(64U)
+
+#define MSECS_PER_DAY	(86400000LL)
+
+struct bdcal_s {
+	obint_t cal;
+	/* the holidays, NULL for weekends only */
+	echs_evstrm_t hol;
+	/* whether a year is being compiled, to break cycles */
+	bool busyp;
+	/* year tags, 0 for empty slots */
+	unsigned int y[NYEARS];
+	bitset383_t bd[NYEARS];
+};
+
+static struct bdcal_s **cals;
+static size_t ncals;
+static size_t zcals;
+/* file relative calendar names are taken relative to */
+static const char *ref;
+
+
+static inline unsigned int
+pack_md(unsigned int m, unsigned int d)
+{
+	return (m - 1U) * 32U + d;
+}
+
+static unsigned int
+get_ndom(unsigned int y, unsigned int m)
+{
+	static const uint8_t mdays[] = {
+		0U, 31U, 28U, 31U, 30U, 31U, 30U, 31U, 31U, 30U, 31U, 30U, 31U,
+	};
+	return mdays[m] + (m == 2U && !(y % 4U) && (y % 100U || !(y % 400U)));
+}
+
+static void
+unmark(bitset383_t *restrict bd, unsigned int y, echs_event_t e)
+{
+/* remove the days covered by E from BD */
+	unsigned int ey = e.from.y;
+	unsigned int em = e.from.m;
+	unsigned int ed = e.from.d;
+	/* all-day events span full days, others cover their first day */
+	size_t nd = e.dur.d / MSECS_PER_DAY ?: 1U;
+
+	for (; nd > 0U && ey <= y; nd--) {
+		if (ey == y) {
+			bs383_clr(bd, pack_md(em, ed));
+		}
+		if (++ed > get_ndom(ey, em)) {
+			ed = 1U;
+			if (++em > 12U) {
+				em = 1U;
+				ey++;
+			}
+		}
+	}
+	return;
+}
+
+static void
+comp_year(bitset383_t *restrict bd, echs_evstrm_t hol, unsigned int y)
+{
+	memset(bd, 0, sizeof(*bd));
+	for (unsigned int m = 1U; m <= 12U; m++) {
+		const unsigned int nd = get_ndom(y, m);
+		echs_wday_t w = echs_scale_wday(SCALE_GREGORIAN, y, m, 1U);
+
+		for (unsigned int d = 1U; d <= nd; d++, w = (echs_wday_t)(w % 7U + 1U)) {
+			if (w < SAT) {
+				bs383_set(bd, pack_md(m, d));
+			}
+		}
+	}
+	if (hol != NULL) {
+		/* start a month early to catch holidays spanning new year */
+		const echs_instant_t from = {
+			.y = y - 1U, .m = 12U, .d = 1U, .H = ECHS_ALL_DAY
+		};
+		echs_evstrm_t s = clone_echs_evstrm(hol);
+		echs_event_t e;
+
+		if (UNLIKELY(s == NULL)) {
+			return;
+		}
+		echs_evstrm_seek(s, from);
+		while (!echs_event_0_p(e = echs_evstrm_pop(s)) &&
+		       e.from.y <= y) {
+			unmark(bd, y, e);
+		}
+		free_echs_evstrm(s);
+	}
+	return;
+}
+
+static struct bdcal_s*
+get_cal(obint_t cal)
+{
+	struct bdcal_s *c;
+
+	for (size_t i = 0U; i < ncals; i++) {
+		if (cals[i]->cal == cal) {
+			return cals[i];
+		}
+	}
+	/* load him */
+	if (UNLIKELY(ncals >= zcals)) {
+		const size_t nuz = (zcals ?: 4U) * 2U;
+		struct bdcal_s **nu = realloc(cals, nuz * sizeof(*cals));
+
+		if (UNLIKELY(nu == NULL)) {
+			return NULL;
+		}
+		cals = nu;
+		zcals = nuz;
+	}
+	if (UNLIKELY((c = calloc(1U, sizeof(*c))) == NULL)) {
+		return NULL;
+	}
+	c->cal = cal;
+	if (cal) {
+		/* if this fails we're weekends only */
+		c->hol = make_echs_evstrm_from_file(obint_name(cal));
+	}
+	return cals[ncals++] = c;
+}
+
+
+const bitset383_t*
+echs_bdcal_year(obint_t cal, unsigned int y)
+{
+	struct bdcal_s *c;
+	size_t k = y % NYEARS;
+
+	if (UNLIKELY((c = get_cal(cal)) == NULL)) {
+		return NULL;
+	} else if (UNLIKELY(c->busyp)) {
+		/* CAL's holidays depend on CAL, weekends only then */
+		return echs_bdcal_year(0U, y);
+	} else if (c->y[k] != y) {
+		c->busyp = true;
+		comp_year(c->bd + k, c->hol, y);
+		c->busyp = false;
+		c->y[k] = y;
+	}
+	return c->bd + k;
+}
+
+const char*
+echs_bdcal_ref(const char *fn)
+{
+	const char *old = ref;
+
+	ref = fn;
+	return old;
+}
+
+obint_t
+echs_bdcal_intern(const char *fn, size_t fz)
+{
+	char buf[4096U];
+	const char *sl;
+	size_t dz;
+
+	if (ref == NULL || !fz || *fn == '/') {
+		return intern(fn, fz);
+	} else if ((sl = strrchr(ref, '/')) == NULL) {
+		/* REF is in the current directory */
+		return intern(fn, fz);
+	}
+	if (UNLIKELY((dz = sl + 1U - ref) + fz > sizeof(buf))) {
+		return intern(fn, fz);
+	}
+	memcpy(buf, ref, dz);
+	memcpy(buf + dz, fn, fz);
+	return intern(buf, dz + fz);
+}
+
+void
+clear_bdcals(void)
+{
+	for (size_t i = 0U; i < ncals; i++) {
+		if (cals[i]->hol != NULL) {
+			free_echs_evstrm(cals[i]->hol);
+		}
+		free(cals[i]);
+	}
+	if (cals != NULL) {
+		free(cals);
+	}
+	cals = NULL;
+	ncals = zcals = 0U;
+	return;
+}
+
+/* bdcal.c ends here */
@@ -0,0 +1,66 @@
+/*** bdcal.h -- business day calendars
+ *
+ * Copyright (C) 2020 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of echse.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_bdcal_h_
+#define INCLUDED_bdcal_h_
+
+#include "bitint.h"
+#include "intern.h"
+
+/**
+ * Return the business days of year Y in calendar CAL, i.e. all
+ * weekdays but the ones covered by events in the ics file CAL names.
+ * Days are packed like rrule candidates, (m - 1) * 32 + d.
+ * With CAL 0, or if CAL can't be loaded, weekends only are skipped.
+ * Calendars are loaded once and their years compiled on demand.
+ * Calendars asked for while compiling themselves, through their own
+ * events or those of other calendars, count as weekends only. */
+extern const bitset383_t *echs_bdcal_year(obint_t cal, unsigned int y);
+
+/**
+ * Take calendar file names relative to the directory of the file REF
+ * from now on, or as they are with REF NULL.  Return the previous REF. */
+extern const char *echs_bdcal_ref(const char *ref);
+
+/**
+ * Intern the calendar file name FN of length FZ, see echs_bdcal_ref(). */
+extern obint_t echs_bdcal_intern(const char *fn, size_t fz);
+
+/**
+ * Free all calendars loaded so far. */
+extern void clear_bdcals(void);
+
+#endif	/* INCLUDED_bdcal_h_ */
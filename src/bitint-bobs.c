@@ -47,6 +47,142 @@ ass_int(bitint_t *restrict bi, int x)
 	return;
 }
 
+static void
+bi_bset(bitint_t *restrict bi)
+{
+/* turn natively stored BI into a bitset */
+	const size_t n = *bi->pos >> 1U;
+	int32_t tmp[countof(bi->neg)];
+
+	if (*bi->pos & 0b1U) {
+		/* already is one */
+		return;
+	}
+	memcpy(tmp, bi->neg, n * sizeof(*tmp));
+	memset(bi, 0, sizeof(*bi));
+	*bi->pos = 1U;
+	for (size_t i = 0U; i < n; i++) {
+		ass_bs(bi, tmp[i]);
+	}
+	return;
+}
+
+static void
+bi_norm(bitint_t *restrict bi)
+{
+/* bitsets without members go back to the empty native state */
+	uint32_t acc = *bi->pos ^ 0b1U;
+
+	for (size_t i = 1U; i < countof(bi->pos); i++) {
+		acc |= bi->pos[i];
+	}
+	for (size_t i = 0U; i < countof(bi->neg); i++) {
+		acc |= (uint32_t)bi->neg[i];
+	}
+	if (!acc) {
+		memset(bi, 0, sizeof(*bi));
+	}
+	return;
+}
+
+size_t
+bi_cnt(const bitint_t *bi)
+{
+	if (!(*bi->pos & 0b1U)) {
+		/* native */
+		return *bi->pos >> 1U;
+	}
+	/* don't count the bitset indicator */
+	return bits_cnt(bi->pos, countof(bi->pos)) +
+		bits_cnt((const uint32_t*)bi->neg, countof(bi->neg)) - 1U;
+}
+
+int
+bi_nth(const bitint_t *bi, size_t n)
+{
+	size_t k;
+
+	if (!(*bi->pos & 0b1U)) {
+		/* native */
+		return n < *bi->pos >> 1U ? bi->neg[n] : 0;
+	} else if (*bi->neg & 0b1U && !n--) {
+		/* naught comes first */
+		return 0;
+	}
+	/* skip the bitset indicator */
+	n++;
+	if ((k = bits_sel(bi->pos, countof(bi->pos), &n)) < SIZE_MAX) {
+		return (int)k;
+	}
+	/* skip the naught */
+	n += *bi->neg & 0b1U;
+	if ((k = bits_sel(
+		     (const uint32_t*)bi->neg, countof(bi->neg), &n)) < SIZE_MAX) {
+		return -(int)k;
+	}
+	return 0;
+}
+
+void
+bi_or(bitint_t *restrict tgt, const bitint_t *src)
+{
+	bitint_t s = *src;
+
+	bi_bset(tgt);
+	bi_bset(&s);
+	for (size_t i = 0U; i < countof(tgt->pos); i++) {
+		tgt->pos[i] |= s.pos[i];
+	}
+	for (size_t i = 0U; i < countof(tgt->neg); i++) {
+		tgt->neg[i] |= s.neg[i];
+	}
+	bi_norm(tgt);
+	return;
+}
+
+void
+bi_and(bitint_t *restrict tgt, const bitint_t *src)
+{
+	bitint_t s = *src;
+
+	bi_bset(tgt);
+	bi_bset(&s);
+	for (size_t i = 0U; i < countof(tgt->pos); i++) {
+		tgt->pos[i] &= s.pos[i];
+	}
+	for (size_t i = 0U; i < countof(tgt->neg); i++) {
+		tgt->neg[i] &= s.neg[i];
+	}
+	bi_norm(tgt);
+	return;
+}
+
+void
+bi_andn(bitint_t *restrict tgt, const bitint_t *src)
+{
+	bitint_t s = *src;
+
+	bi_bset(tgt);
+	bi_bset(&s);
+	for (size_t i = 0U; i < countof(tgt->pos); i++) {
+		tgt->pos[i] &= ~s.pos[i];
+	}
+	for (size_t i = 0U; i < countof(tgt->neg); i++) {
+		tgt->neg[i] &= ~s.neg[i];
+	}
+	/* keep the bitset indicator */
+	*tgt->pos |= 0b1U;
+	bi_norm(tgt);
+	return;
+}
+
 #undef ass_bs
 #undef ass_int
+#undef bi_bset
+#undef bi_norm
+#undef bi_cnt
+#undef bi_nth
+#undef bi_or
+#undef bi_and
+#undef bi_andn
 #undef bitint_t
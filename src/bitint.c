@@ -38,6 +38,10 @@
 # include "config.h"
 #endif	/* HAVE_CONFIG_H */
 #include <string.h>
+#include <stdint.h>
+#if defined __x86_64__ && defined __GNUC__
+# include <immintrin.h>
+#endif	/* __x86_64__ && __GNUC__ */
 #include "bitint.h"
 #include "nifty.h"
 
@@ -45,14 +49,134 @@
 #define NEG_BITZ	(sizeof(*(bitint383_t){}.neg) * 8U)
 
 
+
+/* word kernels, counting and selecting bits in arrays of words,
+ * with popcnt and bmi2 where the cpu has them */
+static size_t
+bits_cnt_sw(const uint32_t *w, size_t nw)
+{
+	size_t res = 0U;
+
+	for (size_t i = 0U; i < nw; i++) {
+		uint32_t x = w[i];
+
+		x -= (x >> 1U) & 0x55555555U;
+		x = (x & 0x33333333U) + ((x >> 2U) & 0x33333333U);
+		x = (x + (x >> 4U)) & 0x0f0f0f0fU;
+		res += (x * 0x01010101U) >> 24U;
+	}
+	return res;
+}
+
+static size_t
+bits_sel_sw(const uint32_t *w, size_t nw, size_t *restrict n)
+{
+/* return the index of the N-th (0-based) set bit in W,
+ * or SIZE_MAX and deduct the number of set bits in W from N */
+	for (size_t i = 0U; i < nw; i++) {
+		uint32_t x = w[i];
+		size_t c = bits_cnt_sw(&x, 1U);
+
+		if (*n >= c) {
+			*n -= c;
+			continue;
+		}
+		for (size_t k = *n; k; k--) {
+			x &= x - 1U;
+		}
+		return i * 32U + __builtin_ctz(x);
+	}
+	return SIZE_MAX;
+}
+
+#if defined __x86_64__ && defined __GNUC__
+static __attribute__((target("popcnt"))) size_t
+bits_cnt_hw(const uint32_t *w, size_t nw)
+{
+	size_t res = 0U;
+
+	for (size_t i = 0U; i < nw; i++) {
+		res += __builtin_popcount(w[i]);
+	}
+	return res;
+}
+
+static __attribute__((target("popcnt,bmi2"))) size_t
+bits_sel_hw(const uint32_t *w, size_t nw, size_t *restrict n)
+{
+	for (size_t i = 0U; i < nw; i++) {
+		size_t c = __builtin_popcount(w[i]);
+
+		if (*n >= c) {
+			*n -= c;
+			continue;
+		}
+		return i * 32U + __builtin_ctz(_pdep_u32(1U << *n, w[i]));
+	}
+	return SIZE_MAX;
+}
+#endif	/* __x86_64__ && __GNUC__ */
+
+static size_t bits_cnt_init(const uint32_t *w, size_t nw);
+static size_t bits_sel_init(const uint32_t *w, size_t nw, size_t *n);
+static size_t(*bits_cnt)(const uint32_t*, size_t) = bits_cnt_init;
+static size_t(*bits_sel)(const uint32_t*, size_t, size_t*) = bits_sel_init;
+
+static void
+bits_init(void)
+{
+	bits_cnt = bits_cnt_sw;
+	bits_sel = bits_sel_sw;
+#if defined __x86_64__ && defined __GNUC__
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("popcnt")) {
+		bits_cnt = bits_cnt_hw;
+	}
+	if (__builtin_cpu_supports("popcnt") &&
+	    __builtin_cpu_supports("bmi2")) {
+		bits_sel = bits_sel_hw;
+	}
+#endif	/* __x86_64__ && __GNUC__ */
+	return;
+}
+
+static size_t
+bits_cnt_init(const uint32_t *w, size_t nw)
+{
+	bits_init();
+	return bits_cnt(w, nw);
+}
+
+static size_t
+bits_sel_init(const uint32_t *w, size_t nw, size_t *n)
+{
+	bits_init();
+	return bits_sel(w, nw, n);
+}
+
+
 #define bitint_t	bitint383_t
 #define ass_bs		ass_bs383
 #define ass_int		ass_int383
+#define bi_bset		bi383_bset
+#define bi_norm		bi383_norm
+#define bi_cnt		bi383_cnt
+#define bi_nth		bi383_nth
+#define bi_or		bi383_or
+#define bi_and		bi383_and
+#define bi_andn		bi383_andn
 #include "bitint-bobs.c"
 
 #define bitint_t	bitint447_t
 #define ass_bs		ass_bs447
 #define ass_int		ass_int447
+#define bi_bset		bi447_bset
+#define bi_norm		bi447_norm
+#define bi_cnt		bi447_cnt
+#define bi_nth		bi447_nth
+#define bi_or		bi447_or
+#define bi_and		bi447_and
+#define bi_andn		bi447_andn
 #include "bitint-bobs.c"
 
 
@@ -124,7 +248,7 @@ bi383_next(bitint_iter_t *restrict iter, const bitint383_t *bi)
 			ij = 0U, ip = 1U;
 			goto negs;
 		} else {
-			for (; !(tmp & 0b1U); ip++, tmp >>= 1U);
+			ip += __builtin_ctz(tmp);
 			res = ij * POS_BITZ + ip;
 			*iter = res + 1U;
 		}
@@ -152,7 +276,7 @@ bi383_next(bitint_iter_t *restrict iter, const bitint383_t *bi)
 			/* we're simply out of luck */
 			goto term;
 		} else {
-			for (; !(tmp & 0b1U); ip++, tmp >>= 1U);
+			ip += __builtin_ctz(tmp);
 			res = -(POS_BITZ * ij + ip);
 			*iter = -res + POS_BITZ * countof(bi->pos) + 1U;
 		}
@@ -255,7 +379,7 @@ bi447_next(bitint_iter_t *restrict iter, const bitint447_t *bi)
 			ij = 0U, ip = 1U;
 			goto negs;
 		} else {
-			for (; !(tmp & 0b1U); ip++, tmp >>= 1U);
+			ip += __builtin_ctz(tmp);
 			res = ij * POS_BITZ + ip;
 			*iter = res + 1U;
 		}
@@ -283,7 +407,7 @@ bi447_next(bitint_iter_t *restrict iter, const bitint447_t *bi)
 			/* we're simply out of luck */
 			goto term;
 		} else {
-			for (; !(tmp & 0b1U); ip++, tmp >>= 1U);
+			ip += __builtin_ctz(tmp);
 			res = -(POS_BITZ * ij + ip);
 			*iter = -res + POS_BITZ * countof(bi->pos) + 1U;
 		}
@@ -295,4 +419,29 @@ bi447_next(bitint_iter_t *restrict iter, const bitint447_t *bi)
 	return res;
 }
 
+size_t
+bs383_rank(const bitset383_t *bs, unsigned int x)
+{
+	size_t nw = x / 32U;
+	size_t res;
+
+	if (UNLIKELY(nw >= countof(bs->w))) {
+		return bits_cnt(bs->w, countof(bs->w));
+	}
+	res = bits_cnt(bs->w, nw);
+	if (x % 32U) {
+		const uint32_t lo = bs->w[nw] & ((1U << (x % 32U)) - 1U);
+		res += bits_cnt(&lo, 1U);
+	}
+	return res;
+}
+
+int
+bs383_select(const bitset383_t *bs, size_t n)
+{
+	size_t r = bits_sel(bs->w, countof(bs->w), &n);
+
+	return r < SIZE_MAX ? (int)r : -1;
+}
+
 /* bitint.c ends here */
@@ -69,6 +69,11 @@ typedef struct {
 	int32_t neg[14U];
 } bitint447_t;
 
+/* plain bitsets, one bit per day of the year and then some */
+typedef struct {
+	uint32_t w[12U];
+} bitset383_t;
+
 /**
  * Assign X to bitset/integer BI. */
 extern void ass_bi383(bitint383_t *restrict bi, int x);
@@ -89,6 +94,40 @@ extern void ass_bi447(bitint447_t *restrict bi, int x);
  * Iterate over integers in BI. */
 extern int bi447_next(bitint_iter_t *restrict iter, const bitint447_t *bi);
 
+/**
+ * Return the number of integers in BI. */
+extern size_t bi383_cnt(const bitint383_t *bi);
+extern size_t bi447_cnt(const bitint447_t *bi);
+
+/**
+ * Return the N-th (0-based) integer in BI in iteration order,
+ * N must be less than the number of integers in BI. */
+extern int bi383_nth(const bitint383_t *bi, size_t n);
+extern int bi447_nth(const bitint447_t *bi, size_t n);
+
+/**
+ * Add the integers in SRC to TGT. */
+extern void bi383_or(bitint383_t *restrict tgt, const bitint383_t *src);
+extern void bi447_or(bitint447_t *restrict tgt, const bitint447_t *src);
+
+/**
+ * Keep only those integers in TGT that are in SRC too. */
+extern void bi383_and(bitint383_t *restrict tgt, const bitint383_t *src);
+extern void bi447_and(bitint447_t *restrict tgt, const bitint447_t *src);
+
+/**
+ * Remove the integers in SRC from TGT. */
+extern void bi383_andn(bitint383_t *restrict tgt, const bitint383_t *src);
+extern void bi447_andn(bitint447_t *restrict tgt, const bitint447_t *src);
+
+/**
+ * Return the number of bits in BS below X. */
+extern size_t bs383_rank(const bitset383_t *bs, unsigned int x);
+
+/**
+ * Return the N-th (0-based) bit in BS or -1 if there's fewer bits. */
+extern int bs383_select(const bitset383_t *bs, size_t n);
+
 
 /**
  * Assign X to bitset/integer BI. */
@@ -241,6 +280,26 @@ bi63_has_bits_p(bitint63_t bi)
 	return bi.pos != 0ULL || bi.neg != 0LL;
 }
 
+static inline void
+bs383_set(bitset383_t *restrict bs, unsigned int x)
+{
+	bs->w[x / 32U] |= 1U << (x % 32U);
+	return;
+}
+
+static inline void
+bs383_clr(bitset383_t *restrict bs, unsigned int x)
+{
+	bs->w[x / 32U] &= ~(1U << (x % 32U));
+	return;
+}
+
+static inline bool
+bs383_has_bit_p(const bitset383_t *bs, unsigned int x)
+{
+	return bs->w[x / 32U] >> (x % 32U) & 0b1U;
+}
+
 static inline bool
 bi383_has_bits_p(const bitint383_t bi[static 1U])
 {
@@ -83,6 +83,8 @@
 #include "evfilt.h"
 /* for user/group mappings */
 #include "nummapstr.h"
+/* for allocator statistics */
+#include "slab.h"
 
 #if defined __INTEL_COMPILER
 # define auto	static
@@ -117,6 +119,8 @@ struct _task_s {
 	/* currently scheduled run-time */
 	echs_instant_t cur;
 	echs_idiff_t dur;
+	/* last run-time ever, nul if none, max if unbounded */
+	echs_instant_t last;
 
 	/* this is the task as understood by libechse */
 	echs_task_t t;
@@ -1224,43 +1228,19 @@ run_task(_task_t t)
 static __attribute__((pure, const)) ev_tstamp
 instant_to_tstamp(echs_instant_t i)
 {
-/* this way around it's easier, date range supported is 2001 to 2099
- * (i.e. with no bullshit leap years) */
-	static uint16_t __mon_yday[] = {
-		/* this is \sum ml,
-		 * first element is a bit set of leap days to add */
-		0xfff8, 0,
-		31, 59, 90, 120, 151, 181,
-		212, 243, 273, 304, 334, 365
-	};
-	unsigned int nd = 0U;
-	time_t t;
-
-	/* days from 2001-01-01 till day 0 of current year,
-	 * i.e. i.y-01-00 */
-	nd += 365U * (i.y - 2001U) + (i.y - 2001U) / 4U;
-	/* day-of-year */
-	nd += __mon_yday[i.m] + i.d + UNLIKELY(!(i.y % 4U) && i.m >= 3);
-
-	if (LIKELY(!echs_instant_all_day_p(i))) {
-		t = (((time_t)nd * 24U + i.H) * 60U + i.M) * 60U + i.S;
-	} else {
-		t = (time_t)nd * 86400UL;
-	}
-	/* calc number of seconds since unix epoch */
-	t += 11322/*days from unix epoch to our epoch*/ * 86400UL;
-	return (double)t;
+	return (double)echs_instant_to_epoch(i);
 }
 
 static echs_event_t
 unwind_till(echs_evstrm_t x, ev_tstamp t)
 {
-	echs_event_t e;
-	while (!echs_event_0_p(e = echs_evstrm_next(x)) &&
-	       instant_to_tstamp(e.from) < t) {
-		(void)echs_evstrm_pop(x);
+/* discard all events that start before T and return the next one */
+	with (time_t s = (time_t)t) {
+		/* the first full second not before T */
+		s += (ev_tstamp)s < t;
+		echs_evstrm_seek(x, epoch_to_echs_instant(s));
 	}
-	return e;
+	return echs_evstrm_next(x);
 }
 
 
@@ -1465,7 +1445,7 @@ chkpnt1(uid_t u)
 			inittedp = true;
 		}
 		/* let evical module handle the printing */
-		echs_task_icalify(fd, task_ht[i].t->t);
+		echs_task_chkpnt(fd, task_ht[i].t->t);
 	}
 	if (UNLIKELY(!inittedp)) {
 		echs_icalify_init(fd, (echs_instruc_t){INSVERB_UNK});
@@ -1554,7 +1534,7 @@ chkpnta(void)
 		}
 
 		/* let evical module handle the printing */
-		echs_task_icalify(fd, task_ht[i].t->t);
+		echs_task_chkpnt(fd, task_ht[i].t->t);
 	}
 	for (size_t i = 0U; i < nsnds; i++) {
 		const int fd = snds[i].fd;
@@ -1732,6 +1712,12 @@ echs_http_send_sched(_task_t t, const char *tuid, size_t tusz)
 	fdwrite(tuid, tusz);
 	fdputc('\t');
 	fdwrite(rng, rnz);
+	if (!echs_nul_instant_p(t->last) && !echs_max_instant_p(t->last)) {
+		/* bounded tasks get their last run too */
+		fdputc('\t');
+		rnz = dt_strf(rng, sizeof(rng), t->last);
+		fdwrite(rng, rnz);
+	}
 	fdputc('\n');
 	return;
 }
@@ -2170,7 +2156,11 @@ sigint_cb(EV_P_ ev_signal *UNUSED(w), int UNUSED(revents))
 static void
 sighup_cb(EV_P_ ev_signal *UNUSED(w), int UNUSED(revents))
 {
-	ECHS_NOTI_LOG("SIGHUP caught, doing nothing");
+	ECHS_NOTI_LOG("SIGHUP caught, dumping allocator statistics");
+	for (echs_slab_t s = echs_slabs(); s != NULL; s = s->next) {
+		ECHS_NOTI_LOG("slab %s: %zu objects (%zu bytes) in %zu chunks \
+(%zu bytes)", s->name, s->nlive, s->zlive, s->nchunk, s->zchunk);
+	}
 	return;
 }
 
@@ -2265,10 +2255,17 @@ resched(ev_periodic *w, ev_tstamp now)
  * to defer unschedule operations by one. */
 	_task_t t = (void*)w;
 	echs_evstrm_t s = t->t->strm;
-	echs_event_t e = unwind_till(s, now);
+	echs_event_t e;
 	ev_tstamp soon;
 	char stmp[32];
 
+	if (!echs_nul_instant_p(t->last) && !echs_max_instant_p(t->last) &&
+	    instant_to_tstamp(t->last) < now) {
+		/* past its last run, no need to unwind the stream */
+		e = echs_nul_event();
+	} else {
+		e = unwind_till(s, now);
+	}
 	if (UNLIKELY(echs_event_0_p(e) && !t->nrun)) {
 		/* this has never been run in the first place */
 		ECHS_NOTI_LOG("event in the past, not scheduling");
@@ -2292,7 +2289,8 @@ resched(ev_periodic *w, ev_tstamp now)
 
 	(void)dt_strf(stmp, sizeof(stmp), e.from);
 
-	ECHS_NOTI_LOG("next run %f (%s)", soon, stmp);
+	ECHS_NOTI_LOG("next run %f (%s)%s", soon, stmp,
+		      echs_instant_eq_p(e.from, t->last) ? ", the last one" : "");
 	return soon;
 }
 
@@ -2570,6 +2568,8 @@ task update from user %d for task from user %d failed: permission denied",
 	echs_task_rset_ownr(t, uc.u);
 	/* bang libechse task into our _task */
 	res->t = t;
+	/* see when it's going to be over */
+	res->last = echs_evstrm_last(t->strm).from;
 	/* run all tasks as U and the default group of U */
 	res->dflt_cred.u = uc.u;
 	res->dflt_cred.g = uc.g;
@@ -46,9 +46,11 @@
 #include <errno.h>
 #include <time.h>
 #include <fcntl.h>
+#include <sys/wait.h>
 #include "echse.h"
 #include "echse-genuid.h"
 #include "evical.h"
+#include "bdcal.h"
 #include "dt-strpf.h"
 #include "fdprnt.h"
 #include "nifty.h"
@@ -56,7 +58,12 @@
 struct unroll_param_s {
 	echs_instant_t from;
 	echs_instant_t till;
-	struct rrulsp_s filt;
+	/* compiled --filter, or NULL */
+	struct rrulfc_s *filt;
+	/* whether TILL itself is excluded */
+	bool tillx;
+	/* whether to emit records for unroll_frmt_strm() */
+	bool recs;
 };
 
 
@@ -317,18 +324,25 @@ free_task_ht(void)
 }
 
 
-static void
-chck_filt(struct rrulsp_s *restrict f)
+static struct rrulfc_s*
+chck_filt(rrulsp_t f)
 {
+	static struct rrulfc_s fc;
+
 	if (bi31_has_bits_p(f->dom) ||
 	    bi447_has_bits_p(&f->dow) ||
 	    bui31_has_bits_p(f->mon) ||
 	    bi63_has_bits_p(f->wk) ||
-	    bi383_has_bits_p(&f->doy)) {
-		/* indicate active filter */
-		f->freq = FREQ_YEARLY;
+	    bi383_has_bits_p(&f->doy) ||
+	    bi383_has_bits_p(&f->easter) ||
+	    bui31_has_bits_p(f->H) ||
+	    bui63_has_bits_p(f->M) ||
+	    bui63_has_bits_p(f->S)) {
+		/* there's stuff to filter */
+		rrul_filt_compile(&fc, f);
+		return &fc;
 	}
-	return;
+	return NULL;
 }
 
 static void
@@ -487,31 +501,314 @@ unroll_prnt(int ofd, echs_event_t e, const char *fmt)
 static void
 unroll_frmt(echs_evstrm_t smux, const struct unroll_param_s *p, const char *fmt)
 {
-	echs_event_t e;
+	echs_event_t buf[64U];
+	echs_instant_t ins[countof(buf)];
+	bool pass[countof(buf)];
 
 	/* just get it out now */
 	fdbang(STDOUT_FILENO);
-	while (!echs_event_0_p(e = echs_evstrm_pop(smux))) {
-		/* prepare for printing */
-		e.from = echs_instant_detach_scale(e.from);
-		if (echs_instant_lt_p(p->till, e.from)) {
-			break;
-		} else if (echs_instant_lt_p(e.from, p->from)) {
-			continue;
-		} else if (p->filt.freq &&
-			   !echs_instant_matches_p(&p->filt, e.from)) {
-			continue;
+	for (size_t n;
+	     (n = echs_evstrm_next_batch(smux, buf, countof(buf), p->till));) {
+		if (p->filt != NULL) {
+			/* filter the whole batch in one go */
+			for (size_t i = 0U; i < n; i++) {
+				ins[i] = echs_instant_detach_scale(buf[i].from);
+			}
+			rrul_filt(pass, ins, n, p->filt);
+		}
+		for (size_t i = 0U; i < n; i++) {
+			echs_event_t e = buf[i];
+
+			/* prepare for printing */
+			e.from = echs_instant_detach_scale(e.from);
+			if (echs_instant_lt_p(e.from, p->from)) {
+				continue;
+			} else if (p->tillx && echs_instant_eq_p(e.from, p->till)) {
+				continue;
+			} else if (p->filt != NULL && !pass[i]) {
+				continue;
+			}
+			/* otherwise print */
+			if (p->recs) {
+				/* prefix with the raw event for the merger */
+				fdwrite((const char*)(buf + i), sizeof(*buf));
+			}
+			unroll_prnt(STDOUT_FILENO, e, fmt);
+			/* finalise buf */
+			fdputc('\n');
+			if (p->recs) {
+				fdputc('\0');
+			}
 		}
-		/* otherwise print */
-		unroll_prnt(STDOUT_FILENO, e, fmt);
-		/* finalise buf */
-		fdputc('\n');
 		fdflush();
 	}
 	fdflush();
 	return;
 }
 
+static echs_instant_t
+slice_inst(echs_instant_t i)
+{
+	i = echs_instant_detach_scale(i);
+	if (echs_instant_all_day_p(i)) {
+		i.H = 0U, i.M = 0U, i.S = 0U, i.ms = 0U;
+	} else if (echs_instant_all_sec_p(i)) {
+		i.ms = 0U;
+	}
+	return i;
+}
+
+static int
+reap(pid_t pid)
+{
+/* wait for child PID, return 0 if it exited successfully, -1 if it
+ * didn't or if it can't be waited for */
+	int st;
+
+	while (waitpid(pid, &st, 0) < 0) {
+		if (errno != EINTR) {
+			return -1;
+		}
+	}
+	return WIFEXITED(st) && WEXITSTATUS(st) == EXIT_SUCCESS ? 0 : -1;
+}
+
+static int
+unroll_frmt_par(
+	echs_evstrm_t smux, const struct unroll_param_s *p, const char *fmt,
+	size_t nj)
+{
+/* Cut [FROM, TILL] into NJ slices and have a child process unroll each
+ * of them into a temp file, children get their own copies of the
+ * streams and all the caches, concatenating the files in order gives
+ * the output of the sequential unroll. */
+	const echs_instant_t t0 = slice_inst(p->from);
+	const echs_idiff_t dt = echs_instant_diff(slice_inst(p->till), t0);
+	struct {
+		pid_t pid;
+		FILE *f;
+	} *w;
+	int rc = 0;
+
+	if (UNLIKELY((w = calloc(nj, sizeof(*w))) == NULL)) {
+		return -1;
+	}
+	for (size_t k = 0U; k < nj; k++) {
+		struct unroll_param_s q = *p;
+
+		if (k) {
+			echs_idiff_t o = {dt.d / (int64_t)nj * (int64_t)k};
+			q.from = echs_instant_add(t0, o);
+		}
+		if (k + 1U < nj) {
+			echs_idiff_t o = {dt.d / (int64_t)nj * (int64_t)(k + 1U)};
+			q.till = echs_instant_add(t0, o);
+			/* leave the boundary itself to the next slice */
+			q.tillx = true;
+		}
+		if (UNLIKELY((w[k].f = tmpfile()) == NULL)) {
+			serror("\
+echse: Error: cannot create temporary file");
+			rc = -1;
+			break;
+		}
+		fflush(stdout);
+		switch ((w[k].pid = fork())) {
+		case -1:
+			serror("\
+echse: Error: cannot fork");
+			rc = -1;
+			break;
+		case 0:
+			/* child */
+			if (dup2(fileno(w[k].f), STDOUT_FILENO) < 0) {
+				_exit(EXIT_FAILURE);
+			}
+			echs_evstrm_seek(smux, q.from);
+			echs_evstrm_clip(smux, q.till);
+			unroll_frmt(smux, &q, fmt);
+			_exit(fflush(stdout) ? EXIT_FAILURE : EXIT_SUCCESS);
+		default:
+			continue;
+		}
+		break;
+	}
+	/* collect the slices in order */
+	for (size_t k = 0U; k < nj && w[k].f != NULL; k++) {
+		const int fd = fileno(w[k].f);
+		char buf[65536U];
+		ssize_t nrd;
+
+		if (UNLIKELY(w[k].pid <= 0)) {
+			fclose(w[k].f);
+			continue;
+		} else if (UNLIKELY(reap(w[k].pid) < 0)) {
+			errno = 0, serror("\
+echse: Error: unrolling slice %zu failed", k + 1U);
+			rc = -1;
+		}
+		lseek(fd, 0, SEEK_SET);
+		while (rc >= 0 && (nrd = read(fd, buf, sizeof(buf))) > 0) {
+			for (ssize_t nwr, tot = 0; tot < nrd; tot += nwr) {
+				nwr = write(STDOUT_FILENO, buf + tot, nrd - tot);
+				if (UNLIKELY(nwr < 0)) {
+					rc = -1;
+					break;
+				}
+			}
+		}
+		fclose(w[k].f);
+	}
+	free(w);
+	return rc;
+}
+
+struct unroll_rec_s {
+	FILE *f;
+	pid_t pid;
+	echs_event_t e;
+	char *ln;
+	size_t lz;
+	ssize_t nl;
+};
+
+static int
+unroll_next_rec(struct unroll_rec_s *w)
+{
+/* read the next record off W's pipe into W, once the pipe runs dry
+ * the worker is reaped, return -1 if the record is truncated or the
+ * worker failed, 0 otherwise, W->nl is 0 if there's no more records */
+	size_t nrd;
+	pid_t pid;
+
+	if ((nrd = fread(&w->e, 1U, sizeof(w->e), w->f)) == sizeof(w->e) &&
+	    (w->nl = getdelim(&w->ln, &w->lz, '\0', w->f)) > 0 &&
+	    w->ln[w->nl - 1] == '\0') {
+		return 0;
+	}
+	w->nl = 0;
+	if (nrd > 0U || !feof(w->f)) {
+		return -1;
+	}
+	/* end of pipe, make sure the worker got there properly */
+	pid = w->pid, w->pid = 0;
+	return reap(pid);
+}
+
+static int
+unroll_frmt_strm(
+	echs_evstrm_t *s, size_t ns, const struct unroll_param_s *p,
+	const char *fmt, size_t nj)
+{
+/* Have NJ child processes each unroll a contiguous range of the NS
+ * streams in S, records (raw event, formatted line) are passed back
+ * through pipes which act as bounded rings, and are merged here by
+ * instant and worker index, the same order the muxer would use.
+ * The streams in S are consumed. */
+	struct unroll_rec_s *w;
+	size_t nw = 0U;
+	int rc = 0;
+
+	if (UNLIKELY((w = calloc(nj, sizeof(*w))) == NULL)) {
+		return -1;
+	}
+	for (size_t k = 0U; k < nj; k++) {
+		const size_t lo = k * ns / nj;
+		const size_t hi = (k + 1U) * ns / nj;
+		int pfd[2U];
+
+		if (UNLIKELY(pipe(pfd) < 0)) {
+			serror("\
+echse: Error: cannot create pipe");
+			rc = -1;
+			break;
+		}
+		switch ((w[k].pid = fork())) {
+		case -1:
+			serror("\
+echse: Error: cannot fork");
+			close(pfd[0U]);
+			close(pfd[1U]);
+			rc = -1;
+			break;
+		case 0: {
+			/* child */
+			struct unroll_param_s q = *p;
+			echs_evstrm_t smux;
+
+			close(pfd[0U]);
+			if (dup2(pfd[1U], STDOUT_FILENO) < 0) {
+				_exit(EXIT_FAILURE);
+			}
+			close(pfd[1U]);
+			smux = echs_evstrm_vmux(s + lo, hi - lo);
+			smux = echs_evstrm_window(smux, p->from, p->till);
+			if (UNLIKELY(smux == NULL)) {
+				_exit(EXIT_SUCCESS);
+			}
+			q.recs = true;
+			unroll_frmt(smux, &q, fmt);
+			_exit(EXIT_SUCCESS);
+		}
+		default:
+			close(pfd[1U]);
+			w[k].f = fdopen(pfd[0U], "r");
+			nw++;
+			continue;
+		}
+		break;
+	}
+	/* the streams live on in the children */
+	for (size_t i = 0U; i < ns; i++) {
+		free_echs_evstrm(s[i]);
+	}
+
+	/* prime the rings */
+	for (size_t k = 0U; rc >= 0 && k < nw; k++) {
+		if (UNLIKELY(unroll_next_rec(w + k) < 0)) {
+			errno = 0, serror("\
+echse: Error: unrolling streams in worker %zu failed", k + 1U);
+			rc = -1;
+		}
+	}
+	/* merge */
+	while (rc >= 0) {
+		size_t best = nw;
+
+		for (size_t k = 0U; k < nw; k++) {
+			if (w[k].nl <= 0) {
+				continue;
+			} else if (best >= nw || echs_event_lt_p(w[k].e, w[best].e)) {
+				best = k;
+			}
+		}
+		if (best >= nw) {
+			break;
+		}
+		/* print line sans the record terminator */
+		fwrite(w[best].ln, 1U, w[best].nl - 1U, stdout);
+		if (UNLIKELY(unroll_next_rec(w + best) < 0)) {
+			/* don't merge what's left, it'd be missing events */
+			errno = 0, serror("\
+echse: Error: unrolling streams in worker %zu failed", best + 1U);
+			rc = -1;
+		}
+	}
+	fflush(stdout);
+
+	for (size_t k = 0U; k < nw; k++) {
+		fclose(w[k].f);
+		if (w[k].pid > 0 && UNLIKELY(reap(w[k].pid) < 0) && rc >= 0) {
+			errno = 0, serror("\
+echse: Error: unrolling streams in worker %zu failed", k + 1U);
+			rc = -1;
+		}
+		free(w[k].ln);
+	}
+	free(w);
+	return rc;
+}
+
 static int
 _inject_rrul(echs_instant_t from, const char *str)
 {
@@ -526,6 +823,7 @@ _inject_fd(int fd, const char *name)
 {
 	char buf[65536U];
 	ical_parser_t pp = NULL;
+	const char *ref = echs_bdcal_ref(name);
 	ssize_t nrd;
 
 more:
@@ -576,14 +874,17 @@ more:
 		}
 		break;
 	}
+	/* relative BUSDAYCALs are resolved against NAME */
+	(void)echs_bdcal_ref(ref);
 	return 0;
 }
 
 static int
-_merge_fd(int fd, echs_instant_t unr_till)
+_merge_fd(int fd, const char *name, echs_instant_t unr_till)
 {
 	char buf[65536U];
 	ical_parser_t pp = NULL;
+	const char *ref = echs_bdcal_ref(name);
 	ssize_t nrd;
 
 more:
@@ -618,8 +919,13 @@ more:
 					(void)echs_evstrm_pop(ins.t->strm);
 				}
 			}
-			/* and otherwise inject him */
-			echs_task_icalify(STDOUT_FILENO, ins.t);
+			/* and otherwise inject him, with the iterator state
+			 * if we unrolled him so he can be resumed */
+			if (echs_nul_instant_p(unr_till)) {
+				echs_task_icalify(STDOUT_FILENO, ins.t);
+			} else {
+				echs_task_chkpnt(STDOUT_FILENO, ins.t);
+			}
 			free_echs_task(ins.t);
 		} while (1);
 		if (LIKELY(nrd > 0)) {
@@ -642,6 +948,7 @@ more:
 		}
 		break;
 	}
+	(void)echs_bdcal_ref(ref);
 	return 0;
 }
 
@@ -654,8 +961,11 @@ cmd_unroll(const struct yuck_cmd_unroll_s argi[static 1U])
 {
 	static const char dflt_fmt[] = "%b\t%s";
 	/* params that filter the output */
-	struct unroll_param_s p = {.filt = {.freq = FREQ_NONE}};
+	struct unroll_param_s p = {.filt = NULL};
 	echs_evstrm_t smux = NULL;
+	size_t nj = 1U;
+	bool bystrm = false;
+	int rc = 0;
 
 	if (argi->from_arg) {
 		p.from = dt_strp(argi->from_arg, NULL, 0U);
@@ -670,12 +980,12 @@ cmd_unroll(const struct yuck_cmd_unroll_s argi[static 1U])
 	if (argi->filter_arg) {
 		const char *sel = argi->filter_arg;
 		const size_t len = strlen(sel);
-
 		/* just use the rrule parts, there won't be a frequency set */
-		p.filt = echs_read_rrul(sel, len);
-		/* quickly assess the rrule, set a frequency if there's
+		const struct rrulsp_s f = echs_read_rrul(sel, len);
+
+		/* quickly assess the rrule, compile it if there's
 		 * stuff to be filtered */
-		chck_filt(&p.filt);
+		p.filt = chck_filt(&f);
 	}
 
 	for (size_t i = 0UL; i < argi->nargs; i++) {
@@ -700,6 +1010,37 @@ echse: Error: cannot open file `%s'", fn);
 	}
 	/* there might be riff raff (NULLs) in the stream array */
 	condense_strms();
+
+	if (argi->jobs_arg) {
+		nj = strtoul(argi->jobs_arg, NULL, 10);
+	}
+	if (argi->split_arg) {
+		if (!strcmp(argi->split_arg, "streams")) {
+			bystrm = true;
+		} else if (strcmp(argi->split_arg, "time")) {
+			errno = 0, serror("\
+echse: Error: unknown split method `%s'", argi->split_arg);
+			free_task_ht();
+			return 1;
+		}
+	} else {
+		/* time slices need a start */
+		bystrm = !argi->from_arg;
+	}
+	if (nj > 1U && bystrm && nstrms > 1U &&
+	    (argi->format_arg == NULL || strcmp(argi->format_arg, "ical"))) {
+		const char *fmt = argi->format_arg ?: dflt_fmt;
+
+		/* spread the streams across workers */
+		nj = nj < nstrms ? nj : nstrms;
+		if (unroll_frmt_strm(strms, nstrms, &p, fmt, nj) < 0) {
+			rc = 1;
+		}
+		free_strms();
+		free_task_ht();
+		return rc;
+	}
+
 	if (UNLIKELY((smux = echs_evstrm_vmux(strms, nstrms)) == NULL)) {
 		/* return early */
 		return 1;
@@ -707,9 +1048,24 @@ echse: Error: cannot open file `%s'", fn);
 	/* noone needs the streams in an array anymore */
 	free_strms();
 
+	/* don't bother unrolling the past, nor the far future */
+	smux = echs_evstrm_window(
+		smux, argi->from_arg ? p.from : echs_nul_instant(), p.till);
+	if (UNLIKELY(smux == NULL)) {
+		free_task_ht();
+		return 1;
+	}
+
 	if (argi->format_arg != NULL && !strcmp(argi->format_arg, "ical")) {
 		/* special output format */
 		unroll_ical(smux, &p);
+	} else if (nj > 1U && !bystrm) {
+		/* slice it up */
+		const char *fmt = argi->format_arg ?: dflt_fmt;
+
+		if (unroll_frmt_par(smux, &p, fmt, nj) < 0) {
+			rc = 1;
+		}
 	} else {
 		const char *fmt = argi->format_arg ?: dflt_fmt;
 		unroll_frmt(smux, &p, fmt);
@@ -717,9 +1073,258 @@ echse: Error: cannot open file `%s'", fn);
 
 	free_echs_evstrm(smux);
 	free_task_ht();
+	return rc;
+}
+
+static int
+cmd_count(const struct yuck_cmd_count_s argi[static 1U])
+{
+	echs_instant_t from = echs_nul_instant();
+	echs_instant_t till = {.y = 2037, .m = 12, .d = 31};
+	size_t cnt = 0U;
+
+	if (argi->from_arg) {
+		from = dt_strp(argi->from_arg, NULL, 0U);
+	}
+	if (argi->till_arg) {
+		till = dt_strp(argi->till_arg, NULL, 0U);
+	}
+
+	for (size_t i = 0UL; i < argi->nargs; i++) {
+		const char *fn = argi->args[i];
+		int fd;
+
+		if (UNLIKELY((fd = open(fn, O_RDONLY)) < 0)) {
+			serror("\
+echse: Error: cannot open file `%s'", fn);
+			continue;
+		}
+		/* otherwise inject */
+		_inject_fd(fd, fn);
+		close(fd);
+	}
+	for (size_t i = 0UL; i < argi->rrule_nargs; i++) {
+		_inject_rrul(from, argi->rrule_args[i]);
+	}
+	if (argi->nargs == 0UL && argi->rrule_nargs == 0UL) {
+		/* read from stdin */
+		_inject_fd(STDIN_FILENO, "<stdin>");
+	}
+	condense_strms();
+	/* streams belong to different tasks, their events can't be
+	 * duplicates of each other, so count them one by one, that way
+	 * the streams' own counting methods get a chance */
+	for (size_t i = 0UL; i < nstrms; i++) {
+		cnt += echs_evstrm_count(strms[i], from, till);
+		free_echs_evstrm(strms[i]);
+	}
+	free_strms();
+	free_task_ht();
+
+	printf("%zu\n", cnt);
 	return 0;
 }
 
+static int
+cmd_nth(const struct yuck_cmd_nth_s argi[static 1U])
+{
+	static const char dflt_fmt[] = "%b\t%s";
+	const char *fmt = argi->format_arg ?: dflt_fmt;
+	echs_instant_t from = echs_nul_instant();
+	echs_evstrm_t smux;
+	echs_event_t e;
+	unsigned long int n;
+	char *on;
+	int rc = 1;
+
+	if (argi->nargs == 0UL) {
+		fputs("\
+echse: Error: N must be given\n", stderr);
+		return 1;
+	} else if ((n = strtoul(argi->args[0U], &on, 10)) == 0UL || *on) {
+		fputs("\
+echse: Error: N must be a positive number\n", stderr);
+		return 1;
+	}
+	if (argi->from_arg) {
+		from = dt_strp(argi->from_arg, NULL, 0U);
+	}
+
+	for (size_t i = 1UL; i < argi->nargs; i++) {
+		const char *fn = argi->args[i];
+		int fd;
+
+		if (UNLIKELY((fd = open(fn, O_RDONLY)) < 0)) {
+			serror("\
+echse: Error: cannot open file `%s'", fn);
+			continue;
+		}
+		/* otherwise inject */
+		_inject_fd(fd, fn);
+		close(fd);
+	}
+	for (size_t i = 0UL; i < argi->rrule_nargs; i++) {
+		_inject_rrul(from, argi->rrule_args[i]);
+	}
+	if (argi->nargs == 1UL && argi->rrule_nargs == 0UL) {
+		/* read from stdin */
+		_inject_fd(STDIN_FILENO, "<stdin>");
+	}
+	/* there might be riff raff (NULLs) in the stream array */
+	condense_strms();
+	if (UNLIKELY((smux = echs_evstrm_vmux(strms, nstrms)) == NULL)) {
+		/* return early */
+		free_strms();
+		free_task_ht();
+		return 1;
+	}
+	/* noone needs the streams in an array anymore */
+	free_strms();
+
+	if (argi->from_arg) {
+		echs_evstrm_seek(smux, from);
+	}
+	if (!echs_event_0_p(e = echs_evstrm_nth(smux, n))) {
+		e.from = echs_instant_detach_scale(e.from);
+		fdbang(STDOUT_FILENO);
+		unroll_prnt(STDOUT_FILENO, e, fmt);
+		fdputc('\n');
+		fdflush();
+		rc = 0;
+	}
+
+	free_echs_evstrm(smux);
+	free_task_ht();
+	return rc;
+}
+
+static int
+cmd_prev(const struct yuck_cmd_prev_s argi[static 1U])
+{
+	static const char dflt_fmt[] = "%b\t%s";
+	const char *fmt = argi->format_arg ?: dflt_fmt;
+	echs_instant_t before;
+	echs_evstrm_t smux;
+	echs_event_t e;
+	int rc = 1;
+
+	if (argi->nargs == 0UL) {
+		fputs("\
+echse: Error: DT must be given\n", stderr);
+		return 1;
+	} else if (echs_nul_instant_p(before = dt_strp(argi->args[0U], NULL, 0U))) {
+		fputs("\
+echse: Error: cannot parse DT\n", stderr);
+		return 1;
+	}
+
+	for (size_t i = 1UL; i < argi->nargs; i++) {
+		const char *fn = argi->args[i];
+		int fd;
+
+		if (UNLIKELY((fd = open(fn, O_RDONLY)) < 0)) {
+			serror("\
+echse: Error: cannot open file `%s'", fn);
+			continue;
+		}
+		/* otherwise inject */
+		_inject_fd(fd, fn);
+		close(fd);
+	}
+	if (argi->nargs == 1UL) {
+		/* read from stdin */
+		_inject_fd(STDIN_FILENO, "<stdin>");
+	}
+	/* there might be riff raff (NULLs) in the stream array */
+	condense_strms();
+	if (UNLIKELY((smux = echs_evstrm_vmux(strms, nstrms)) == NULL)) {
+		/* return early */
+		free_strms();
+		free_task_ht();
+		return 1;
+	}
+	/* noone needs the streams in an array anymore */
+	free_strms();
+
+	if (!echs_event_0_p(e = echs_evstrm_prev(smux, before))) {
+		e.from = echs_instant_detach_scale(e.from);
+		fdbang(STDOUT_FILENO);
+		unroll_prnt(STDOUT_FILENO, e, fmt);
+		fdputc('\n');
+		fdflush();
+		rc = 0;
+	}
+
+	free_echs_evstrm(smux);
+	free_task_ht();
+	return rc;
+}
+
+static int
+cmd_final(const struct yuck_cmd_final_s argi[static 1U])
+{
+	static const char dflt_fmt[] = "%b\t%s";
+	const char *fmt = argi->format_arg ?: dflt_fmt;
+	echs_instant_t from = echs_nul_instant();
+	echs_evstrm_t smux;
+	echs_event_t e;
+	int rc = 1;
+
+	if (argi->from_arg) {
+		from = dt_strp(argi->from_arg, NULL, 0U);
+	}
+
+	for (size_t i = 0UL; i < argi->nargs; i++) {
+		const char *fn = argi->args[i];
+		int fd;
+
+		if (UNLIKELY((fd = open(fn, O_RDONLY)) < 0)) {
+			serror("\
+echse: Error: cannot open file `%s'", fn);
+			continue;
+		}
+		/* otherwise inject */
+		_inject_fd(fd, fn);
+		close(fd);
+	}
+	for (size_t i = 0UL; i < argi->rrule_nargs; i++) {
+		_inject_rrul(from, argi->rrule_args[i]);
+	}
+	if (argi->nargs == 0UL && argi->rrule_nargs == 0UL) {
+		/* read from stdin */
+		_inject_fd(STDIN_FILENO, "<stdin>");
+	}
+	/* there might be riff raff (NULLs) in the stream array */
+	condense_strms();
+	if (UNLIKELY((smux = echs_evstrm_vmux(strms, nstrms)) == NULL)) {
+		/* return early */
+		free_strms();
+		free_task_ht();
+		return 1;
+	}
+	/* noone needs the streams in an array anymore */
+	free_strms();
+
+	if (echs_event_0_p(e = echs_evstrm_last(smux))) {
+		;
+	} else if (echs_max_instant_p(e.from)) {
+		/* goes on forever, there's no last one */
+		errno = 0, serror("\
+echse: events go on forever");
+	} else {
+		e.from = echs_instant_detach_scale(e.from);
+		fdbang(STDOUT_FILENO);
+		unroll_prnt(STDOUT_FILENO, e, fmt);
+		fdputc('\n');
+		fdflush();
+		rc = 0;
+	}
+
+	free_echs_evstrm(smux);
+	free_task_ht();
+	return rc;
+}
+
 static int
 cmd_genuid(const struct yuck_cmd_genuid_s argi[static 1U])
 {
@@ -762,12 +1367,12 @@ echse: Error: cannot open file `%s'", fn);
 			continue;
 		}
 		/* otherwise inject */
-		_merge_fd(fd, unr_till);
+		_merge_fd(fd, fn, unr_till);
 		close(fd);
 	}
 	if (argi->nargs == 0UL) {
 		/* read from stdin */
-		_merge_fd(STDIN_FILENO, unr_till);
+		_merge_fd(STDIN_FILENO, "<stdin>", unr_till);
 	}
 	echs_prnt_ical_fini();
 	return 0;
@@ -803,8 +1408,21 @@ Try --help for a list of commands.\n", stderr);
 	case ECHSE_CMD_MERGE:
 		rc = cmd_merge((struct yuck_cmd_merge_s*)argi);
 		break;
+	case ECHSE_CMD_COUNT:
+		rc = cmd_count((struct yuck_cmd_count_s*)argi);
+		break;
+	case ECHSE_CMD_NTH:
+		rc = cmd_nth((struct yuck_cmd_nth_s*)argi);
+		break;
+	case ECHSE_CMD_PREV:
+		rc = cmd_prev((struct yuck_cmd_prev_s*)argi);
+		break;
+	case ECHSE_CMD_FINAL:
+		rc = cmd_final((struct yuck_cmd_final_s*)argi);
+		break;
 	}
 	/* some global resources */
+	clear_bdcals();
 	clear_interns();
 	clear_bufpool();
 out:
@@ -48,6 +48,7 @@
 
 /* auxiliary stuff that might pollute the global namespace */
 #include "intern.h"
+#include "bdcal.h"
 #include "bufpool.h"
 
 #endif	/* INCLUDED_echse_h_ */
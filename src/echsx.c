@@ -1320,6 +1320,11 @@ Value for timeout (%" PRIi64 ") is out of range.", t->timeout.d);
 		time_t due = echs_instant_to_epoch(t->due);
 		time_t now = 0;
 
+		if (echs_instant_all_day_p(t->due)) {
+			/* due by the end of the day */
+			due += 86400;
+		}
+
 		if (UNLIKELY(time(&now) == (time_t)-1 || now >= due)) {
 			/* brilliant, what exactly do we do with
 			 * an overdue thing? */
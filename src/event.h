@@ -43,6 +43,7 @@
 #include "range.h"
 #include "state.h"
 #include "oid.h"
+#include "scale.h"
 
 typedef struct echs_event_s echs_event_t;
 
@@ -109,4 +110,20 @@ echs_event_range(echs_event_t e)
 	return (echs_range_t){e.from, echs_instant_add(e.from, e.dur)};
 }
 
+/**
+ * Return true if event E starts after TILL, scale information disregarded. */
+static inline __attribute__((const, pure)) bool
+echs_event_beyond_p(echs_event_t e, echs_instant_t till)
+{
+	return echs_instant_lt_p(till, echs_instant_detach_scale(e.from));
+}
+
+/**
+ * Return true if event E starts before FROM, scale information disregarded. */
+static inline __attribute__((const, pure)) bool
+echs_event_before_p(echs_event_t e, echs_instant_t from)
+{
+	return echs_instant_lt_p(echs_instant_detach_scale(e.from), from);
+}
+
 #endif	/* INCLUDED_event_h_ */
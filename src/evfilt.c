@@ -41,6 +41,7 @@
 #include <stdbool.h>
 #include "evfilt.h"
 #include "range.h"
+#include "slab.h"
 #include "nifty.h"
 
 /* generic stream with exceptions */
@@ -65,14 +66,24 @@ static echs_event_t next_evfilt(echs_evstrm_t, bool);
 static void free_evfilt(echs_evstrm_t);
 static echs_evstrm_t clone_evfilt(echs_const_evstrm_t);
 static void send_evfilt(int whither, echs_const_evstrm_t s);
+static void seek_evfilt(echs_evstrm_t, echs_instant_t);
+static void clip_evfilt(echs_evstrm_t, echs_instant_t);
+static echs_event_t prev_evfilt(echs_const_evstrm_t, echs_instant_t);
+static echs_event_t last_evfilt(echs_const_evstrm_t);
 
 static const struct echs_evstrm_class_s evfilt_cls = {
 	.next = next_evfilt,
 	.free = free_evfilt,
 	.clone = clone_evfilt,
 	.seria = send_evfilt,
+	.seek = seek_evfilt,
+	.clip = clip_evfilt,
+	.prev = prev_evfilt,
+	.last = last_evfilt,
 };
 
+static struct echs_slab_s evfilt_slab = ECHS_SLAB_INIT("evfilt");
+
 static echs_event_t
 next_evfilt(echs_evstrm_t s, bool popp)
 {
@@ -108,6 +119,96 @@ pop:
 	return e;
 }
 
+static void
+seek_evfilt(echs_evstrm_t s, echs_instant_t from)
+{
+	struct evfilt_s *this = (struct evfilt_s*)s;
+
+	echs_evstrm_seek(this->e, from);
+
+	if (UNLIKELY(echs_nul_range_p(this->ex))) {
+		/* no more exceptions */
+		return;
+	} else if (!echs_instant_le_p(this->ex.end, from)) {
+		/* current exception might still overlap */
+		return;
+	}
+	/* exceptions that end before FROM can't overlap with any of
+	 * the remaining events, exceptions come with the duration of
+	 * their task so use the next one to determine the cut-off */
+	with (echs_event_t nx = echs_evstrm_next(this->x)) {
+		if (UNLIKELY(echs_event_0_p(nx))) {
+			this->ex = echs_nul_range();
+			return;
+		}
+		from = echs_instant_add(from, echs_idiff_neg(nx.dur));
+	}
+	echs_evstrm_seek(this->x, from);
+	with (echs_event_t nx = echs_evstrm_pop(this->x)) {
+		this->ex = echs_event_range(nx);
+	}
+	return;
+}
+
+static void
+clip_evfilt(echs_evstrm_t s, echs_instant_t till)
+{
+	struct evfilt_s *this = (struct evfilt_s*)s;
+
+	/* exceptions starting after TILL may still overlap with events
+	 * before TILL, so leave X alone */
+	echs_evstrm_clip(this->e, till);
+	return;
+}
+
+static bool
+excl_p(const struct evfilt_s *this, echs_event_t e)
+{
+/* exceptions come with the duration of their task, so the last one
+ * that starts before the end of E is the only one that could possibly
+ * overlap with it */
+	echs_range_t r = echs_event_range(e);
+
+	if (echs_range_overlaps_p(r, this->ex)) {
+		return true;
+	} else if (LIKELY(this->x != NULL)) {
+		echs_instant_t til = echs_instant_detach_scale(r.end);
+		echs_event_t x = echs_evstrm_prev(this->x, til);
+
+		return !echs_event_0_p(x) &&
+			echs_range_overlaps_p(r, echs_event_range(x));
+	}
+	return false;
+}
+
+static echs_event_t
+prev_evfilt(echs_const_evstrm_t s, echs_instant_t before)
+{
+	const struct evfilt_s *this = (const struct evfilt_s*)s;
+	echs_event_t e;
+
+	while (!echs_event_0_p(e = echs_evstrm_prev(this->e, before)) &&
+	       excl_p(this, e)) {
+		before = echs_instant_detach_scale(e.from);
+	}
+	return e;
+}
+
+static echs_event_t
+last_evfilt(echs_const_evstrm_t s)
+{
+	const struct evfilt_s *this = (const struct evfilt_s*)s;
+	echs_event_t e = echs_evstrm_last(this->e);
+
+	if (echs_event_0_p(e) || echs_max_instant_p(e.from)) {
+		return e;
+	} else if (!excl_p(this, e)) {
+		return e;
+	}
+	/* excluded, look behind it */
+	return prev_evfilt(s, echs_instant_detach_scale(e.from));
+}
+
 static void
 free_evfilt(echs_evstrm_t s)
 {
@@ -117,6 +218,7 @@ free_evfilt(echs_evstrm_t s)
 	if (LIKELY(this->x != NULL)) {
 		free_echs_evstrm(this->x);
 	}
+	echs_slab_free(&evfilt_slab, this);
 	return;
 }
 
@@ -126,7 +228,8 @@ clone_evfilt(echs_const_evstrm_t s)
 	const struct evfilt_s *that = (const struct evfilt_s*)s;
 	struct evfilt_s *this;
 
-	if (UNLIKELY((this = malloc(sizeof(*this))) == NULL)) {
+	this = echs_slab_alloc(&evfilt_slab, sizeof(*this));
+	if (UNLIKELY(this == NULL)) {
 		return NULL;
 	}
 	this->class = &evfilt_cls;
@@ -142,6 +245,14 @@ send_evfilt(int whither, echs_const_evstrm_t s)
 	const struct evfilt_s *this = (const struct evfilt_s*)s;
 
 	echs_evstrm_seria(whither, this->e);
+	/* the exception we're holding on to has been popped off X
+	 * already so send it separately */
+	if (!echs_nul_range_p(this->ex)) {
+		exdate_icalify(whither, this->ex.beg);
+	}
+	if (LIKELY(this->x != NULL)) {
+		echs_evstrm_seria(whither, this->x);
+	}
 	return;
 }
 
@@ -157,7 +268,8 @@ make_evfilt(echs_evstrm_t e, echs_evstrm_t x)
 	} else if (UNLIKELY(x == NULL)) {
 		/* a filter that doesn't filter stuff adds nothing */
 		return e;
-	} else if (UNLIKELY((res = malloc(sizeof(*res))) == NULL)) {
+	} else if (UNLIKELY((res = echs_slab_alloc(
+			     &evfilt_slab, sizeof(*res))) == NULL)) {
 		return NULL;
 	}
 	res->class = &evfilt_cls;
@@ -44,4 +44,7 @@
  * throw away E's next event and go to the next one. */
 extern echs_evstrm_t make_evfilt(echs_evstrm_t e, echs_evstrm_t x);
 
+/* serialiser */
+extern void exdate_icalify(int whither, echs_instant_t);
+
 #endif	/* INCLUDED_evfilt_h_ */
@@ -49,8 +49,10 @@
 #include "evical.h"
 #include "task.h"
 #include "intern.h"
+#include "bdcal.h"
 #include "state.h"
 #include "bufpool.h"
+#include "slab.h"
 #include "bitint.h"
 #include "dt-strpf.h"
 #include "evrrul.h"
@@ -88,10 +90,26 @@ struct dtlst_s {
 	size_t zdt;
 };
 
+/* iterator state of an rrule stream, see X-ECHS-CURSOR */
+struct rrcur_s {
+	/* index of the rule in its rrlst */
+	size_t idx;
+	/* proto instant of the current cache fill */
+	echs_instant_t pro;
+	/* proto offset */
+	int pof;
+	/* position in the cache */
+	size_t pos;
+};
+
 struct rrlst_s {
 	struct rrulsp_s *r;
 	size_t nr;
 	size_t zr;
+	/* iterator states of the rules, if any */
+	struct rrcur_s *c;
+	size_t nc;
+	size_t zc;
 };
 
 struct mrlst_s {
@@ -193,6 +211,14 @@ add1_to_rrlst(struct rrlst_s *rl, const struct rrulsp_s *rr)
 	return;
 }
 
+static void
+add1_to_crlst(struct rrlst_s *rl, struct rrcur_s rc)
+{
+	CHECK_RESIZE(rl, c, 16U, 1U);
+	rl->c[rl->nc++] = rc;
+	return;
+}
+
 static void
 add1_to_mrlst(struct mrlst_s *rl, struct mrulsp_s mr)
 {
@@ -215,12 +241,18 @@ free_ical_vevent(struct ical_vevent_s *restrict ve)
 	if (ve->rrul.nr) {
 		free(ve->rrul.r);
 	}
+	if (ve->rrul.nc) {
+		free(ve->rrul.c);
+	}
 	if (ve->rdat.ndt) {
 		free(ve->rdat.dt);
 	}
 	if (ve->xrul.nr) {
 		free(ve->xrul.r);
 	}
+	if (ve->xrul.nc) {
+		free(ve->xrul.c);
+	}
 	if (ve->xdat.ndt) {
 		free(ve->xdat.dt);
 	}
@@ -515,6 +547,11 @@ snarf_rrule(const char *s, size_t z)
 			rr.shift = snarf_shift(++kv);
 			break;
 
+		case KEY_BDCAL:
+			kv++;
+			rr.cal = echs_bdcal_intern(kv, eofld - kv);
+			break;
+
 		case BY_WDAY:
 			/* this one's special in that weekday names
 			 * are allowed to follow the indicator number */
@@ -797,6 +834,64 @@ snarf_dtlst(const char *eof, const char *vp, const char *const ep)
 	return dl;
 }
 
+static ical_fld_t
+snarf_curs(struct rrcur_s *restrict rc, const char *s, size_t z)
+{
+/* cursor parser, return the rule field the cursor belongs to
+ * (FLD_RRULE or FLD_XRULE) or FLD_UNK if it's no use to us */
+	static const char rrul[] = "RRULE=";
+	static const char xrul[] = "EXRULE=";
+	static const char pro[] = "PROTO=";
+	static const char pof[] = "OFFSET=";
+	static const char pos[] = "POS=";
+	ical_fld_t res = FLD_UNK;
+
+	*rc = (struct rrcur_s){0U};
+	for (const char *sp = s, *const ep = s + z, *eofld;
+	     sp < ep; sp = eofld + 1) {
+		if (UNLIKELY((eofld = strchr(sp, ';')) == NULL)) {
+			eofld = ep;
+		}
+		if (0) {
+			;
+		} else if (!strncmp(sp, rrul, strlenof(rrul))) {
+			rc->idx = strtoul(sp + strlenof(rrul), NULL, 10);
+			res = FLD_RRULE;
+		} else if (!strncmp(sp, xrul, strlenof(xrul))) {
+			rc->idx = strtoul(sp + strlenof(xrul), NULL, 10);
+			res = FLD_XRULE;
+		} else if (!strncmp(sp, pro, strlenof(pro))) {
+			const char *vp = sp + strlenof(pro);
+
+			rc->pro = dt_strp(vp, NULL, eofld - vp);
+		} else if (!strncmp(sp, pof, strlenof(pof))) {
+			rc->pof = strtol(sp + strlenof(pof), NULL, 10);
+		} else if (!strncmp(sp, pos, strlenof(pos))) {
+			rc->pos = strtoul(sp + strlenof(pos), NULL, 10);
+		}
+	}
+	if (UNLIKELY(echs_instant_0_p(rc->pro))) {
+		/* can't resume without a proto instant */
+		return FLD_UNK;
+	}
+	return res;
+}
+
+static void
+cat_dtlst(struct dtlst_s *restrict tgt, struct dtlst_s src)
+{
+/* append SRC to TGT, SRC's resources are taken over */
+	if (!tgt->ndt) {
+		*tgt = src;
+		return;
+	}
+	for (size_t i = 0U; i < src.ndt; i++) {
+		add1_to_dtlst(tgt, src.dt[i]);
+	}
+	free(src.dt);
+	return;
+}
+
 static struct cal_addr_s
 snarf_mailto(const char *line, size_t llen)
 {
@@ -869,10 +964,10 @@ snarf_fld(struct ical_vevent_s ve[static 1U],
 			}
 			switch (fld) {
 			case FLD_XDATE:
-				ve->xdat = l;
+				cat_dtlst(&ve->xdat, l);
 				break;
 			case FLD_RDATE:
-				ve->rdat = l;
+				cat_dtlst(&ve->rdat, l);
 				break;
 			}
 		}
@@ -894,6 +989,20 @@ snarf_fld(struct ical_vevent_s ve[static 1U],
 			}
 		}
 		break;
+	case FLD_CURSOR:
+		with (struct rrcur_s c) {
+			switch (snarf_curs(&c, vp, ep - vp)) {
+			case FLD_RRULE:
+				add1_to_crlst(&ve->rrul, c);
+				break;
+			case FLD_XRULE:
+				add1_to_crlst(&ve->xrul, c);
+				break;
+			default:
+				break;
+			}
+		}
+		break;
 	case FLD_MRULE:
 		/* otherwise snarf him */
 		if_with (struct mrulsp_s r,
@@ -1611,6 +1720,9 @@ _ical_fini(struct ical_parser_s p[static 1U])
 
 
 /* sending is like printing but into a file descriptor of choice */
+/* whether to send the iterator states of rrule streams, too */
+static bool curp;
+
 static void
 send_task(int whither, echs_task_t t)
 {
@@ -1863,7 +1975,7 @@ send_ev(int whither, echs_event_t e, echs_tzob_t z)
 	char stmp[32U] = {':'};
 	size_t ztmp = 1U;
 	echs_scale_t sca;
-	const char *zn;
+	const char *zn = NULL;
 
 	if (UNLIKELY(echs_nul_instant_p(e.from))) {
 		return;
@@ -1894,6 +2006,10 @@ send_ev(int whither, echs_event_t e, echs_tzob_t z)
 	}
 	/* the actual stamp */
 	ztmp = dt_strf_ical(stmp + 1U, sizeof(stmp) - 1U, e.from);
+	if (zn != NULL && stmp[ztmp] == 'Z') {
+		/* it's local time, not UTC */
+		ztmp--;
+	}
 	stmp[ztmp++ + 1U] = '\n';
 	fdwrite(stmp, ztmp + 1U);
 
@@ -1909,6 +2025,39 @@ send_ev(int whither, echs_event_t e, echs_tzob_t z)
 	return;
 }
 
+static void
+send_dtlst(int whither, const char *fld, const echs_event_t *ev, size_t nev)
+{
+/* send the instants of EV as comma-separated list in UTC */
+	char stmp[32U] = {','};
+	echs_scale_t sca;
+
+	if (UNLIKELY(!nev)) {
+		return;
+	}
+
+	/* tell the bufferer we want to write to WHITHER */
+	fdbang(whither);
+
+	fdwrite(fld, strlen(fld));
+	if (echs_instant_all_day_p(ev->from)) {
+		fdwrite(";VALUE=DATE", strlenof(";VALUE=DATE"));
+	}
+	if ((sca = echs_instant_scale(ev->from))) {
+		send_scale(sca);
+	}
+	fdputc(':');
+	for (size_t i = 0U; i < nev; i++) {
+		echs_instant_t in = echs_instant_detach_scale(ev[i].from);
+		size_t ztmp = dt_strf_ical(stmp + 1U, sizeof(stmp) - 1U, in);
+
+		/* leave out the comma for the first one */
+		fdwrite(stmp + !i, ztmp + !!i);
+	}
+	fdputc('\n');
+	return;
+}
+
 static void
 send_cd(int whither, struct cd_s cd)
 {
@@ -1927,7 +2076,7 @@ send_cd(int whither, struct cd_s cd)
 }
 
 static void
-send_rrul(int whither, rrulsp_t rr, size_t ccnt)
+send_rrul(int whither, const char *fld, rrulsp_t rr, size_t ccnt)
 {
 	static const char *const f[] = {
 		[FREQ_NONE] = "FREQ=NONE",
@@ -1943,7 +2092,7 @@ send_rrul(int whither, rrulsp_t rr, size_t ccnt)
 	/* tell the bufferer we want to write to WHITHER */
 	fdbang(whither);
 
-	fdprintf("RRULE:%s", f[rr->freq]);
+	fdprintf("%s:%s", fld, f[rr->freq]);
 
 	if (rr->inter > 1U) {
 		fdprintf(";INTERVAL=%u", rr->inter);
@@ -2098,6 +2247,9 @@ send_rrul(int whither, rrulsp_t rr, size_t ccnt)
 			}
 		}
 	}
+	if (rr->cal) {
+		fdprintf(";BUSDAYCAL=%s", obint_name(rr->cal));
+	}
 
 	if (rr->count >= 0) {
 		fdprintf(";COUNT=%zu", rr->count + ccnt);
@@ -2131,14 +2283,65 @@ static echs_event_t next_evical_vevent(echs_evstrm_t, bool popp);
 static void free_evical_vevent(echs_evstrm_t);
 static echs_evstrm_t clone_evical_vevent(echs_const_evstrm_t);
 static void send_evical_vevent(int whither, echs_const_evstrm_t s);
+static size_t
+next_batch_evical_vevent(
+	echs_evstrm_t, echs_event_t*restrict, size_t, echs_instant_t);
+static void seek_evical_vevent(echs_evstrm_t, echs_instant_t);
+static echs_event_t prev_evical_vevent(echs_const_evstrm_t, echs_instant_t);
+static echs_event_t last_evical_vevent(echs_const_evstrm_t);
 
 static const struct echs_evstrm_class_s evical_cls = {
 	.next = next_evical_vevent,
 	.free = free_evical_vevent,
 	.clone = clone_evical_vevent,
 	.seria = send_evical_vevent,
+	.next_batch = next_batch_evical_vevent,
+	.seek = seek_evical_vevent,
+	.prev = prev_evical_vevent,
+	.last = last_evical_vevent,
+};
+
+/* same as the above but serialised as RDATE or EXDATE lists,
+ * rdates without rrules need to bring their own DTSTART */
+static void send_evrdat(int whither, echs_const_evstrm_t s);
+static void send_evrdat_solo(int whither, echs_const_evstrm_t s);
+static void send_evxdat(int whither, echs_const_evstrm_t s);
+
+static const struct echs_evstrm_class_s evrdat_cls = {
+	.next = next_evical_vevent,
+	.free = free_evical_vevent,
+	.clone = clone_evical_vevent,
+	.seria = send_evrdat,
+	.next_batch = next_batch_evical_vevent,
+	.seek = seek_evical_vevent,
+	.prev = prev_evical_vevent,
+	.last = last_evical_vevent,
+};
+
+static const struct echs_evstrm_class_s evrdat_solo_cls = {
+	.next = next_evical_vevent,
+	.free = free_evical_vevent,
+	.clone = clone_evical_vevent,
+	.seria = send_evrdat_solo,
+	.next_batch = next_batch_evical_vevent,
+	.seek = seek_evical_vevent,
+	.prev = prev_evical_vevent,
+	.last = last_evical_vevent,
+};
+
+static const struct echs_evstrm_class_s evxdat_cls = {
+	.next = next_evical_vevent,
+	.free = free_evical_vevent,
+	.clone = clone_evical_vevent,
+	.seria = send_evxdat,
+	.next_batch = next_batch_evical_vevent,
+	.seek = seek_evical_vevent,
+	.prev = prev_evical_vevent,
+	.last = last_evical_vevent,
 };
 
+static struct echs_slab_s evical_slab = ECHS_SLAB_INIT("evical");
+
 static const echs_event_t nul;
 
 static echs_evstrm_t
@@ -2147,7 +2350,8 @@ make_evical_vevent(const struct echs_event_s *ev, size_t nev)
 	const size_t zev = nev * sizeof(*ev);
 	struct evical_s *res;
 
-	if (UNLIKELY((res = malloc(sizeof(*res) + zev)) == NULL)) {
+	res = echs_slab_alloc(&evical_slab, sizeof(*res) + zev);
+	if (UNLIKELY(res == NULL)) {
 		return NULL;
 	}
 	res->class = &evical_cls;
@@ -2162,7 +2366,7 @@ free_evical_vevent(echs_evstrm_t s)
 {
 	struct evical_s *this = (struct evical_s*)s;
 
-	free(this);
+	echs_slab_free(&evical_slab, this);
 	return;
 }
 
@@ -2174,6 +2378,9 @@ clone_evical_vevent(echs_const_evstrm_t s)
 
 	res = (struct evical_s*)make_evical_vevent(
 		this->ev + this->i, this->nev - this->i);
+	if (LIKELY(res != NULL)) {
+		res->class = this->class;
+	}
 	return (echs_evstrm_t)res;
 }
 
@@ -2193,6 +2400,82 @@ next_evical_vevent(echs_evstrm_t s, bool popp)
 	return res;
 }
 
+static size_t
+next_batch_evical_vevent(
+	echs_evstrm_t s, echs_event_t *restrict buf, size_t nbuf,
+	echs_instant_t till)
+{
+	struct evical_s *this = (struct evical_s*)s;
+	size_t n;
+
+	if (nbuf > this->nev - this->i) {
+		nbuf = this->nev - this->i;
+	}
+	for (n = 0U; n < nbuf; n++) {
+		if (echs_event_beyond_p(this->ev[this->i + n], till)) {
+			break;
+		}
+	}
+	memcpy(buf, this->ev + this->i, n * sizeof(*buf));
+	this->i += n;
+	return n;
+}
+
+static void
+seek_evical_vevent(echs_evstrm_t s, echs_instant_t from)
+{
+	struct evical_s *this = (struct evical_s*)s;
+	size_t lo = this->i;
+	size_t hi = this->nev;
+
+	/* events are sorted, find the first one not before FROM */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2U;
+
+		if (echs_event_before_p(this->ev[mid], from)) {
+			lo = mid + 1U;
+		} else {
+			hi = mid;
+		}
+	}
+	this->i = lo;
+	return;
+}
+
+static echs_event_t
+prev_evical_vevent(echs_const_evstrm_t s, echs_instant_t before)
+{
+	const struct evical_s *this = (const struct evical_s*)s;
+	size_t lo = 0U;
+	size_t hi = this->nev;
+
+	/* events are sorted, find the first one not before BEFORE */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2U;
+
+		if (echs_event_before_p(this->ev[mid], before)) {
+			lo = mid + 1U;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo == 0U) {
+		return nul;
+	}
+	return this->ev[lo - 1U];
+}
+
+static echs_event_t
+last_evical_vevent(echs_const_evstrm_t s)
+{
+	const struct evical_s *this = (const struct evical_s*)s;
+
+	if (UNLIKELY(!this->nev)) {
+		return nul;
+	}
+	return this->ev[this->nev - 1U];
+}
+
 static void
 send_evical_vevent(int whither, echs_const_evstrm_t s)
 {
@@ -2205,39 +2488,78 @@ send_evical_vevent(int whither, echs_const_evstrm_t s)
 	return;
 }
 
-static echs_instant_t
-instant_soup(echs_instant_t broth, echs_instant_t water, echs_tzob_t z, int eof)
+static void
+send_evrdat(int whither, echs_const_evstrm_t s)
+{
+	const struct evical_s *this = (const struct evical_s*)s;
+
+	send_dtlst(whither, "RDATE", this->ev + this->i, this->nev - this->i);
+	return;
+}
+
+static void
+send_evrdat_solo(int whither, echs_const_evstrm_t s)
 {
-	echs_instant_t soup;
-	echs_tzob_t fz;
+	const struct evical_s *this = (const struct evical_s*)s;
+
+	if (UNLIKELY(this->i >= this->nev)) {
+		return;
+	}
+	send_ev(whither, this->ev[this->i], 0U);
+	send_evrdat(whither, s);
+	return;
+}
 
-	if (UNLIKELY(echs_instant_all_day_p(water))) {
-		/* oh we have to paste the missing intra
-		 * bits from the proto-event */
-		int fof;
+static void
+send_evxdat(int whither, echs_const_evstrm_t s)
+{
+	const struct evical_s *this = (const struct evical_s*)s;
 
-		water.intra = broth.intra;
-		fof = echs_instant_tzof(water, z);
-		soup = echs_instant_detach_tzob(water);
+	send_dtlst(whither, "EXDATE", this->ev + this->i, this->nev - this->i);
+	return;
+}
 
-		if (fof != eof) {
+static void
+instant_soup_v(
+	echs_instant_t *restrict soup, const echs_instant_t *water, size_t n,
+	echs_instant_t broth, echs_tzob_t z, int eof)
+{
+/* UTCify the N instants WATER into SOUP, runs of the same kind and zone
+ * are converted in one go */
+	for (size_t i = 0U, j; i < n; i = j) {
+		const bool adp = echs_instant_all_day_p(water[i]);
+		const echs_tzob_t fz = echs_instant_tzob(water[i]);
+
+		for (j = i; j < n &&
+			     echs_instant_all_day_p(water[j]) == adp &&
+			     (adp || echs_instant_tzob(water[j]) == fz); j++) {
+			soup[j] = water[j];
+			if (adp) {
+				/* oh we have to paste the missing intra
+				 * bits from the proto-event */
+				soup[j].intra = broth.intra;
+				soup[j] = echs_instant_detach_tzob(soup[j]);
+			}
+		}
+		if (UNLIKELY(adp)) {
 			/* we need to add the discrepancy onto from */
-			soup = echs_tzob_shift(soup, fof, eof);
+			echs_tzob_shift_v(soup + i, j - i, z, eof);
+		} else if (UNLIKELY(fz)) {
+			echs_instant_utc_v(soup + i, j - i, fz);
 		}
-	} else if (UNLIKELY((fz = echs_instant_tzob(water)))) {
-		soup = echs_instant_utc(water, fz);
-	} else {
-		soup = water;
 	}
-	return soup;
+	return;
 }
 
 static echs_evstrm_t
-__make_evrdat(echs_event_t e, const echs_instant_t *d, size_t nd)
+__make_evrdat(echs_event_t e, const struct dtlst_s *dl, echs_evstrm_class_t cls)
 {
 /* this will degrade into an evical_vevent stream */
+	const echs_instant_t *d = dl->dt;
+	const size_t nd = dl->ndt;
 	struct evical_s *res;
 	const size_t zev = nd * sizeof(*res->ev);
+	size_t nu = 1U;
 	echs_scale_t cal;
 	echs_tzob_t z;
 	int eof;
@@ -2245,7 +2567,8 @@ __make_evrdat(echs_event_t e, const echs_instant_t *d, size_t nd)
 	if (nd == 0U) {
 		/* not worth it */
 		return NULL;
-	} else if (UNLIKELY((res = malloc(sizeof(*res) + zev)) == NULL)) {
+	} else if (UNLIKELY((res = echs_slab_alloc(
+			     &evical_slab, sizeof(*res) + zev)) == NULL)) {
 		/* not possible */
 		return NULL;
 	}
@@ -2259,7 +2582,7 @@ __make_evrdat(echs_event_t e, const echs_instant_t *d, size_t nd)
 
 	if (nd == 1U) {
 		/* no need to sort things, just spread the one instant */
-		e.from = instant_soup(e.from, d[0U], z, eof);
+		instant_soup_v(&e.from, d, 1U, e.from, z, eof);
 		e.from = echs_instant_rescale(e.from, cal);
 		res->ev[0U] = e;
 	} else {
@@ -2268,26 +2591,29 @@ __make_evrdat(echs_event_t e, const echs_instant_t *d, size_t nd)
 		echs_instant_t *rd =
 			(void*)(((uint8_t*)res->ev + zev) - nd * sizeof(*rd));
 
-		/* copy them instants here so we can sort them */
-		memcpy(rd, d, nd * sizeof(*rd));
-		/* also proto-paste the events in the list and UTCify them
+		/* copy them instants here so we can sort them, also
+		 * proto-paste the events in the list and UTCify them
 		 * before the actual sorting because in rare cases timezone
 		 * changes can actually change the order */
-		for (size_t i = 0U; i < nd; i++) {
-			rd[i] = instant_soup(e.from, d[i], z, eof);
-		}
+		instant_soup_v(rd, d, nd, e.from, z, eof);
 		/* now sort */
 		echs_instant_sort(rd, nd);
+		/* duplicate instances are ignored (RFC 5545, 3.8.5.2) */
+		for (size_t i = 1U; i < nd; i++) {
+			if (!echs_instant_eq_p(rd[i], rd[nu - 1U])) {
+				rd[nu++] = rd[i];
+			}
+		}
 		/* now spread out the instants as echs events */
-		for (size_t i = 0U; i < nd; i++) {
+		for (size_t i = 0U; i < nu; i++) {
 			e.from = echs_instant_rescale(rd[i], cal);
 			res->ev[i] = e;
 		}
 	}
 	/* just the rest of the book-keeping */
-	res->class = &evical_cls;
+	res->class = cls;
 	res->i = 0U;
-	res->nev = nd;
+	res->nev = nu;
 	return (echs_evstrm_t)res;
 }
 
@@ -2321,30 +2647,80 @@ struct evrrul_s {
 
 	/* rrul/xrul */
 	struct rrulsp_s rrul;
+	/* and its compiled form */
+	struct rrulcc_s rrcc;
 
 	/* iterator state */
 	size_t rdi;
-	/* unrolled cache */
+	/* proto instant the cache has been filled from */
+	echs_instant_t pro;
+	/* generate nothing beyond this, see clip_evrrul() */
+	echs_instant_t till;
+	/* first proto instant and count, for looking behind */
+	echs_instant_t dts;
+	int cnt;
+	/* unrolled cache, ZCCH instants and as many groups */
 	size_t ncch;
-	echs_instant_t cch[GRP_CCH_OFF + GRP_CCH_OFF];
+	size_t zcch;
+	echs_instant_t *cch;
 };
 
+/* bounds for the unrolled cache, it starts small and doubles with
+ * every refill that's been drained completely */
+#define EVRRUL_CCH_MIN	(8U)
+#define EVRRUL_CCH_MAX	(1024U)
+
 static echs_event_t next_evrrul(echs_evstrm_t, bool popp);
 static void free_evrrul(echs_evstrm_t);
 static echs_evstrm_t clone_evrrul(echs_const_evstrm_t);
 static void send_evrrul(int whither, echs_const_evstrm_t s);
+static void send_evxrul(int whither, echs_const_evstrm_t s);
+static size_t
+next_batch_evrrul(echs_evstrm_t, echs_event_t*restrict, size_t, echs_instant_t);
+static void seek_evrrul(echs_evstrm_t, echs_instant_t);
+static void clip_evrrul(echs_evstrm_t, echs_instant_t);
+static size_t skip_evrrul(echs_evstrm_t, size_t, echs_instant_t);
+static echs_event_t prev_evrrul(echs_const_evstrm_t, echs_instant_t);
+static echs_event_t last_evrrul(echs_const_evstrm_t);
 
 static const struct echs_evstrm_class_s evrrul_cls = {
 	.next = next_evrrul,
 	.free = free_evrrul,
 	.clone = clone_evrrul,
 	.seria = send_evrrul,
+	.next_batch = next_batch_evrrul,
+	.seek = seek_evrrul,
+	.clip = clip_evrrul,
+	.skip = skip_evrrul,
+	.prev = prev_evrrul,
+	.last = last_evrrul,
 };
 
+/* exrules, only their serialiser differs */
+static const struct echs_evstrm_class_s evxrul_cls = {
+	.next = next_evrrul,
+	.free = free_evrrul,
+	.clone = clone_evrrul,
+	.seria = send_evxrul,
+	.next_batch = next_batch_evrrul,
+	.seek = seek_evrrul,
+	.clip = clip_evrrul,
+	.skip = skip_evrrul,
+	.prev = prev_evrrul,
+	.last = last_evrrul,
+};
+
+static struct echs_slab_s evrrul_slab = ECHS_SLAB_INIT("evrrul");
+
+static size_t refill(struct evrrul_s *restrict strm, size_t want);
+
 static echs_evstrm_t
-__make_evrrul(echs_event_t e, rrulsp_t rr, size_t nr)
+__make_evrrul(echs_event_t e, const struct rrlst_s *rl, echs_evstrm_class_t cls)
 {
-/* Mux NR rrules RR carried by event E into one stream. */
+/* Mux the rrules in RL carried by event E into one stream,
+ * resume at the iterator states in RL, if any. */
+	const rrulsp_t rr = rl->r;
+	const size_t nr = rl->nr;
 	struct evrrul_s *this;
 	const size_t duo = sizeof(*this) + sizeof(this);
 	struct evrrul_s **that;
@@ -2352,21 +2728,28 @@ __make_evrrul(echs_event_t e, rrulsp_t rr, size_t nr)
 
 	if (UNLIKELY(nr == 0U)) {
 		return NULL;
-	} else if (UNLIKELY((this = calloc(nr + 1U, duo)) == NULL)) {
+	} else if (UNLIKELY((this = echs_slab_calloc(
+			     &evrrul_slab, (nr + 1U) * duo)) == NULL)) {
 		return NULL;
 	}
 	/* initialise THAT array */
 	that = (void*)(this + nr);
 
-	this->class = &evrrul_cls;
+	this->class = cls;
 	this->cal = echs_instant_scale(e.from);
 	e.from = echs_instant_rescale(e.from, SCALE_GREGORIAN);
 	this->zon = zon = echs_instant_tzob(e.from);
 	this->e = e = echs_event_to_utc(e);
 	this->pof = echs_instant_tzof(e.from, zon);
+	this->pro = e.from;
+	this->till = echs_max_instant();
+
+	this->dts = e.from;
 
 	/* bang the first one */
 	this->rrul = rr[0U];
+	rrul_compile(&this->rrcc, rr + 0U, e.from);
+	this->cnt = rr[0U].count;
 	this->seq = 0U;
 	this->ref = nr;
 	that[0U] = this;
@@ -2374,9 +2757,26 @@ __make_evrrul(echs_event_t e, rrulsp_t rr, size_t nr)
 	for (size_t i = 1U; i < nr; i++) {
 		this[i] = this[0U];
 		this[i].rrul = rr[i];
+		rrul_compile(&this[i].rrcc, rr + i, e.from);
+		this[i].cnt = rr[i].count;
 		this[i].seq = i;
 		that[i] = this + i;
 	}
+	/* resume where we left off */
+	for (size_t i = 0U; i < rl->nc; i++) {
+		const struct rrcur_s c = rl->c[i];
+		struct evrrul_s *tmp;
+
+		if (UNLIKELY(c.idx >= nr)) {
+			continue;
+		}
+		tmp = this + c.idx;
+		tmp->e.from = tmp->dts = c.pro;
+		tmp->pof = c.pof;
+		if (c.pos && refill(tmp, c.pos + 1U)) {
+			tmp->rdi = c.pos < tmp->ncch ? c.pos : tmp->ncch;
+		}
+	}
 	return echs_evstrm_vmux((const echs_evstrm_t*)that, nr);
 }
 
@@ -2385,11 +2785,12 @@ free_evrrul(echs_evstrm_t s)
 {
 	struct evrrul_s *this = (struct evrrul_s*)s;
 
+	free(this->cch);
 	if (UNLIKELY(this->seq)) {
 		this -= this->seq;
 	}
 	if (!--this->ref) {
-		free(this);
+		echs_slab_free(&evrrul_slab, this);
 	}
 	return;
 }
@@ -2400,24 +2801,46 @@ clone_evrrul(echs_const_evstrm_t s)
 	const struct evrrul_s *this = (const struct evrrul_s*)s;
 	struct evrrul_s *clon;
 
-	if (UNLIKELY((clon = malloc(sizeof(*this))) == NULL)) {
+	clon = echs_slab_alloc(&evrrul_slab, sizeof(*this));
+	if (UNLIKELY(clon == NULL)) {
 		return NULL;
 	}
 	*clon = *this;
 	/* clones are not arranged as sequences anymore */
 	clon->seq = 0U;
 	clon->ref = 1U;
+	if (this->cch != NULL) {
+		const size_t z = 2U * this->zcch * sizeof(*this->cch);
+
+		if (UNLIKELY((clon->cch = malloc(z)) == NULL)) {
+			echs_slab_free(&evrrul_slab, clon);
+			return NULL;
+		}
+		memcpy(clon->cch, this->cch, z);
+	}
 	return (echs_evstrm_t)clon;
 }
 
+static bool
+sorted_p(const echs_instant_t *in, size_t nin)
+{
+	for (size_t i = 1U; i < nin; i++) {
+		if (UNLIKELY(echs_instant_lt_p(in[i], in[i - 1U]))) {
+			return false;
+		}
+	}
+	return true;
+}
+
 /* this should be somewhere else, evrrul.c maybe? */
 static size_t
-refill(struct evrrul_s *restrict strm)
+refill(struct evrrul_s *restrict strm, size_t want)
 {
 /* useful table at:
  * http://icalevents.com/2447-need-to-know-the-possible-combinations-for-repeating-dates-an-ical-cheatsheet/
  * we're trying to follow that one closely. */
 	struct rrulsp_s *restrict rr = &strm->rrul;
+	const echs_instant_t until = rr->until;
 
 	assert(rr->freq > FREQ_NONE);
 	if (UNLIKELY(echs_nul_instant_p(strm->e.from))) {
@@ -2425,44 +2848,37 @@ refill(struct evrrul_s *restrict strm)
 	} else if (UNLIKELY(!rr->count)) {
 		return 0UL;
 	}
+	/* resize the cache to WANT rounded up to a power of two */
+	with (size_t z = EVRRUL_CCH_MIN) {
+		echs_instant_t *c;
+
+		for (; z < want && z < EVRRUL_CCH_MAX; z <<= 1U);
+		if (z != strm->zcch &&
+		    (c = realloc(strm->cch, 2U * z * sizeof(*c))) != NULL) {
+			strm->cch = c;
+			strm->zcch = z;
+		} else if (UNLIKELY(strm->cch == NULL)) {
+			/* no cache at all */
+			return 0UL;
+		}
+	}
+	/* keep track of the proto for serialisation */
+	strm->pro = strm->e.from;
 
 	/* fill up with the proto instant */
-	for (size_t j = 0U; j < GRP_CCH_OFF; j++) {
+	for (size_t j = 0U; j < strm->zcch; j++) {
 		strm->cch[j] = strm->e.from;
 	}
 
-	/* now go and see who can help us */
-	switch (rr->freq) {
-	default:
-		strm->ncch = 0UL;
-		break;
-
-	case FREQ_YEARLY:
-		/* easiest */
-		strm->ncch = rrul_fill_yly(strm->cch, GRP_CCH_OFF, rr);
-		break;
-	case FREQ_MONTHLY:
-		/* second easiest */
-		strm->ncch = rrul_fill_mly(strm->cch, GRP_CCH_OFF, rr);
-		break;
-	case FREQ_WEEKLY:
-		strm->ncch = rrul_fill_wly(strm->cch, GRP_CCH_OFF, rr);
-		break;
-	case FREQ_DAILY:
-		strm->ncch = rrul_fill_dly(strm->cch, GRP_CCH_OFF, rr);
-		break;
-	case FREQ_HOURLY:
-		strm->ncch = rrul_fill_Hly(strm->cch, GRP_CCH_OFF, rr);
-		break;
-	case FREQ_MINUTELY:
-		strm->ncch = rrul_fill_Mly(strm->cch, GRP_CCH_OFF, rr);
-		break;
-	case FREQ_SECONDLY:
-		strm->ncch = rrul_fill_Sly(strm->cch, GRP_CCH_OFF, rr);
-		break;
+	/* don't let the kernels go past our window */
+	if (echs_instant_lt_p(strm->till, until)) {
+		rr->until = strm->till;
 	}
+	/* now go and see who can help us */
+	strm->ncch = rrul_fill(strm->cch, strm->zcch, rr, &strm->rrcc);
+	rr->until = until;
 
-	if (strm->ncch >= GRP_CCH_OFF) {
+	if (strm->ncch >= strm->zcch) {
 		/* keep one for the next refill */
 		strm->e.from = strm->cch[--strm->ncch];
 	} else {
@@ -2485,18 +2901,13 @@ refill(struct evrrul_s *restrict strm)
 	for (size_t i = 0U; i < strm->ncch; i++) {
 		strm->cch[i] = echs_instant_rescale(strm->cch[i], strm->cal);
 	}
-	/* utcify them all */
-	for (size_t i = 0U; i < strm->ncch; i++) {
-		int eof = echs_instant_tzof(strm->cch[i], strm->zon);
-
-		if (UNLIKELY(eof != strm->pof)) {
-			/* discrepancy, convert defo */
-			strm->cch[i] = echs_tzob_shift(
-				strm->cch[i], eof, strm->pof);
-		}
+	/* utcify them all, instants off the proto's offset are moved */
+	if (echs_tzob_shift_v(strm->cch, strm->ncch, strm->zon, strm->pof) ||
+	    !sorted_p(strm->cch, strm->ncch)) {
+		/* sort the array, shifts may spill over into other years,
+		 * and transitions may have moved things about */
+		echs_instant_sort(strm->cch, strm->ncch);
 	}
-	/* otherwise sort the array, just in case */
-	echs_instant_sort(strm->cch, strm->ncch);
 	return strm->ncch;
 }
 
@@ -2508,8 +2919,8 @@ next_evrrul(echs_evstrm_t s, bool popp)
 
 	/* it's easier when we just have some precalc'd rdates */
 	if (this->rdi >= this->ncch) {
-		/* we have to refill the rdate cache */
-		if (refill(this) == 0UL) {
+		/* we have to refill the rdate cache, twice as big */
+		if (refill(this, 2U * this->zcch) == 0UL) {
 			goto nul;
 		}
 		/* reset counter */
@@ -2518,7 +2929,7 @@ next_evrrul(echs_evstrm_t s, bool popp)
 	/* construct the result */
 	res = this->e;
 	res.from = this->cch[this->rdi];
-	res.grp = this->cch[this->rdi + GRP_CCH_OFF];
+	res.grp = this->cch[this->rdi + this->zcch];
 	if (popp) {
 		this->rdi++;
 	}
@@ -2527,6 +2938,256 @@ nul:
 	return nul;
 }
 
+static size_t
+next_batch_evrrul(
+	echs_evstrm_t s, echs_event_t *restrict buf, size_t nbuf,
+	echs_instant_t till)
+{
+	struct evrrul_s *restrict this = (struct evrrul_s*)s;
+	size_t n = 0U;
+
+	while (n < nbuf) {
+		if (this->rdi >= this->ncch) {
+			/* we have to refill the rdate cache, at least as
+			 * big as what's left to fill in BUF */
+			size_t want = 2U * this->zcch;
+
+			if (want < nbuf - n) {
+				want = nbuf - n;
+			}
+			if (refill(this, want) == 0UL) {
+				break;
+			}
+			/* reset counter */
+			this->rdi = 0U;
+		}
+		/* copy straight from the cache */
+		for (; n < nbuf && this->rdi < this->ncch; n++, this->rdi++) {
+			const echs_instant_t in = this->cch[this->rdi];
+
+			if (echs_instant_lt_p(
+				    till, echs_instant_detach_scale(in))) {
+				return n;
+			}
+			buf[n] = this->e;
+			buf[n].from = in;
+			buf[n].grp = this->cch[this->rdi + this->zcch];
+		}
+	}
+	return n;
+}
+
+static void
+seek_evrrul(echs_evstrm_t s, echs_instant_t from)
+{
+	struct evrrul_s *restrict this = (struct evrrul_s*)s;
+
+	/* skip what's in the cache already */
+	for (; this->rdi < this->ncch; this->rdi++) {
+		echs_instant_t in = echs_instant_detach_scale(this->cch[this->rdi]);
+
+		if (!echs_instant_lt_p(in, from)) {
+			return;
+		}
+	}
+	/* the cache is exhausted, jump straight to the right period
+	 * unless we're counting, then we have to go the long way */
+	if (this->rrul.count < 0) {
+		this->e.from = rrul_seek(this->e.from, &this->rrul, from);
+	}
+	/* seeks are mostly followed by a handful of nexts, start small
+	 * and grow while we're discarding things */
+	for (size_t want = EVRRUL_CCH_MIN;
+	     refill(this, want) > 0UL; want = 2U * this->zcch) {
+		for (this->rdi = 0U; this->rdi < this->ncch; this->rdi++) {
+			echs_instant_t in =
+				echs_instant_detach_scale(this->cch[this->rdi]);
+
+			if (!echs_instant_lt_p(in, from)) {
+				return;
+			}
+		}
+	}
+	/* stream is exhausted */
+	this->rdi = this->ncch;
+	return;
+}
+
+static void
+clip_evrrul(echs_evstrm_t s, echs_instant_t till)
+{
+	struct evrrul_s *restrict this = (struct evrrul_s*)s;
+
+	if (UNLIKELY(this->rrul.scale != SCALE_GREGORIAN)) {
+		/* the kernels compare in the rule's scale, can't help */
+		return;
+	}
+	/* candidates are UTC with DST corrections applied afterwards,
+	 * allow for a day of slack, the window stream takes care of
+	 * the precise cut */
+	till = echs_instant_detach_scale(till);
+	till = echs_instant_add(till, (echs_idiff_t){86400000});
+	if (echs_instant_lt_p(till, this->till)) {
+		this->till = till;
+	}
+	return;
+}
+
+static size_t
+skip_evrrul(echs_evstrm_t s, size_t n, echs_instant_t till)
+{
+	struct evrrul_s *restrict this = (struct evrrul_s*)s;
+	size_t res = 0U;
+
+	while (res < n) {
+		size_t lo, hi;
+
+		if (this->rdi >= this->ncch) {
+			/* whole periods first, if the rule allows */
+			size_t m = n - res;
+			echs_instant_t lim = till;
+
+			if (this->rrul.count >= 0 && m > (size_t)this->rrul.count) {
+				m = this->rrul.count;
+			}
+			if (echs_instant_lt_p(this->till, lim)) {
+				lim = this->till;
+			}
+			m = rrul_skip(&this->e.from, &this->rrul, m, lim,
+				      &this->rrcc);
+			if (this->rrul.count > 0) {
+				this->rrul.count -= m;
+			}
+			res += m;
+			if (res >= n || refill(this, 2U * this->zcch) == 0UL) {
+				break;
+			}
+			this->rdi = 0U;
+		}
+		/* the cache is sorted, find the first one beyond TILL */
+		for (lo = this->rdi, hi = this->ncch; lo < hi;) {
+			const size_t mid = (lo + hi) / 2U;
+			echs_instant_t in =
+				echs_instant_detach_scale(this->cch[mid]);
+
+			if (echs_instant_lt_p(till, in)) {
+				hi = mid;
+			} else {
+				lo = mid + 1U;
+			}
+		}
+		if (lo - this->rdi > n - res) {
+			lo = this->rdi + (n - res);
+		}
+		res += lo - this->rdi;
+		this->rdi = lo;
+		if (lo < this->ncch) {
+			/* beyond TILL or N reached */
+			break;
+		}
+	}
+	return res;
+}
+
+static echs_event_t
+prev_evrrul(echs_const_evstrm_t s, echs_instant_t before)
+{
+/* Fill forward from a proto a few periods before BEFORE, that's where
+ * rrul_seek() puts us, if there's nothing go back twice as far. */
+	const struct evrrul_s *this = (const struct evrrul_s*)s;
+	echs_instant_t tgt = before = echs_instant_detach_scale(before);
+	echs_event_t res = nul;
+
+	while (1) {
+		echs_instant_t buf[2U * GRP_CCH_OFF];
+		struct evrrul_s w = *this;
+		echs_instant_t beg = this->dts;
+
+		if (this->cnt < 0) {
+			/* can't jump when counting */
+			beg = rrul_seek(this->dts, &this->rrul, tgt);
+		}
+		w.rrul.count = this->cnt;
+		w.till = echs_max_instant();
+		w.e.from = beg;
+		w.cch = buf;
+		w.zcch = GRP_CCH_OFF;
+		while (refill(&w, GRP_CCH_OFF) > 0UL) {
+			for (size_t i = 0U; i < w.ncch; i++) {
+				echs_instant_t in =
+					echs_instant_detach_scale(w.cch[i]);
+
+				if (!echs_instant_lt_p(in, before)) {
+					goto out;
+				}
+				res = w.e;
+				res.from = w.cch[i];
+				res.grp = w.cch[i + w.zcch];
+			}
+		}
+	out:
+		if (!echs_event_0_p(res) || echs_instant_eq_p(beg, this->dts)) {
+			break;
+		}
+		/* nothing in [BEG, BEFORE), look twice as far back */
+		with (echs_idiff_t d = echs_instant_diff(before, beg)) {
+			tgt = echs_instant_add(beg, echs_idiff_neg(d));
+		}
+	}
+	return res;
+}
+
+static echs_event_t
+last_evrrul(echs_const_evstrm_t s)
+{
+/* have the rrule count off its occurrences from the first proto */
+	const struct evrrul_s *this = (const struct evrrul_s*)s;
+	struct rrulsp_s rr = this->rrul;
+	echs_event_t res = this->e;
+	echs_instant_t x;
+
+	rr.count = this->cnt;
+	x = rrul_last(this->dts, &rr, &this->rrcc);
+	if (echs_nul_instant_p(x)) {
+		return nul;
+	} else if (echs_max_instant_p(x)) {
+		res.from = x;
+		return res;
+	}
+	/* convert to target scale and utcify, like refill() does */
+	x = echs_instant_rescale(x, this->cal);
+	with (int eof = echs_instant_tzof(x, this->zon)) {
+		if (UNLIKELY(eof != this->pof)) {
+			x = echs_tzob_shift(x, eof, this->pof);
+		}
+	}
+	res.from = x;
+	return res;
+}
+
+static void
+send_rrul_curs(int whither, const char *fld, const struct evrrul_s *this)
+{
+/* send the rrule of THIS as FLD and, if need be, the iterator state */
+	char stmp[32U];
+	size_t ztmp;
+
+	if (!curp) {
+		/* just the rule, counting only what's left */
+		send_rrul(whither, fld, &this->rrul, this->ncch - this->rdi);
+		return;
+	}
+	/* the rule as it was when the cache was last filled */
+	send_rrul(whither, fld, &this->rrul, this->ncch);
+
+	fdbang(whither);
+	ztmp = dt_strf_ical(stmp, sizeof(stmp), this->pro);
+	fdprintf("X-ECHS-CURSOR:%s=%zu;PROTO=", fld, this->seq);
+	fdwrite(stmp, ztmp);
+	fdprintf(";OFFSET=%d;POS=%zu\n", this->pof, this->rdi);
+	return;
+}
+
 static void
 send_evrrul(int whither, echs_const_evstrm_t s)
 {
@@ -2550,19 +3211,44 @@ send_evrrul(int whither, echs_const_evstrm_t s)
 			} else {
 				cand = this[i].cch[this[i].rdi];
 			}
-			if (echs_instant_lt_p(cand, e.from)) {
+			if (UNLIKELY(echs_nul_instant_p(cand))) {
+				/* exhausted */
+				;
+			} else if (echs_instant_lt_p(cand, e.from)) {
 				e.from = cand;
 			} else if (echs_nul_instant_p(e.from)) {
 				e.from = cand;
 			}
 		}
+		if (UNLIKELY(echs_nul_instant_p(e.from))) {
+			/* all rules are exhausted, there might still be
+			 * rdates though so we need some DTSTART */
+			e.from = this->pro;
+		}
 		send_ev(whither, e, this->zon);
 	}
-	send_rrul(whither, &this->rrul, this->ncch - this->rdi);
+	send_rrul_curs(whither, "RRULE", this);
+	return;
+}
+
+static void
+send_evxrul(int whither, echs_const_evstrm_t s)
+{
+	const struct evrrul_s *this = (const struct evrrul_s*)s;
+
+	send_rrul_curs(whither, "EXRULE", this);
 	return;
 }
 
 
+/* decl'd in evfilt.h, impl'd by us */
+void
+exdate_icalify(int whither, echs_instant_t x)
+{
+	send_dtlst(whither, "EXDATE", &(echs_event_t){.from = x}, 1U);
+	return;
+}
+
 /* decl'd in evmrul.h, impl'd by us */
 void
 mrulsp_icalify(int whither, const mrulsp_t *mr)
@@ -2642,7 +3328,7 @@ echs_make_evstrm_rrul(echs_instant_t from, struct rrulsp_s r[static 1U], size_t
 		.sts = 0,
 	};
 
-	return __make_evrrul(e, r, nr);
+	return __make_evrrul(e, &(struct rrlst_s){.r = r, .nr = nr}, &evrrul_cls);
 }
 
 static echs_task_t
@@ -2709,17 +3395,9 @@ make_task(struct ical_vevent_s *ve)
 			.sts = ve->sts,
 		};
 
-		if (ve->xrul.nr) {
-			free(ve->xrul.r);
-		}
-		if (ve->xdat.ndt) {
-			free(ve->xdat.dt);
-		}
-		if (ve->mrul.nr) {
-			free(ve->mrul.r);
-		}
 		assert(ve->rrul.r == NULL);
 		assert(ve->rdat.dt == NULL);
+		free_ical_vevent(ve);
 		s = __make_evvevt(e);
 	} else {
 		/* it's an rrule */
@@ -2737,8 +3415,8 @@ make_task(struct ical_vevent_s *ve)
 		/* get a proto exrule stream, composed of all exrules
 		 * in a nicely evmux'd stream */
 		with (echs_evstrm_t xr, x1) {
-			xr = __make_evrrul(e, ve->xrul.r, ve->xrul.nr);
-			x1 = __make_evrdat(e, ve->xdat.dt, ve->xdat.ndt);
+			xr = __make_evrrul(e, &ve->xrul, &evxrul_cls);
+			x1 = __make_evrdat(e, &ve->xdat, &evxdat_cls);
 
 			if (xr != NULL && x1 != NULL) {
 				/* mux them into one */
@@ -2751,8 +3429,10 @@ make_task(struct ical_vevent_s *ve)
 		}
 
 		with (echs_evstrm_t rr, r1) {
-			rr = __make_evrrul(e, ve->rrul.r, ve->rrul.nr);
-			r1 = __make_evrdat(e, ve->rdat.dt, ve->rdat.ndt);
+			rr = __make_evrrul(e, &ve->rrul, &evrrul_cls);
+			r1 = __make_evrdat(
+				e, &ve->rdat,
+				rr != NULL ? &evrdat_cls : &evrdat_solo_cls);
 
 			if (rr != NULL && r1 != NULL) {
 				/* mux them into one */
@@ -2894,6 +3574,15 @@ echs_task_icalify(int whither, echs_task_t t)
 	return;
 }
 
+void
+echs_task_chkpnt(int whither, echs_task_t t)
+{
+	curp = true;
+	echs_task_icalify(whither, t);
+	curp = false;
+	return;
+}
+
 void
 echs_unsc_icalify(int whither, const char *tuid)
 {
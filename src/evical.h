@@ -69,6 +69,12 @@ extern echs_evstrm_t echs_make_evstrm_rrul(echs_instant_t from, struct rrulsp_s
  * Helper for echsq(1) et al */
 extern void echs_task_icalify(int whither, echs_task_t t);
 
+/**
+ * Like `echs_task_icalify()' but also send the iterator state of T's
+ * stream so that T resumes where it left off when read back in.
+ * Used for echsd(1)'s checkpoints. */
+extern void echs_task_chkpnt(int whither, echs_task_t t);
+
 /**
  * Helper for echsq(1) et al */
 extern void echs_unsc_icalify(int whither, const char *tuid);
@@ -42,42 +42,23 @@
 #include <string.h>
 #include "evmrul.h"
 #include "evstrm.h"
+#include "slab.h"
 #include "nifty.h"
 
-/* simple event queue */
-struct eq_s {
-	size_t i;
-	echs_event_t e[16U];
-};
-
 /* mrul streams take an ordinary stream (the one with the movers) and
  * an auxiliary stream (the one with the states) and merge them into
- * an ordinary mover-free stream */
+ * an ordinary mover-free stream.
+ * The states are never read forward, movers are placed by looking
+ * behind their end in the state stream, so a mover ends up in the same
+ * spot no matter how far either stream has been advanced, and prev()
+ * can be answered by moving the movers around the instant in question. */
 struct evmrul_s {
 	echs_evstrm_class_t class;
 	echs_evstrm_t movers;
 	echs_evstrm_t states;
 	mrulsp_t mr;
-	/* aux event stack */
-	struct eq_s aux[1U];
 };
 
-static inline void
-push_event(struct eq_s *restrict q, echs_event_t e)
-{
-	q->e[q->i++] = e;
-	return;
-}
-
-static inline echs_event_t
-pop_event(struct eq_s *restrict q)
-{
-	if (UNLIKELY(q->i == 0U)) {
-		return echs_nul_event();
-	}
-	return q->e[--q->i];
-}
-
 static inline __attribute__((const, pure)) bool
 aux_blocks_p(mrulsp_t mr, echs_event_t aux)
 {
@@ -85,40 +66,80 @@ aux_blocks_p(mrulsp_t mr, echs_event_t aux)
 }
 
 static echs_event_t
-pop_aux_event(struct evmrul_s *restrict s)
+move_past(const struct evmrul_s *this, echs_event_t res)
 {
-	echs_event_t res;
+/* move RES into the past, straight in front of the states that block
+ * it, by looking behind in the state stream, the state stream itself
+ * is never advanced so RES is moved the same way no matter when */
+	echs_instant_t t = echs_instant_add(res.from, res.dur);
+	echs_event_t aux;
 
-	if (!echs_nul_event_p(res = pop_event(s->aux))) {
-		return res;
-	} else if (UNLIKELY(s->states == NULL)) {
+	if (UNLIKELY(this->states == NULL)) {
 		return res;
 	}
-	return echs_evstrm_pop(s->states);
+	while (!echs_event_0_p(aux = echs_evstrm_prev(this->states, t))) {
+		echs_instant_t aux_til = echs_instant_add(aux.from, aux.dur);
+
+		if (echs_instant_le_p(aux_til, res.from)) {
+			/* no danger then aye */
+			break;
+		} else if (aux_blocks_p(this->mr, aux)) {
+			/* ah, we need to move RES just before AUX.FROM */
+			res.from = echs_instant_add(
+				aux.from, echs_idiff_neg(res.dur));
+		}
+		/* states before AUX might block RES (still) */
+		t = echs_instant_detach_scale(aux.from);
+	}
+	return res;
 }
 
-static void
-push_aux_event(struct evmrul_s *restrict s, echs_event_t e)
+static echs_event_t
+move_futu(const struct evmrul_s *this, echs_event_t res)
 {
-	if (UNLIKELY(!aux_blocks_p(s->mr, e))) {
-		return;
+/* move RES into the future, straight behind the states that block it,
+ * like move_past() every slot is checked by looking behind its end */
+	echs_instant_t t = echs_instant_add(res.from, res.dur);
+	echs_event_t aux;
+
+	if (UNLIKELY(this->states == NULL)) {
+		return res;
 	}
-	push_event(s->aux, e);
-	return;
+	while (!echs_event_0_p(aux = echs_evstrm_prev(this->states, t))) {
+		echs_instant_t aux_til = echs_instant_add(aux.from, aux.dur);
+
+		if (echs_instant_le_p(aux_til, res.from)) {
+			/* RES fits */
+			break;
+		} else if (aux_blocks_p(this->mr, aux)) {
+			/* no fittee, try right after AUX */
+			res.from = aux_til;
+			t = echs_instant_add(res.from, res.dur);
+		} else {
+			/* just noise, look further back */
+			t = echs_instant_detach_scale(aux.from);
+		}
+	}
+	return res;
 }
 
-
+
 static echs_event_t next_evmrul_past(echs_evstrm_t, bool popp);
 static echs_event_t next_evmrul_futu(echs_evstrm_t, bool popp);
 static void free_evmrul(echs_evstrm_t);
 static echs_evstrm_t clone_evmrul(echs_const_evstrm_t);
 static void send_evmrul(int, echs_const_evstrm_t);
+static void seek_evmrul_past(echs_evstrm_t, echs_instant_t);
+static echs_event_t prev_evmrul_past(echs_const_evstrm_t, echs_instant_t);
+static echs_event_t prev_evmrul_futu(echs_const_evstrm_t, echs_instant_t);
 
 static const struct echs_evstrm_class_s evmrul_past_cls = {
 	.next = next_evmrul_past,
 	.free = free_evmrul,
 	.clone = clone_evmrul,
 	.seria = send_evmrul,
+	.seek = seek_evmrul_past,
+	.prev = prev_evmrul_past,
 };
 
 static const struct echs_evstrm_class_s evmrul_futu_cls = {
@@ -126,79 +147,27 @@ static const struct echs_evstrm_class_s evmrul_futu_cls = {
 	.free = free_evmrul,
 	.clone = clone_evmrul,
 	.seria = send_evmrul,
+	.prev = prev_evmrul_futu,
 };
 
+static struct echs_slab_s evmrul_slab = ECHS_SLAB_INIT("evmrul");
+
 static echs_event_t
 next_evmrul_past(echs_evstrm_t s, bool popp)
 {
 /* this is for past movers only at the moment
  * we take the next event from the to-be-moved stream (the movers) and
- * the current event from the auxiliary stream (the states) and if the
- * former is currently blocked by the latter, move it straight in front
- * of the states. */
+ * if it is blocked by the auxiliary stream (the states), move it
+ * straight in front of the states. */
 	struct evmrul_s *restrict this = (struct evmrul_s*)s;
 	echs_event_t res = echs_evstrm_next(this->movers);
-	echs_event_t aux = pop_aux_event(this);
-	echs_instant_t res_til = echs_instant_add(res.from, res.dur);
-	echs_instant_t aux_til;
-
-	if (UNLIKELY(echs_nul_event_p(aux))) {
-		goto pop;
-	} else if (echs_instant_le_p(res_til, aux.from)) {
-		/* no danger then aye */
-		goto out;
-	}
-	/* invariant: AUX.FROM < TIL */
-	/* fast forward to the event that actually blocks RES */
-	do {
-		/* get next blocking event */
-		echs_event_t nex = pop_aux_event(this);
-		echs_idiff_t and;
-
-		aux_til = echs_instant_add(aux.from, aux.dur);
-		if (UNLIKELY(echs_nul_event_p(nex))) {
-			/* state stream and event cache are finished,
-			 * prepare to go to short-circuiting mode,
-			 * RES will fit trivially between PREV_AUX and
-			 * the most-distant event in the future */
-			free_echs_evstrm(this->states);
-			this->states = NULL;
-
-			if (echs_instant_le_p(aux_til, res.from)) {
-				/* the invariant before the loop does not
-				 * guarantee that AUX_TIL <= RES.FROM */
-				return res;
-			}
-			break;
-		}
 
-		and = echs_instant_diff(nex.from, aux_til);
-		/* check if RES would fit between AUX and NEX */
-		if (echs_idiff_le_p(res.dur, and)) {
-			/* yep, would fit, forget about aux */
-			if (!aux_blocks_p(this->mr, aux = nex)) {
-				/* it's just noise though */
-				goto out;
-			}
-		} else if (aux_blocks_p(this->mr, nex)) {
-			/* no fittee, `extend' aux */
-			aux_til = echs_instant_add(nex.from, nex.dur);
-		}
-	} while (echs_instant_le_p(aux_til, res.from));
-	/* invariant RES.FROM < RES_TIL
-	 * check if RES is entirely before AUX we're on our way */
-	if (!echs_instant_le_p(res_til, aux.from)) {
-		/* ah, we need to move RES just before AUX.FROM */
-		res.from = echs_instant_add(aux.from, echs_idiff_neg(res.dur));
-	}
-out:
-	/* better save what we've got */
-	push_aux_event(this, aux);
-pop:
-	if (popp) {
+	if (UNLIKELY(echs_event_0_p(res))) {
+		return res;
+	} else if (popp) {
 		(void)echs_evstrm_pop(this->movers);
 	}
-	return res;
+	return move_past(this, res);
 }
 
 static echs_event_t
@@ -208,76 +177,96 @@ next_evmrul_futu(echs_evstrm_t s, bool popp)
  * Same idea as the past movers but move mover event into the future. */
 	struct evmrul_s *restrict this = (struct evmrul_s*)s;
 	echs_event_t res = echs_evstrm_next(this->movers);
-	echs_event_t aux = pop_aux_event(this);
-	echs_instant_t res_til = echs_instant_add(res.from, res.dur);
-	echs_instant_t aux_til;
 
-	if (UNLIKELY(echs_nul_event_p(aux))) {
-		goto pop;
+	if (UNLIKELY(echs_event_0_p(res))) {
+		return res;
+	} else if (popp) {
+		(void)echs_evstrm_pop(this->movers);
 	}
+	return move_futu(this, res);
+}
 
-	/* fast forward to the event that actually blocks RES */
-	while (aux_til = echs_instant_add(aux.from, aux.dur),
-	       echs_instant_le_p(aux_til, res.from)) {
-		aux = pop_aux_event(this);
-		if (UNLIKELY(echs_nul_event_p(aux))) {
-			/* state stream and event cache are finished,
-			 * prepare to go to short-circuiting mode,
-			 * RES will fit trivially between PREV_AUX and
-			 * the most-distant event in the future */
-			free_echs_evstrm(this->states);
-			this->states = NULL;
-			return res;
-		}
+static void
+seek_evmrul_past(echs_evstrm_t s, echs_instant_t from)
+{
+/* past movers only ever move events further into the past, so movers
+ * that start before FROM will end up before FROM, just seek the movers.
+ * Future movers could be moved past FROM and are left to the generic
+ * seeker. */
+	struct evmrul_s *restrict this = (struct evmrul_s*)s;
+
+	echs_evstrm_seek(this->movers, from);
+	return;
+}
+
+static echs_event_t
+prev_evmrul_past(echs_const_evstrm_t s, echs_instant_t before)
+{
+/* the last mover before BEFORE stays before it, movers at or after
+ * BEFORE might be moved in front of it though, those form a run right
+ * after BEFORE and the last of the run is what we're after */
+	const struct evmrul_s *this = (const struct evmrul_s*)s;
+	echs_event_t res = echs_evstrm_prev(this->movers, before);
+	echs_instant_t hi = echs_max_instant();
+	bool runp = false;
+	echs_evstrm_t clon;
+
+	if (!echs_event_0_p(res)) {
+		res = move_past(this, res);
 	}
-	/* invariant: RES.FROM < AUX.TILL */
-	if (echs_instant_le_p(res_til, aux.from)) {
-		/* no danger then aye */
-		goto out;
-	} else if (!aux_blocks_p(this->mr, aux)) {
-		/* not even blocked by aux */
-		goto out;
+	if (UNLIKELY((clon = clone_echs_evstrm(this->movers)) == NULL)) {
+		return res;
 	}
+	/* go through the movers yet to come, from BEFORE onwards */
+	echs_evstrm_seek(clon, before);
+	for (echs_event_t e; !echs_event_0_p(e = echs_evstrm_pop(clon));) {
+		echs_event_t r = move_past(this, e);
 
-	/* invariant: AUX.FROM < RES_TIL */
-	do {
-		/* get next blocking event */
-		echs_event_t nex = pop_aux_event(this);
-		echs_idiff_t and;
-
-		if (UNLIKELY(echs_nul_event_p(nex))) {
-			/* state stream and event cache are finished,
-			 * prepare to go to short-circuiting mode,
-			 * RES will fit trivially between PREV_AUX and
-			 * the most-distant event in the future */
-			free_echs_evstrm(this->states);
-			this->states = NULL;
+		if (!echs_event_before_p(r, before)) {
+			hi = echs_instant_detach_scale(e.from);
 			break;
 		}
+		res = r;
+		runp = true;
+	}
+	free_echs_evstrm(clon);
+	if (runp) {
+		return res;
+	}
+	/* the run, if any, ends among the movers popped already */
+	for (echs_event_t e;
+	     !echs_event_0_p(e = echs_evstrm_prev(this->movers, hi)) &&
+		     !echs_event_before_p(e, before);
+	     hi = echs_instant_detach_scale(e.from)) {
+		echs_event_t r = move_past(this, e);
 
-		/* check if RES would fit between AUX and NEX */
-		and = echs_instant_diff(nex.from, aux_til);
-		if (echs_idiff_le_p(res.dur, and)) {
-			/* yep, would fit, forget about nex */
-			push_aux_event(this, nex);
-			break;
-		} else if (aux_blocks_p(this->mr, nex)) {
-			/* no fittee, `extend' aux */
-			aux_til = echs_instant_add(nex.from, nex.dur);
+		if (echs_event_before_p(r, before)) {
+			return r;
 		}
-	} while (1);
-	/* invariant AUX.TILL + (RES.TILL - RES.FROM) <= NEX.FROM */
-	res.from = aux_til;
-out:
-	/* better save what we've got */
-	push_aux_event(this, aux);
-pop:
-	if (popp) {
-		(void)echs_evstrm_pop(this->movers);
 	}
 	return res;
 }
 
+static echs_event_t
+prev_evmrul_futu(echs_const_evstrm_t s, echs_instant_t before)
+{
+/* future movers at or after BEFORE stay behind it, so walk back
+ * from BEFORE until a mover isn't moved beyond it */
+	const struct evmrul_s *this = (const struct evmrul_s*)s;
+	echs_instant_t hi = before;
+
+	for (echs_event_t e;
+	     !echs_event_0_p(e = echs_evstrm_prev(this->movers, hi));
+	     hi = echs_instant_detach_scale(e.from)) {
+		echs_event_t r = move_futu(this, e);
+
+		if (echs_event_before_p(r, before)) {
+			return r;
+		}
+	}
+	return echs_nul_event();
+}
+
 static void
 free_evmrul(echs_evstrm_t s)
 {
@@ -287,7 +276,7 @@ free_evmrul(echs_evstrm_t s)
 	if (LIKELY(this->states != NULL)) {
 		free_echs_evstrm(this->states);
 	}
-	free(this);
+	echs_slab_free(&evmrul_slab, this);
 	return;
 }
 
@@ -295,7 +284,7 @@ static echs_evstrm_t
 clone_evmrul(echs_const_evstrm_t s)
 {
 	const struct evmrul_s *this = (const struct evmrul_s*)s;
-	struct evmrul_s *clon = malloc(sizeof(*this));
+	struct evmrul_s *clon = echs_slab_alloc(&evmrul_slab, sizeof(*this));
 
 	if (UNLIKELY(clon == NULL)) {
 		return NULL;
@@ -338,7 +327,7 @@ make_evmrul(const mrulsp_t *mr, echs_evstrm_t mov, echs_evstrm_t aux)
 		return NULL;
 	}
 	/* otherwise ... */
-	res = malloc(sizeof(*res));
+	res = echs_slab_alloc(&evmrul_slab, sizeof(*res));
 	if (UNLIKELY(res == NULL)) {
 		goto err;
 	}
@@ -352,14 +341,13 @@ make_evmrul(const mrulsp_t *mr, echs_evstrm_t mov, echs_evstrm_t aux)
 		res->class = &evmrul_futu_cls;
 		break;
 	default:
-		free(res);
+		echs_slab_free(&evmrul_slab, res);
 	err:
 		return NULL;
 	}
 	res->movers = mov;
 	res->states = aux;
 	res->mr = *mr;
-	memset(res->aux, 0, sizeof(res->aux));
 	return (echs_evstrm_t)res;
 }
 
@@ -38,8 +38,10 @@
 # include "config.h"
 #endif	/* HAVE_CONFIG_H */
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include "evrrul.h"
+#include "bdcal.h"
 #include "nifty.h"
 
 struct md_s {
@@ -51,33 +53,6 @@ static const unsigned int mdays[] = {
 	0U, 31U, 28U, 31U, 30U, 31U, 30U, 31U, 31U, 30U, 31U, 30U, 31U,
 };
 
-#define M	(MON)
-#define T	(TUE)
-#define W	(WED)
-#define R	(THU)
-#define F	(FRI)
-#define A	(SAT)
-#define S	(SUN)
-
-static const echs_wday_t __jan01_28y_wday[] = {
-	/* 1904 - 1910 */
-	F, S, M, T, W, F, A,
-	/* 1911 - 1917 */
-	S, M, W, R, F, A, M,
-	/* 1918 - 1924 */
-	T, W, R, A, S, M, T,
-	/* 1925 - 1931 */
-	R, F, A, S, T, W, R,
-};
-
-#undef M
-#undef T
-#undef W
-#undef R
-#undef F
-#undef A
-#undef S
-
 /* we can enumerate the cross product of time components */
 struct enum_s {
 	size_t nel;
@@ -99,6 +74,12 @@ struct enum_s {
 
 
 /* generic date converters */
+static inline __attribute__((const, pure)) bool
+__leapp(unsigned int y)
+{
+	return !(y % 4U) && (y % 100U || !(y % 400U));
+}
+
 static __attribute__((const, pure)) echs_wday_t
 ymd_get_wday(unsigned int y, unsigned int m, unsigned int d)
 {
@@ -130,7 +111,7 @@ ymd_get_yd(unsigned int y, unsigned int m, unsigned int d)
 		31, 59, 90, 120, 151, 181,
 		212, 243, 273, 304, 334, 365
 	};
-	return __mon_yday[m] + d + UNLIKELY(!(y % 4U)/*leapp(year)*/ && m >= 3);
+	return __mon_yday[m] + d + UNLIKELY(__leapp(y) && m >= 3);
 }
 
 static __attribute__((const, pure)) inline unsigned int
@@ -139,7 +120,7 @@ __get_ndom(unsigned int y, unsigned int m)
 /* return the number of days in month M in year Y. */
 	unsigned int res = mdays[m];
 
-	if (UNLIKELY(!(y % 4U) && m == 2U)) {
+	if (UNLIKELY(__leapp(y) && m == 2U)) {
 		res++;
 	}
 	return res;
@@ -194,7 +175,7 @@ ymcw_get_dom(unsigned int y, unsigned int m, int c, echs_wday_t w)
 	 * this is a simple modulo subtraction */
 	add = ((unsigned int)w + 7U - (unsigned int)wd1) % 7U;
 	if ((tgtd = 1U + add + (c - 1) * 7U) > mdays[m]) {
-		if (UNLIKELY(tgtd == 29U && !(y % 4U))) {
+		if (UNLIKELY(tgtd == 29U && __leapp(y))) {
 			/* ah, leap year innit
 			 * no need to check for Feb because months are
 			 * usually longer than 29 days and we wouldn't be
@@ -210,10 +191,8 @@ ymcw_get_dom(unsigned int y, unsigned int m, int c, echs_wday_t w)
 static inline __attribute__((pure)) echs_wday_t
 get_jan01_wday(unsigned int year)
 {
-/* get the weekday of jan01 in YEAR
- * using the 28y cycle thats valid till the year 2399
- * 1920 = 16 mod 28 */
-	return __jan01_28y_wday[year % 28U];
+/* get the weekday of jan01 in YEAR */
+	return ymd_get_wday(year, 1U, 1U);
 }
 
 static int
@@ -231,22 +210,10 @@ ywd_get_jan01_hang(echs_wday_t j01)
 static inline __attribute__((const, pure))  unsigned int
 get_isowk(unsigned int y)
 {
-	switch (y % 28U) {
-	default:
-		break;
-	case 16:
-		/* 1920, 1948, ... */
-	case 21:
-		/* 1925, 1953, ... */
-	case 27:
-		/* 1931, 1959, ... */
-	case 4:
-		/* 1936, 1964, ... */
-	case 10:
-		/* 1942, 1970, ... */
-		return 53;
-	}
-	return 52;
+/* years starting on a Thu, or leap years starting on a Wed, have 53 */
+	const echs_wday_t j01 = get_jan01_wday(y);
+
+	return 52U + (j01 == THU || (j01 == WED && __leapp(y)));
 }
 
 static unsigned int
@@ -279,7 +246,7 @@ yd_to_md(unsigned int y, int doy)
 	unsigned int cake;
 
 	if (UNLIKELY(doy < 0)) {
-		doy += 366 + !(y % 4U);
+		doy += 366 + __leapp(y);
 	}
 
 	/* get 32-adic doys */
@@ -289,7 +256,7 @@ yd_to_md(unsigned int y, int doy)
 	cake = GET_REM(m + 1);
 
 	/* put leap years into cake */
-	if (UNLIKELY(!(y % 4U)/*leapp(y)*/ && cake < 16U)) {
+	if (UNLIKELY(__leapp(y) && cake < 16U)) {
 		/* note how all leap-affected cakes are < 16 */
 		beef += beef < 16U;
 		cake++;
@@ -346,7 +313,7 @@ ycw_get_yday(unsigned int y, int c, echs_wday_t w)
 		case 0:
 			return res;
 		case 1:
-			if (UNLIKELY(!(y % 4U)/*leap year*/)) {
+			if (UNLIKELY(__leapp(y))) {
 				return res;
 			}
 			break;
@@ -373,7 +340,7 @@ easter_get_yday(unsigned int y)
 	e = e - ((y % 7U) + b - d + e + 2) % 7U;
 	/* e is expressed in terms of Mar, so add the days till 01/Mar
 	 * to obtain the doy */
-	return e + 59 + !(y % 4U);
+	return e + 59 + __leapp(y);
 }
 
 static unsigned int
@@ -445,6 +412,28 @@ make_enum(struct enum_s *restrict tgt, echs_instant_t proto, rrulsp_t rr)
 	return 0;
 }
 
+static void
+cc_enum(struct enum_s *restrict tgt, echs_instant_t proto,
+	const struct rrulcc_s *cc)
+{
+	if ((tgt->nH = cc->nH)) {
+		memcpy(tgt->H, cc->H, cc->nH);
+	} else {
+		tgt->H[tgt->nH++] = (uint8_t)proto.H;
+	}
+	if ((tgt->nM = cc->nM)) {
+		memcpy(tgt->M, cc->M, cc->nM);
+	} else {
+		tgt->M[tgt->nM++] = (uint8_t)proto.M;
+	}
+	if ((tgt->nS = cc->nS)) {
+		memcpy(tgt->S, cc->S, cc->nS);
+	} else {
+		tgt->S[tgt->nS++] = (uint8_t)proto.S;
+	}
+	return;
+}
+
 static bool
 md_match_p(struct md_s md, bituint31_t m, bitint31_t d)
 {
@@ -568,8 +557,8 @@ fill_yly_yd(
 		    !((wd_mask >> yd_get_wday(y, yd)) & 0b1U)) {
 			/* weekday is masked out */
 			continue;
-		} else if (!(md = yd_to_md(y, yd)).m) {
-			/* something's wrong again */
+		} else if (!(md = yd_to_md(y, yd)).m || md.m > 12U) {
+			/* something's wrong again, or yd 366 in a common year */
 			continue;
 		}
 		/* otherwise it's looking good */
@@ -594,7 +583,7 @@ fill_yly_yd_all(bitint383_t *restrict c, const unsigned int y, uint8_t wd_mask)
 	/* just go through all days of the year keeping track of
 	 * the week day*/
 	for (unsigned int yd = 1U, w = ymd_get_wday(y, 1U, 1U),
-		     nyd = (y % 4U) ? 365U : 366U;
+		     nyd = 365U + __leapp(y);
 	     yd <= nyd; yd++, w = inc_wd((echs_wday_t)w), md = inc_md(md, y)) {
 		if (!((wd_mask >> w) & 0b1U)) {
 			/* weekday is masked out */
@@ -790,37 +779,26 @@ static void
 clr_poss(bitint383_t *restrict cand, const bitint383_t *poss)
 {
 	bitint383_t res = {0U};
-	bitint_iter_t ci = 0UL;
+	size_t nbits;
 	int pos;
-	int prev = 0;
-	unsigned int nbits = 0U;
 
 	if (!bi383_has_bits_p(poss)) {
 		/* nothing to do */
 		return;
 	}
-	for (bitint_iter_t posi = 0UL;
-	     (pos = bi383_next(&posi, poss), posi); prev = pos) {
-		int c = 0;
+	nbits = bi383_cnt(cand);
+	for (bitint_iter_t posi = 0UL; (pos = bi383_next(&posi, poss), posi);) {
+		int c;
 
 		if (pos < 0) {
-			if (!nbits) {
-				/* quickly count them bits, singleton */
-				for (bitint_iter_t cnti = 0UL;
-				     (bi383_next(&cnti, cand), cnti); nbits++);
-			}
-			pos = nbits + pos + 1;
+			pos += (int)nbits + 1;
 		}
-		if (prev > pos) {
-			/* reset ci */
-			ci = 0UL;
-			prev = 0;
+		if (pos <= 0 || (size_t)pos > nbits) {
+			/* no such candidate */
+			continue;
 		}
-		/* just shave bits off of cand */
-		for (int p = pos - prev;
-		     p > 0 && (c = bi383_next(&ci, cand), ci); p--);
 		/* assign if successful */
-		if (LIKELY(c > 0)) {
+		if (LIKELY((c = bi383_nth(cand, pos - 1)) > 0)) {
 			ass_bi383(&res, c);
 		}
 	}
@@ -830,7 +808,64 @@ clr_poss(bitint383_t *restrict cand, const bitint383_t *poss)
 }
 
 static void
-shift(bitint383_t cand[static 3U], const unsigned int y, echs_shift_t sh)
+shift_bdcal(
+	bitint383_t cand[static 3U], const unsigned int y,
+	echs_shift_t sh, obint_t cal)
+{
+/* business day shifts as rank and select on the business days of CAL */
+	const int b = echs_shift_bvalue(sh);
+	const int adj = b && !echs_shift_inv_p(sh);
+	bitint383_t res[3U] = {0U};
+	int c;
+
+	for (int iy = -1; iy <= 1; iy++) {
+		for (bitint_iter_t ci = 0UL;
+		     (c = bi383_next(&ci, &cand[(iy != 0) << (iy > 0)]), ci);) {
+			unsigned int nu_y = y + iy;
+			const bitset383_t *bd = echs_bdcal_year(cal, nu_y);
+			int r;
+
+			if (UNLIKELY(bd == NULL)) {
+				continue;
+			}
+			/* number of business days before C */
+			r = bs383_rank(bd, c);
+			if (bs383_has_bit_p(bd, c)) {
+				r += b;
+			} else if (!echs_shift_neg_p(sh)) {
+				/* the next business day is the first */
+				r += b - adj;
+			} else {
+				/* the previous business day is the first */
+				r += b - 1 + adj;
+			}
+			/* spill over into adjacent years */
+			while (r < 0 && nu_y + 1U >= y) {
+				bd = echs_bdcal_year(cal, --nu_y);
+				r += bs383_rank(bd, 384U);
+			}
+			while (r >= (int)bs383_rank(bd, 384U) && nu_y <= y + 1U) {
+				r -= bs383_rank(bd, 384U);
+				bd = echs_bdcal_year(cal, ++nu_y);
+			}
+			if (UNLIKELY(nu_y + 1U < y || nu_y > y + 1U)) {
+				/* too far off */
+				continue;
+			} else if (UNLIKELY((c = bs383_select(bd, r)) < 0)) {
+				continue;
+			}
+			/* assign now */
+			ass_bi383(&res[(nu_y != y) << (nu_y > y)], c);
+		}
+	}
+	memcpy(cand, res, sizeof(res));
+	return;
+}
+
+static void
+shift(
+	bitint383_t cand[static 3U], const unsigned int y,
+	echs_shift_t sh, obint_t cal)
 {
 
 	if (LIKELY(!sh)) {
@@ -870,89 +905,198 @@ shift(bitint383_t cand[static 3U], const unsigned int y, echs_shift_t sh)
 		}
 		memcpy(cand, res, sizeof(res));
 	}
-	if (echs_shift_bday_p(sh)) {
+	if (echs_shift_bday_p(sh) && cal) {
+		/* holidays */
+		shift_bdcal(cand, y, sh, cal);
+	} else if (echs_shift_bday_p(sh)) {
 		/* business day shifts */
 		const int b = echs_shift_bvalue(sh);
 		bitint383_t res[3U] = {0U};
 		int c;
 
-		if (UNLIKELY(echs_shift_dvalue(sh))) {
-			/* merge all the off-year candidates from above */
-			for (size_t i = 0U; i < countof(res->pos); i++) {
-				cand[0U].pos[i] ^= cand[1U].pos[i];
-				cand[0U].neg[i] ^= cand[1U].neg[i];
-			}
-			for (size_t i = 0U; i < countof(res->pos); i++) {
-				cand[0U].pos[i] ^= cand[2U].pos[i];
-				cand[0U].neg[i] ^= cand[2U].neg[i];
-			}
-		}
-
-		/* go through candidates and shift */
-		for (bitint_iter_t ci = 0UL; (c = bi383_next(&ci, cand), ci);) {
-			const struct md_s md = unpack_cand(c);
-			int nu_d = md.d;
-			int nu_m = md.m;
-			unsigned int nu_y = y;
-			echs_wday_t w = ymd_get_wday(nu_y, nu_m, nu_d);
-			unsigned int u5, u7;
-			int nu_b = b;
-
-			if (w >= SAT) {
-				if (!echs_shift_neg_p(sh)) {
-					/* move to MON */
-					nu_d += 8 - w;
-					w = MON;
-					nu_b -= b && !echs_shift_inv_p(sh);
-				} else {
-					/* move to FRI */
-					nu_d -= w - 5;
-					w = FRI;
-					nu_b += b && !echs_shift_inv_p(sh);
-				}
-			}
-			/* 384 == -1 == 4 mod 5  384 == -1 == 6 mod 7 */
-			u5 = (w + 384 + nu_b) % 5U;
-			nu_b = nu_b / 5 * 7 + nu_b % 5;
-			u7 = (w + 384 + nu_b) % 7U;
-			/* u5 is the day we want to be on, Mon=0
-			 * u7 is the day we land on, Mon=0 */
-			nu_d += nu_b;
-			nu_d += u5 - u7;
-			nu_d += nu_b > 0 && u5 < u7 ? 7 : 0;
-
-		reassessB:
-			if (UNLIKELY(nu_d <= 0)) {
-				/* fixup, innit */
-				if (UNLIKELY(--nu_m <= 0)) {
-					nu_m += 12, nu_y--;
+		/* go through candidates and shift, the off-year ones
+		 * from above included */
+		for (int iy = -1; iy <= 1; iy++) {
+			for (bitint_iter_t ci = 0UL;
+			     (c = bi383_next(&ci, &cand[(iy != 0) << (iy > 0)]), ci);) {
+				const struct md_s md = unpack_cand(c);
+				int nu_d = md.d;
+				int nu_m = md.m;
+				unsigned int nu_y = y + iy;
+				echs_wday_t w = ymd_get_wday(nu_y, nu_m, nu_d);
+				unsigned int u5, u7;
+				int nu_b = b;
+
+				if (w >= SAT) {
+					if (!echs_shift_neg_p(sh)) {
+						/* move to MON */
+						nu_d += 8 - w;
+						w = MON;
+						nu_b -= b && !echs_shift_inv_p(sh);
+					} else {
+						/* move to FRI */
+						nu_d -= w - 5;
+						w = FRI;
+						nu_b += b && !echs_shift_inv_p(sh);
+					}
 				}
-				nu_d += __get_ndom(nu_y, nu_m);
-				goto reassessB;
-			} else if (UNLIKELY(nu_d > (int)__get_ndom(nu_y, nu_m))) {
-				/* fixup too, grrr */
-				nu_d -= __get_ndom(nu_y, nu_m);
-				if (UNLIKELY(++nu_m > 12)) {
-					nu_m -= 12, nu_y++;
+				/* 384 == -1 == 4 mod 5  384 == -1 == 6 mod 7 */
+				u5 = (w + 384 + nu_b) % 5U;
+				nu_b = nu_b / 5 * 7 + nu_b % 5;
+				u7 = (w + 384 + nu_b) % 7U;
+				/* u5 is the day we want to be on, Mon=0
+				 * u7 is the day we land on, Mon=0 */
+				nu_d += nu_b;
+				nu_d += u5 - u7;
+				nu_d += nu_b > 0 && u5 < u7 ? 7 : 0;
+
+			reassessB:
+				if (UNLIKELY(nu_d <= 0)) {
+					/* fixup, innit */
+					if (UNLIKELY(--nu_m <= 0)) {
+						nu_m += 12, nu_y--;
+					}
+					nu_d += __get_ndom(nu_y, nu_m);
+					goto reassessB;
+				} else if (UNLIKELY(nu_d > (int)__get_ndom(nu_y, nu_m))) {
+					/* fixup too, grrr */
+					nu_d -= __get_ndom(nu_y, nu_m);
+					if (UNLIKELY(++nu_m > 12)) {
+						nu_m -= 12, nu_y++;
+					}
+					goto reassessB;
 				}
-				goto reassessB;
+				/* assign now */
+				ass_bi383(&res[(nu_y != y) << (nu_y > y)], pack_cand(nu_m, nu_d));
 			}
-			/* assign now */
-			ass_bi383(&res[(nu_y != y) << (nu_y > y)], pack_cand(nu_m, nu_d));
 		}
 		memcpy(cand, res, sizeof(res));
 	}
 	return;
 }
 
-
-size_t
-rrul_fill_yly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
+/* year templates
+ * The candidate sets of yearly and monthly rules depend on the rule and
+ * on a couple of properties of the year only, so rather than filling
+ * them every period we keep the final sets (after BYSETPOS and SHIFT)
+ * in a direct-mapped cache keyed by rule and year type. */
+#define YTPL_NSLOT	(256U)
+
+struct ytpl_key_s {
+	/* the rule bits that go into the candidate sets */
+	bitint31_t dom;
+	bitint383_t doy;
+	bitint447_t dow;
+	bituint31_t mon;
+	bitint63_t wk;
+	bitint383_t pos;
+	bitint383_t easter;
+	echs_shift_t shift;
+	/* first month and day and the number of days, as they may be
+	 * defaulted from the proto */
+	unsigned int m0;
+	int d0;
+	size_t nd;
+	/* the year type and the month for monthly rules */
+	uint32_t yt;
+	unsigned int mo;
+	/* hash of the rule bits and of the whole key */
+	uint64_t hr;
+	uint64_t h;
+};
+
+static struct ytpl_s {
+	struct ytpl_key_s k;
+	bitint383_t cand[3U];
+} ytpl[YTPL_NSLOT];
+
+static uint64_t
+ytpl_hash(uint64_t h, const void *p, size_t z)
 {
-	const echs_scale_t srcsca = rr->scale;
-	const echs_instant_t protr = echs_instant_rescale(*tgt, srcsca);
-	const echs_instant_t proto = echs_instant_detach_scale(protr);
-	unsigned int y = proto.y;
+/* fnv-1a */
+	const uint8_t *b = p;
+
+	for (size_t i = 0U; i < z; i++) {
+		h ^= b[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static void
+ytpl_key(
+	struct ytpl_key_s *restrict k, rrulsp_t rr,
+	unsigned int m0, int d0, size_t nd)
+{
+	/* zero the padding, keys are compared bytewise */
+	memset(k, 0, sizeof(*k));
+	k->dom = rr->dom;
+	k->doy = rr->doy;
+	k->dow = rr->dow;
+	k->mon = rr->mon;
+	k->wk = rr->wk;
+	k->pos = rr->pos;
+	k->easter = rr->easter;
+	k->shift = rr->shift;
+	k->m0 = m0;
+	k->d0 = d0;
+	k->nd = nd;
+	k->hr = ytpl_hash(0xcbf29ce484222325ULL, k, offsetof(struct ytpl_key_s, yt));
+	return;
+}
+
+static uint32_t
+ytpl_ytype(unsigned int y, const struct ytpl_key_s *k)
+{
+/* the weekday of jan01 and leapness determine month lengths and ISO
+ * weeks alike, shifts may spill over into adjacent years */
+	uint32_t yt = ymd_get_wday(y, 1U, 1U);
+
+	yt |= __leapp(y) << 3U;
+	if (k->shift) {
+		yt |= __leapp(y - 1U) << 10U;
+		yt |= __leapp(y + 1U) << 11U;
+	}
+	if (bi383_has_bits_p(&k->easter)) {
+		yt |= easter_get_yday(y) << 12U;
+	}
+	return yt;
+}
+
+static bool
+ytpl_get(
+	bitint383_t cand[static 3U], struct ytpl_key_s *restrict k,
+	unsigned int y, unsigned int mo)
+{
+/* look up the candidates of K in year Y (and month MO), return true
+ * and fill CAND if cached, otherwise prepare K for ytpl_put() */
+	const struct ytpl_s *c;
+
+	k->yt = ytpl_ytype(y, k);
+	k->mo = mo;
+	k->h = ytpl_hash(k->hr, &k->yt, sizeof(k->yt));
+	k->h = ytpl_hash(k->h, &k->mo, sizeof(k->mo));
+
+	c = ytpl + k->h % YTPL_NSLOT;
+	if (c->k.h != k->h || memcmp(&c->k, k, sizeof(*k))) {
+		return false;
+	}
+	memcpy(cand, c->cand, sizeof(c->cand));
+	return true;
+}
+
+static void
+ytpl_put(const struct ytpl_key_s *k, const bitint383_t cand[static 3U])
+{
+	struct ytpl_s *c = ytpl + k->h % YTPL_NSLOT;
+
+	c->k = *k;
+	memcpy(c->cand, cand, sizeof(c->cand));
+	return;
+}
+
+/* BYMONTH, BYMONTHDAY and BYDAY unrolled for the candidate fillers */
+struct ymd_s {
 	/* unrolled month bui31 bitset */
 	unsigned int m[12U];
 	size_t nm;
@@ -961,136 +1105,270 @@ rrul_fill_yly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 	 * the biggest possible BYMONTHDAY value */
 	int d[2U * 31U];
 	size_t nd;
-	size_t res = 0UL;
-	size_t tries;
-	uint8_t wd_mask = 0U;
-	bool ymdp;
-	struct enum_s e;
+	/* wdays as bits, lsb for counted ones */
+	uint8_t wd_mask;
+	/* earliest month and day the candidates can be on */
+	unsigned int m0;
+	unsigned int d0;
+};
 
-	if (UNLIKELY((unsigned int)rr->count < nti)) {
-		if (UNLIKELY((nti = rr->count) == 0UL)) {
-			goto fin;
+static void
+make_ymd(struct ymd_s *restrict tgt, echs_instant_t proto,
+	 rrulsp_t rr, echs_freq_t freq)
+{
+/* months and days default to PROTO's if the rule is ymd only */
+	bool ymdp = !bi447_has_bits_p(&rr->dow) && !bi31_has_bits_p(rr->dom);
+	unsigned int tmpm;
+	int tmp;
+
+	if (freq == FREQ_YEARLY) {
+		/* check if we're ymd only */
+		ymdp = ymdp && !bi63_has_bits_p(rr->wk) &&
+			!bi383_has_bits_p(&rr->doy) &&
+			!bi383_has_bits_p(&rr->easter);
+	}
+
+	tgt->nm = 0UL;
+	tgt->m0 = 1U;
+	for (bitint_iter_t mi = 0U; freq == FREQ_YEARLY &&
+		     tgt->nm < countof(tgt->m) &&
+		     (tmpm = bui31_next(&mi, rr->mon), mi);
+	     tgt->m[tgt->nm++] = tmpm);
+	/* fill up with a default */
+	if (freq == FREQ_YEARLY && !tgt->nm && ymdp && proto.m) {
+		tgt->m[tgt->nm++] = tgt->m0 = proto.m;
+	}
+
+	tgt->nd = 0UL;
+	tgt->d0 = 1U;
+	for (bitint_iter_t di = 0U;
+	     tgt->nd < countof(tgt->d) && (tmp = bi31_next(&di, rr->dom), di);
+	     tgt->d[tgt->nd++] = tmp);
+	/* fill up with the default */
+	if (!tgt->nd && ymdp && proto.d) {
+		tgt->d[tgt->nd++] = tgt->d0 = proto.d;
+	}
+
+	/* set up the wday mask */
+	tgt->wd_mask = 0U;
+	for (bitint_iter_t dowi = 0UL;
+	     (tmp = bi447_next(&dowi, &rr->dow), dowi);) {
+		if (tmp >= (int)MON && tmp <= (int)SUN) {
+			tgt->wd_mask |= (uint8_t)(1U << (unsigned int)tmp);
+		} else {
+			/* use lsb of wd_mask to indicate
+			 * non-0 wday counts, as in nMO,nTU, etc. */
+			tgt->wd_mask |= 0b1U;
 		}
 	}
+	return;
+}
 
-	/* check if we're ymd only */
-	ymdp = !bi63_has_bits_p(rr->wk) &&
-		!bi447_has_bits_p(&rr->dow) &&
-		!bi383_has_bits_p(&rr->doy) &&
-		!bi383_has_bits_p(&rr->easter) &&
-		!bi31_has_bits_p(rr->dom);
+static void
+yly_cand(
+	bitint383_t cand[static 3U], unsigned int y, rrulsp_t rr,
+	const struct ymd_s *c)
+{
+	const echs_scale_t srcsca = rr->scale;
+	const unsigned int *m = c->m;
+	const size_t nm = c->nm;
+	const int *d = c->d;
+	const size_t nd = c->nd;
+	const uint8_t wd_mask = c->wd_mask;
+
+	/* stick to note 2 on page 44, RFC 5545 */
+	if (wd_mask && (nd || bi383_has_bits_p(&rr->doy))) {
+		/* yd/ymd, dealt with later */
+		;
+	} else if (wd_mask && bi63_has_bits_p(rr->wk) &&
+		   srcsca == SCALE_GREGORIAN) {
+		/* ywd */
+		fill_yly_ywd(cand, y, rr->wk, &rr->dow);
+	} else if (wd_mask && nm) {
+		/* ymcw or special expand for monthly,
+		 * see note 2 on page 44, RFC 5545 */
+		if (wd_mask & 0b1U && srcsca == SCALE_GREGORIAN) {
+			/* only start ymcw filling when we're sure
+			 * that there are non-0 counts */
+			fill_yly_ymcw(cand, y, &rr->dow, m, nm);
+		}
+		fill_yly_md_all(cand, srcsca, y, m, nm, wd_mask);
+	} else if (wd_mask && srcsca == SCALE_GREGORIAN) {
+		/* ycw or special expand for yearly,
+		 * see note 2 on page 44, RFC 5545 */
+		if (wd_mask & 0b1U) {
+			/* only start ycw filling when we're sure
+			 * that there are non-0 counts */
+			fill_yly_ycw(cand, y, &rr->dow);
+		}
+		fill_yly_yd_all(cand, y, wd_mask);
+	}
+
+	/* extend by yd */
+	if (srcsca == SCALE_GREGORIAN) {
+		fill_yly_yd(cand, y, &rr->doy, wd_mask);
+	}
+
+	/* extend by ymd */
+	if (UNLIKELY(srcsca == SCALE_GREGORIAN &&
+		     bi383_has_bits_p(&rr->easter))) {
+		/* in presence of BYEASTER MDs act as a filter
+		 * so extend by easter now */
+		fill_yly_eastr(
+			cand, y, &rr->easter,
+			rr->mon, rr->dom, wd_mask);
+	} else if (!nm && !nd) {
+		/* don't fill up any ymds */
+		;
+	} else if (!nm) {
+		fill_yly_ymd_all_m(cand, srcsca, y, d, nd, wd_mask);
+	} else if (!nd) {
+		fill_yly_ymd_all_d(cand, srcsca, y, m, nm, wd_mask);
+	} else {
+		fill_yly_ymd(cand, srcsca, y, m, nm, d, nd, wd_mask);
+	}
 
-	/* generate a set of minutes and seconds */
-	(void)make_enum(&e, proto, rr);
+	/* limit by setpos */
+	clr_poss(cand, &rr->pos);
+
+	/* do the shifts */
+	shift(cand, y, rr->shift, rr->cal);
+	return;
+}
 
-	with (unsigned int tmpm) {
-		nm = 0UL;
-		for (bitint_iter_t mi = 0U;
-		     nm < countof(m) && (tmpm = bui31_next(&mi, rr->mon), mi);
-		     m[nm++] = tmpm);
+static void
+mly_cand(
+	bitint383_t cand[static 3U], unsigned int y, unsigned int m,
+	rrulsp_t rr, const struct ymd_s *c)
+{
+	const echs_scale_t srcsca = rr->scale;
+	const int *d = c->d;
+	const size_t nd = c->nd;
+	const uint8_t wd_mask = c->wd_mask;
 
-		/* fill up with a default */
-		if (!nm && ymdp && proto.m) {
-			m[nm++] = proto.m;
+	/* stick to note 1 on page 44, RFC 5545 */
+	if (wd_mask && nd) {
+		/* ymd, dealt with later */
+		;
+	} else if (wd_mask) {
+		/* ycw or special expand for yearly,
+		 * see note 2 on page 44, RFC 5545 */
+		if (wd_mask & 0b1U && srcsca == SCALE_GREGORIAN) {
+			/* only start ycw filling when we're sure
+			 * that there are non-0 counts */
+			fill_mly_ymcw(cand, y, m, &rr->dow);
 		}
+		fill_mly_ymd_all_d(cand, srcsca, y, m, wd_mask);
 	}
-	with (int tmpd) {
-		nd = 0UL;
-		for (bitint_iter_t di = 0U;
-		     nd < nti && (tmpd = bi31_next(&di, rr->dom), di);
-		     d[nd++] = tmpd);
 
-		/* fill up with the default */
-		if (!nd && ymdp && proto.d) {
-			d[nd++] = proto.d;
-		}
+	/* extend by ymd */
+	if (nd) {
+		fill_mly_ymd(cand, srcsca, y, m, d, nd, wd_mask);
 	}
-	/* set up the wday mask */
-	with (int tmp) {
-		for (bitint_iter_t dowi = 0UL;
-		     (tmp = bi447_next(&dowi, &rr->dow), dowi);) {
-			if (tmp >= (int)MON && tmp <= (int)SUN) {
-				wd_mask |= (uint8_t)(1U << (unsigned int)tmp);
-			} else {
-				/* use lsb of wd_mask to indicate
-				 * non-0 wday counts, as in nMO,nTU, etc. */
-				wd_mask |= 0b1U;
+
+	/* limit by setpos */
+	clr_poss(cand, &rr->pos);
+
+	/* do the shifts */
+	shift(cand, y, rr->shift, rr->cal);
+	return;
+}
+
+static bool
+mly_track(unsigned int *restrict y, int *restrict m, rrulsp_t rr)
+{
+/* move Y and M to the first month of RR not before them */
+	if (UNLIKELY(bui31_has_bits_p(rr->mon))) {
+		bitint_iter_t bm = 0UL;
+
+		/* check that some of the months are congruent m modulo inter */
+		while (bui31_next(&bm, rr->mon) &&
+		       ((*m + 12U) - (bm - 1U)) % rr->inter);
+		if (UNLIKELY(!bm)) {
+			return false;
+		}
+		/* now skip to the first instance */
+		while (!bui31_has_bit_p(rr->mon, *m)) {
+			if ((*m += rr->inter) > 12) {
+				--*m;
+				*y += *m / 12;
+				*m %= 12;
+				++*m;
 			}
 		}
 	}
+	return true;
+}
+
+static void
+mly_step(unsigned int *restrict y, int *restrict m, rrulsp_t rr)
+{
+/* move Y and M to the next month of RR */
+	do {
+		if ((*m += rr->inter) > 12) {
+			--*m;
+			*y += *m / 12;
+			*m %= 12;
+			++*m;
+		}
+	} while (bui31_has_bits_p(rr->mon) && !bui31_has_bit_p(rr->mon, *m));
+	return;
+}
+
+
+size_t
+rrul_fill_yly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
+{
+	const echs_scale_t srcsca = rr->scale;
+	const echs_instant_t protr = echs_instant_rescale(*tgt, srcsca);
+	const echs_instant_t proto = echs_instant_detach_scale(protr);
+	/* groups go to the upper half of TGT */
+	echs_instant_t *const grp = tgt + nti;
+	unsigned int y = proto.y;
+	size_t res = 0UL;
+	size_t tries;
+	bool tplp;
+	struct ytpl_key_s k;
+	struct ymd_s c;
+	struct enum_s e;
+
+	if (UNLIKELY((unsigned int)rr->count < nti)) {
+		if (UNLIKELY((nti = rr->count) == 0UL)) {
+			goto fin;
+		}
+	}
+
+	/* generate a set of minutes and seconds */
+	(void)make_enum(&e, proto, rr);
+	/* and months and days */
+	make_ymd(&c, proto, rr, FREQ_YEARLY);
 
 	y -= echs_shift_dvalue(rr->shift) > 0 ||
 		echs_shift_bday_p(rr->shift) && !echs_shift_neg_p(rr->shift);
 
+	/* candidate sets only depend on the year type for gregorian rules */
+	if ((tplp = srcsca == SCALE_GREGORIAN && !rr->cal)) {
+		ytpl_key(&k, rr, c.nm ? c.m[0U] : 0U, c.nd ? c.d[0U] : 0, c.nd);
+	}
+
 	/* fill up the array the hard way */
 	for (res = 0UL, tries = 64U; res < nti && --tries; y += rr->inter) {
 		bitint383_t cand[3U] = {0U};
 		int yd;
 
-		/* stick to note 2 on page 44, RFC 5545 */
-		if (wd_mask && (nd || bi383_has_bits_p(&rr->doy))) {
-			/* yd/ymd, dealt with later */
-			;
-		} else if (wd_mask && bi63_has_bits_p(rr->wk) &&
-			   srcsca == SCALE_GREGORIAN) {
-			/* ywd */
-			fill_yly_ywd(cand, y, rr->wk, &rr->dow);
-		} else if (wd_mask && nm) {
-			/* ymcw or special expand for monthly,
-			 * see note 2 on page 44, RFC 5545 */
-			if (wd_mask & 0b1U && srcsca == SCALE_GREGORIAN) {
-				/* only start ymcw filling when we're sure
-				 * that there are non-0 counts */
-				fill_yly_ymcw(cand, y, &rr->dow, m, nm);
-			}
-			fill_yly_md_all(cand, srcsca, y, m, nm, wd_mask);
-		} else if (wd_mask && srcsca == SCALE_GREGORIAN) {
-			/* ycw or special expand for yearly,
-			 * see note 2 on page 44, RFC 5545 */
-			if (wd_mask & 0b1U) {
-				/* only start ycw filling when we're sure
-				 * that there are non-0 counts */
-				fill_yly_ycw(cand, y, &rr->dow);
-			}
-			fill_yly_yd_all(cand, y, wd_mask);
-		}
-
-		/* extend by yd */
-		if (srcsca == SCALE_GREGORIAN) {
-			fill_yly_yd(cand, y, &rr->doy, wd_mask);
-		}
-
-		/* extend by ymd */
-		if (UNLIKELY(srcsca == SCALE_GREGORIAN &&
-			     bi383_has_bits_p(&rr->easter))) {
-			/* in presence of BYEASTER MDs act as a filter
-			 * so extend by easter now */
-			fill_yly_eastr(
-				cand, y, &rr->easter,
-				rr->mon, rr->dom, wd_mask);
-		} else if (!nm && !nd) {
-			/* don't fill up any ymds */
-			;
-		} else if (!nm) {
-			fill_yly_ymd_all_m(cand, srcsca, y, d, nd, wd_mask);
-		} else if (!nd) {
-			fill_yly_ymd_all_d(cand, srcsca, y, m, nm, wd_mask);
-		} else {
-			fill_yly_ymd(cand, srcsca, y, m, nm, d, nd, wd_mask);
+		if (!tplp) {
+			yly_cand(cand, y, rr, &c);
+		} else if (!ytpl_get(cand, &k, y, 0U)) {
+			yly_cand(cand, y, rr, &c);
+			ytpl_put(&k, cand);
 		}
 
-		/* limit by setpos */
-		clr_poss(cand, &rr->pos);
-
-		/* do the shifts */
-		shift(cand, y, rr->shift);
-
 		/* now check the bitset */
 		for (int iy = -1; iy <= 1; iy++) {
 			for (bitint_iter_t all = 0UL;
 			     res < nti && (yd = bi383_next(&all, &cand[(iy != 0) << (iy > 0)]), all);) {
 				for (ENUM_INIT(e, iS, iM, iH);
-				     ENUM_COND(e, iS, iM, iH);
+				     res < nti && ENUM_COND(e, iS, iM, iH);
 				     ENUM_ITER(e, iS, iM, iH)) {
 					echs_instant_t x = {
 						.y = y + iy,
@@ -1112,7 +1390,7 @@ rrul_fill_yly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 					x = echs_instant_attach_scale(x, srcsca);
 
 					tries = 64U;
-					tgt[res + GRP_CCH_OFF] = (echs_instant_t){.y = y};
+					grp[res] = (echs_instant_t){.y = y};
 					tgt[res++] = x;
 				}
 			}
@@ -1128,17 +1406,15 @@ rrul_fill_mly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 	const echs_scale_t srcsca = rr->scale;
 	const echs_instant_t protr = echs_instant_rescale(*tgt, srcsca);
 	const echs_instant_t proto = echs_instant_detach_scale(protr);
+	/* groups go to the upper half of TGT */
+	echs_instant_t *const grp = tgt + nti;
 	unsigned int y = proto.y;
 	int m = proto.m;
-	/* unrolled day bi31, we use 2 * 31 because by monthdays can
-	 * also be denoted negatively, thus 1, -1, 2, -2, ..., 31, -31 is
-	 * the biggest possible BYMONTHDAY value */
-	int d[2U * 31U];
-	size_t nd;
 	size_t res = 0UL;
 	size_t tries;
-	uint8_t wd_mask = 0U;
-	bool ymdp;
+	bool tplp;
+	struct ytpl_key_s k;
+	struct ymd_s c;
 	struct enum_s e;
 
 	if (UNLIKELY((unsigned int)rr->count < nti)) {
@@ -1151,37 +1427,10 @@ rrul_fill_mly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 		goto fin;
 	}
 
-	/* check if we're ymd only */
-	ymdp = !bi447_has_bits_p(&rr->dow) &&
-		!bi31_has_bits_p(rr->dom);
-
 	/* generate a set of minutes and seconds */
 	(void)make_enum(&e, proto, rr);
-
-	with (int tmpd) {
-		nd = 0UL;
-		for (bitint_iter_t di = 0U;
-		     nd < nti && (tmpd = bi31_next(&di, rr->dom), di);
-		     d[nd++] = tmpd);
-
-		/* fill up with the default */
-		if (!nd && ymdp && proto.d) {
-			d[nd++] = proto.d;
-		}
-	}
-	/* set up the wday mask */
-	with (int tmp) {
-		for (bitint_iter_t dowi = 0UL;
-		     (tmp = bi447_next(&dowi, &rr->dow), dowi);) {
-			if (tmp >= (int)MON && tmp <= (int)SUN) {
-				wd_mask |= (uint8_t)(1U << (unsigned int)tmp);
-			} else {
-				/* use lsb of wd_mask to indicate
-				 * non-0 wday counts, as in nMO,nTU, etc. */
-				wd_mask |= 0b1U;
-			}
-		}
-	}
+	/* and days */
+	make_ymd(&c, proto, rr, FREQ_MONTHLY);
 
 	with (int tmp) {
 		tmp = echs_shift_dvalue(rr->shift) +
@@ -1194,75 +1443,35 @@ rrul_fill_mly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 		m = m > 0 ? m : 1;
 	}
 
-	/* get m on track */
-	if (UNLIKELY(bui31_has_bits_p(rr->mon))) {
-		bitint_iter_t bm = 0UL;
+	/* candidate sets only depend on the year type for gregorian rules */
+	if ((tplp = srcsca == SCALE_GREGORIAN && !rr->cal)) {
+		ytpl_key(&k, rr, 0U, c.nd ? c.d[0U] : 0, c.nd);
+	}
 
-		/* check that some of the months are congruent m modulo inter */
-		while (bui31_next(&bm, rr->mon) &&
-		       ((m + 12U) - (bm - 1U)) % rr->inter);
-		if (UNLIKELY(!bm)) {
-			goto fin;
-		}
-		/* now skip to the first instance */
-		while (!bui31_has_bit_p(rr->mon, m)) {
-			if ((m += rr->inter) > 12) {
-				m--;
-				y += m / 12;
-				m %= 12;
-				m++;
-			}
-		}
+	/* get m on track */
+	if (UNLIKELY(!mly_track(&y, &m, rr))) {
+		goto fin;
 	}
 
 	/* fill up the array the hard way */
 	for (res = 0UL, tries = 64U; res < nti && --tries;
-	     ({
-		     do {
-			     if ((m += rr->inter) > 12) {
-				     m--;
-				     y += m / 12;
-				     m %= 12;
-				     m++;
-			     }
-		     } while (bui31_has_bits_p(rr->mon) &&
-			      !bui31_has_bit_p(rr->mon, m));
-	     })) {
+	     mly_step(&y, &m, rr)) {
 		bitint383_t cand[3U] = {0U};
 		int yd;
 
-		/* stick to note 1 on page 44, RFC 5545 */
-		if (wd_mask && nd) {
-			/* ymd, dealt with later */
-			;
-		} else if (wd_mask) {
-			/* ycw or special expand for yearly,
-			 * see note 2 on page 44, RFC 5545 */
-			if (wd_mask & 0b1U && srcsca == SCALE_GREGORIAN) {
-				/* only start ycw filling when we're sure
-				 * that there are non-0 counts */
-				fill_mly_ymcw(cand, y, m, &rr->dow);
-			}
-			fill_mly_ymd_all_d(cand, srcsca, y, m, wd_mask);
-		}
-
-		/* extend by ymd */
-		if (nd) {
-			fill_mly_ymd(cand, srcsca, y, m, d, nd, wd_mask);
+		if (!tplp) {
+			mly_cand(cand, y, m, rr, &c);
+		} else if (!ytpl_get(cand, &k, y, m)) {
+			mly_cand(cand, y, m, rr, &c);
+			ytpl_put(&k, cand);
 		}
 
-		/* limit by setpos */
-		clr_poss(cand, &rr->pos);
-
-		/* do the shifts */
-		shift(cand, y, rr->shift);
-
 		/* now check the bitset */
 		for (int iy = -1; iy <= 1; iy++) {
 			for (bitint_iter_t all = 0UL;
 			     res < nti && (yd = bi383_next(&all, &cand[(iy != 0) << (iy > 0)]), all);) {
 				for (ENUM_INIT(e, iS, iM, iH);
-				     ENUM_COND(e, iS, iM, iH);
+				     res < nti && ENUM_COND(e, iS, iM, iH);
 				     ENUM_ITER(e, iS, iM, iH)) {
 					echs_instant_t x = {
 						.y = y + iy,
@@ -1284,7 +1493,7 @@ rrul_fill_mly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 					x = echs_instant_attach_scale(x, srcsca);
 
 					tries = 64U;
-					tgt[res + GRP_CCH_OFF] = (echs_instant_t){.y = y, .m = m};
+					grp[res] = (echs_instant_t){.y = y, .m = m};
 					tgt[res++] = x;
 				}
 			}
@@ -1294,22 +1503,37 @@ fin:
 	return res;
 }
 
-size_t
-rrul_fill_wly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
+static size_t
+kern_yly(echs_instant_t *restrict tgt, size_t nti,
+	 rrulsp_t rr, const struct rrulcc_s *UNUSED(cc))
 {
-	const echs_scale_t srcsca = rr->scale;
-	const echs_instant_t protr = echs_instant_rescale(*tgt, srcsca);
-	const echs_instant_t proto = echs_instant_detach_scale(protr);
-	unsigned int y = proto.y;
-	unsigned int m = proto.m;
-	unsigned int d = proto.d;
-	unsigned int wd_mask = 0U;
-	unsigned int m_mask = 0U;
+	return rrul_fill_yly(tgt, nti, rr);
+}
+
+static size_t
+kern_mly(echs_instant_t *restrict tgt, size_t nti,
+	 rrulsp_t rr, const struct rrulcc_s *UNUSED(cc))
+{
+	return rrul_fill_mly(tgt, nti, rr);
+}
+
+static size_t
+kern_mly_md(echs_instant_t *restrict tgt, size_t nti,
+	    rrulsp_t rr, const struct rrulcc_s *cc)
+{
+/* MONTHLY with BYMONTH and BYMONTHDAY only, the candidates of a month
+ * can be read off the day masks directly */
+	const echs_scale_t srcsca = rr->scale;
+	const echs_instant_t protr = echs_instant_rescale(*tgt, srcsca);
+	const echs_instant_t proto = echs_instant_detach_scale(protr);
+	/* groups go to the upper half of TGT */
+	echs_instant_t *const grp = tgt + nti;
+	uint_fast32_t posd_mask = cc->posd_mask;
+	uint_fast32_t negd_mask = cc->negd_mask;
+	unsigned int y = proto.y;
+	int m = proto.m;
 	size_t res = 0UL;
-	/* number of days in the current month */
-	unsigned int maxd;
-	/* increments induced by wd_mask */
-	uint_fast32_t wd_incs = 0UL;
+	size_t tries;
 	struct enum_s e;
 
 	if (UNLIKELY((unsigned int)rr->count < nti)) {
@@ -1318,44 +1542,124 @@ rrul_fill_wly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 		}
 	}
 
-	/* check ranges before filling */
-	if (UNLIKELY(!m || m > 12U || !d || d > 31U)) {
+	if (UNLIKELY(!m || m > 12)) {
 		goto fin;
 	}
 
-	/* generate a set of minutes and seconds */
-	(void)make_enum(&e, proto, rr);
+	if (!bi31_has_bits_p(rr->dom)) {
+		/* fill up with the default */
+		if (UNLIKELY(!proto.d || proto.d > 31U)) {
+			goto fin;
+		}
+		posd_mask = 1U << proto.d;
+		negd_mask = 0U;
+	}
 
-	/* set up the wday mask */
-	with (unsigned int tmp) {
-		for (bitint_iter_t dowi = 0UL;
-		     (tmp = bi447_next(&dowi, &rr->dow), dowi);) {
-			/* non-0 wday counts, as in nMO,nTU, etc.
-			 * are illegal in the WEEKLY frequency and
-			 * are ignored here */
-			if (tmp >= MON && tmp <= SUN) {
-				wd_mask |= (uint8_t)(1U << tmp);
+	/* generate a set of hours, minutes and seconds */
+	cc_enum(&e, proto, cc);
+
+	/* get m on track */
+	if (UNLIKELY(!mly_track(&y, &m, rr))) {
+		goto fin;
+	}
+
+	for (res = 0UL, tries = 64U; res < nti && --tries;
+	     mly_step(&y, &m, rr)) {
+		const unsigned int ndim = echs_scale_ndim(srcsca, y, m);
+		/* days of this month, negative ones counted off NDIM */
+		uint64_t dm = posd_mask & ((2ULL << ndim) - 2ULL);
+
+		for (uint64_t nm = negd_mask & ((1ULL << ndim) - 1ULL);
+		     nm; nm &= nm - 1U) {
+			dm |= 1ULL << (ndim - __builtin_ctzll(nm));
+		}
+
+		for (; res < nti && dm; dm &= dm - 1U) {
+			const unsigned int dd = __builtin_ctzll(dm);
+
+			for (ENUM_INIT(e, iS, iM, iH);
+			     res < nti && ENUM_COND(e, iS, iM, iH);
+			     ENUM_ITER(e, iS, iM, iH)) {
+				echs_instant_t x = {
+					.y = y,
+					.m = m,
+					.d = dd,
+					.H = e.H[iH],
+					.M = e.M[iM],
+					.S = e.S[iS],
+					.ms = proto.ms,
+				};
+
+				if (UNLIKELY(echs_instant_lt_p(rr->until, x))) {
+					goto fin;
+				}
+				if (UNLIKELY(echs_instant_lt_p(x, proto))) {
+					continue;
+				}
+				/* attach scale and convert back to greg */
+				x = echs_instant_attach_scale(x, srcsca);
+
+				tries = 64U;
+				grp[res] = (echs_instant_t){.y = y, .m = m};
+				tgt[res++] = x;
 			}
 		}
 	}
+fin:
+	return res;
+}
 
-	/* set up the month mask */
-	with (unsigned int tmp) {
-		for (bitint_iter_t moni = 0UL;
-		     (tmp = bui31_next(&moni, rr->mon), moni);) {
-			m_mask |= 1U << tmp;
+static size_t
+kern_wly(echs_instant_t *restrict tgt, size_t nti,
+	 rrulsp_t rr, const struct rrulcc_s *cc)
+{
+	const echs_scale_t srcsca = rr->scale;
+	const echs_instant_t protr = echs_instant_rescale(*tgt, srcsca);
+	const echs_instant_t proto = echs_instant_detach_scale(protr);
+	unsigned int y = proto.y;
+	unsigned int m = proto.m;
+	unsigned int d = proto.d;
+	unsigned int wd_mask = cc->wd_bits & 0b11111110U;
+	const unsigned int m_mask = cc->m_mask;
+	size_t res = 0UL;
+	/* number of days in the current month */
+	unsigned int maxd;
+	/* increments induced by wd_mask */
+	uint_fast32_t wd_incs = 0UL;
+	struct enum_s e;
+
+	if (UNLIKELY((unsigned int)rr->count < nti)) {
+		if (UNLIKELY((nti = rr->count) == 0UL)) {
+			goto fin;
 		}
 	}
 
-	if (!m_mask) {
-		/* because we're subtractive, allow all months in the m_mask if
-		 * all of the actual mask months are 0 */
-		m_mask |= 0b1111111111110U;
+	/* check ranges before filling */
+	if (UNLIKELY(!m || m > 12U || !d || d > 31U)) {
+		goto fin;
 	}
 
+	/* generate a set of minutes and seconds */
+	cc_enum(&e, proto, cc);
+
 	if (wd_mask) {
 		unsigned int w = echs_scale_wday(srcsca, y, m, d);
 
+		if (cc->wd_anchor && w != cc->wd_anchor) {
+			/* back up to the start of the period, instants
+			 * before the proto are filtered below */
+			const unsigned int b = (w + 7U - cc->wd_anchor) % 7U;
+
+			if (d <= b) {
+				if (!--m) {
+					y--;
+					m = 12U;
+				}
+				d += echs_scale_ndim(srcsca, y, m);
+			}
+			d -= b;
+			w = cc->wd_anchor;
+		}
 		/* duplicate the wd_mask so we can just right shift it
 		 * and wrap around the end of the week */
 		wd_mask |= wd_mask << 7U;
@@ -1380,7 +1684,7 @@ rrul_fill_wly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 	     ({
 		     d += rr->inter * 7U;
 		     while (d > maxd) {
-			     d--, d %= maxd, d++;
+			     d -= maxd;
 			     if (++m > 12U) {
 				     y++;
 				     m = 1U;
@@ -1408,7 +1712,7 @@ rrul_fill_wly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 			}
 
 			for (ENUM_INIT(e, iS, iM, iH);
-			     ENUM_COND(e, iS, iM, iH);
+			     res < nti && ENUM_COND(e, iS, iM, iH);
 			     ENUM_ITER(e, iS, iM, iH)) {
 				echs_instant_t x = {
 					.y = this_y,
@@ -1443,20 +1747,25 @@ fin:
 	return res;
 }
 
-size_t
-rrul_fill_dly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
+static inline __attribute__((always_inline)) size_t
+__kern_dly(
+	echs_instant_t *restrict tgt, size_t nti,
+	rrulsp_t rr, const struct rrulcc_s *cc,
+	const bool wdp, const bool mdp)
 {
 	const echs_scale_t srcsca = rr->scale;
 	const echs_instant_t protr = echs_instant_rescale(*tgt, srcsca);
 	const echs_instant_t proto = echs_instant_detach_scale(protr);
+	/* groups go to the upper half of TGT */
+	echs_instant_t *const grp = tgt + nti;
 	unsigned int y = proto.y;
 	unsigned int m = proto.m;
 	unsigned int d = proto.d;
 	size_t res = 0UL;
-	uint8_t wd_mask = 0U;
-	unsigned int m_mask = 0U;
-	uint_fast32_t posd_mask = 0U;
-	uint_fast32_t negd_mask = 0U;
+	const uint8_t wd_mask = cc->wd_mask;
+	const unsigned int m_mask = cc->m_mask;
+	const uint_fast32_t posd_mask = cc->posd_mask;
+	const uint_fast32_t negd_mask = cc->negd_mask;
 	unsigned int w;
 	/* number of days in the current month */
 	unsigned int maxd;
@@ -1473,62 +1782,8 @@ rrul_fill_dly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 		goto fin;
 	}
 
-	/* set up the wday mask */
-	with (int tmp) {
-		for (bitint_iter_t dowi = 0UL;
-		     (tmp = bi447_next(&dowi, &rr->dow), dowi);) {
-			if (tmp >= (int)MON && tmp <= (int)SUN) {
-				wd_mask |= (uint8_t)(1U << (unsigned int)tmp);
-			} else {
-				/* non-0 wday counts, as in nMO,nTU, etc.
-				 * are illegal in the DAILY frequency */
-				wd_mask |= 0b1U;
-			}
-		}
-	}
-	if (!(wd_mask >> 1U)) {
-		/* because we're subtractive, allow all days in the wd_mask if
-		 * all of the actual mask days are 0 */
-		wd_mask |= 0b11111110U;
-	} else if (rr->inter == 1U) {
-		/* aaaah, what they want in fact is a weekly schedule
-		 * with the days in wd_mask */
-		return rrul_fill_wly(tgt, nti, rr);
-	}
-
 	/* generate a set of hours, minutes and seconds */
-	(void)make_enum(&e, proto, rr);
-
-	/* set up the month mask */
-	with (unsigned int tmp) {
-		for (bitint_iter_t moni = 0UL;
-		     (tmp = bui31_next(&moni, rr->mon), moni);) {
-			m_mask |= 1U << tmp;
-		}
-	}
-	if (!m_mask) {
-		/* because we're subtractive, allow all months in the m_mask if
-		 * all of the actual mask months are 0 */
-		m_mask = 0b1111111111110U;
-	}
-
-	/* set up the days masks */
-	with (int tmp) {
-		for (bitint_iter_t domi = 0UL;
-		     (tmp = bi31_next(&domi, rr->dom), domi);) {
-			if (tmp > 0) {
-				posd_mask |= 1U << tmp;
-			} else if (tmp < 0) {
-				negd_mask |= 1U << (unsigned int)(-++tmp);
-			}
-		}
-	}
-	if (!posd_mask && !negd_mask) {
-		/* because we're subtractive, allow all doms in the d_masks if
-		 * all of the actual day-of-months are 0 */
-		posd_mask = 0b11111111111111111111111111111111U;
-		negd_mask = 0b11111111111111111111111111111111U;
-	}
+	cc_enum(&e, proto, cc);
 
 	/* fill up the array the hard way */
 	for (res = 0UL, w = echs_scale_wday(srcsca, y, m, d),
@@ -1541,7 +1796,7 @@ rrul_fill_dly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 			     w = (w - 1U) % 7U + 1U;
 		     }
 		     while (d > maxd) {
-			     d--, d %= maxd, d++;
+			     d -= maxd;
 			     if (++m > 12U) {
 				     y++;
 				     m = 1U;
@@ -1551,20 +1806,21 @@ rrul_fill_dly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 	     })) {
 		/* we're subtractive, so check if the current ymd matches
 		 * if not, just continue and check the next candidate */
-		if (!(wd_mask & (1U << w))) {
+		if (wdp && !(wd_mask & (1U << w))) {
 			/* huh? */
 			continue;
-		} else if (!(m_mask & (1U << m))) {
+		} else if (mdp && !(m_mask & (1U << m))) {
 			/* skip the whole month */
 			continue;
-		} else if (!(posd_mask & (1U << d)) &&
+		} else if (mdp && !(posd_mask & (1U << d)) &&
 			   !(negd_mask & (1U << (maxd - d)))) {
 			/* day is filtered */
 			continue;
 		}
 
 		for (ENUM_INIT(e, iS, iM, iH);
-		     ENUM_COND(e, iS, iM, iH); ENUM_ITER(e, iS, iM, iH)) {
+		     res < nti && ENUM_COND(e, iS, iM, iH);
+		     ENUM_ITER(e, iS, iM, iH)) {
 			echs_instant_t x = {
 				.y = y,
 				.m = m,
@@ -1582,7 +1838,7 @@ rrul_fill_dly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 			/* attach scale and convert back to greg */
 			x = echs_instant_attach_scale(x, srcsca);
 
-			tgt[res + GRP_CCH_OFF] = x;
+			grp[res] = x;
 			tgt[res++] = x;
 		}
 	}
@@ -1590,8 +1846,32 @@ fin:
 	return res;
 }
 
-size_t
-rrul_fill_Hly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
+static size_t
+kern_dly(echs_instant_t *restrict tgt, size_t nti,
+	 rrulsp_t rr, const struct rrulcc_s *cc)
+{
+	return __kern_dly(tgt, nti, rr, cc, true, true);
+}
+
+static size_t
+kern_dly_wd(echs_instant_t *restrict tgt, size_t nti,
+	    rrulsp_t rr, const struct rrulcc_s *cc)
+{
+/* DAILY with BYDAY only */
+	return __kern_dly(tgt, nti, rr, cc, true, false);
+}
+
+static size_t
+kern_dly_all(echs_instant_t *restrict tgt, size_t nti,
+	     rrulsp_t rr, const struct rrulcc_s *cc)
+{
+/* plain DAILY, every INTERVAL-th day */
+	return __kern_dly(tgt, nti, rr, cc, false, false);
+}
+
+static size_t
+kern_Hly(echs_instant_t *restrict tgt, size_t nti,
+	 rrulsp_t rr, const struct rrulcc_s *cc)
 {
 	const echs_instant_t proto = *tgt;
 	unsigned int y = proto.y;
@@ -1599,11 +1879,11 @@ rrul_fill_Hly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 	unsigned int d = proto.d;
 	unsigned int H = proto.H;
 	size_t res = 0UL;
-	uint8_t wd_mask = 0U;
-	unsigned int m_mask = 0U;
-	uint_fast32_t posd_mask = 0U;
-	uint_fast32_t negd_mask = 0U;
-	uint_fast32_t H_mask = 0U;
+	const uint8_t wd_mask = cc->wd_mask;
+	const unsigned int m_mask = cc->m_mask;
+	const uint_fast32_t posd_mask = cc->posd_mask;
+	const uint_fast32_t negd_mask = cc->negd_mask;
+	const uint_fast32_t H_mask = cc->H_mask;
 	struct enum_s e;
 
 	if (UNLIKELY((unsigned int)rr->count < nti)) {
@@ -1626,74 +1906,11 @@ rrul_fill_Hly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 	}
 
 	/* generate a set of minutes and seconds */
-	(void)make_enum(&e, proto, rr);
-
-	/* set up the wday mask */
-	with (int tmp) {
-		for (bitint_iter_t dowi = 0UL;
-		     (tmp = bi447_next(&dowi, &rr->dow), dowi);) {
-			if (tmp >= (int)MON && tmp <= (int)SUN) {
-				wd_mask |= (uint8_t)(1U << (unsigned int)tmp);
-			} else {
-				/* non-0 wday counts, as in nMO,nTU, etc.
-				 * are illegal in the DAILY frequency */
-				wd_mask |= 0b1U;
-			}
-		}
-	}
-	if (!(wd_mask >> 1U)) {
-		/* because we're subtractive, allow all days in the wd_mask if
-		 * all of the actual mask days are 0 */
-		wd_mask |= 0b11111110U;
-	}
-
-	/* set up the month mask */
-	with (unsigned int tmp) {
-		for (bitint_iter_t moni = 0UL;
-		     (tmp = bui31_next(&moni, rr->mon), moni);) {
-			m_mask |= 1U << tmp;
-		}
-	}
-	if (!m_mask) {
-		/* because we're subtractive, allow all months in the m_mask if
-		 * all of the actual mask months are 0 */
-		m_mask = 0b1111111111110U;
-	}
-
-	/* set up the days masks */
-	with (int tmp) {
-		for (bitint_iter_t domi = 0UL;
-		     (tmp = bi31_next(&domi, rr->dom), domi);) {
-			if (tmp > 0) {
-				posd_mask |= 1U << tmp;
-			} else if (tmp < 0) {
-				negd_mask |= 1U << (unsigned int)(-++tmp);
-			}
-		}
-	}
-	if (!posd_mask && !negd_mask) {
-		/* because we're subtractive, allow all doms in the d_masks if
-		 * all of the actual day-of-months are 0 */
-		posd_mask = 0b11111111111111111111111111111111U;
-		negd_mask = 0b11111111111111111111111111111111U;
-	}
-
-	/* set up the hour mask */
-	with (unsigned int tmp) {
-		for (bitint_iter_t Hi = 0UL;
-		     (tmp = bui31_next(&Hi, rr->H), Hi);) {
-			H_mask |= 1U << tmp;
-		}
-	}
-	if (!H_mask) {
-		/* because we're limiting results, allow all hours when
-		 * the H bitsets isn't set */
-		H_mask = ~H_mask;
-	}
+	cc_enum(&e, proto, cc);
 
 	/* fill up the array the naive way */
 	for (unsigned int w = ymd_get_wday(y, m, d), yd = ymd_get_yd(y, m, d),
-		     maxd = __get_ndom(y, m), maxy = (y % 4U) ? 365 : 366;
+		     maxd = __get_ndom(y, m), maxy = 365 + __leapp(y);
 	     res < nti;
 	     ({
 		     if ((H += rr->inter) >= 24U) {
@@ -1703,12 +1920,12 @@ rrul_fill_Hly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 				     w = w % 7U ?: SUN;
 			     }
 			     while (d > maxd) {
-				     d--, d %= maxd, d++;
+				     d -= maxd;
 				     if (++m > 12U) {
 					     y++;
 					     m = 1U;
 					     yd -= maxy - 1;
-					     maxy = (y % 4U) ? 365 : 366;
+					     maxy = 365 + __leapp(y);
 				     }
 				     maxd = __get_ndom(y, m);
 			     }
@@ -1745,7 +1962,8 @@ rrul_fill_Hly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 
 	bang:
 		for (ENUM_INIT(e, iS, iM);
-		     ENUM_COND(e, iS, iM); ENUM_ITER(e, iS, iM)) {
+		     res < nti && ENUM_COND(e, iS, iM);
+		     ENUM_ITER(e, iS, iM)) {
 			echs_instant_t x = {
 				.y = y,
 				.m = m,
@@ -1768,8 +1986,9 @@ fin:
 	return res;
 }
 
-size_t
-rrul_fill_Mly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
+static size_t
+kern_Mly(echs_instant_t *restrict tgt, size_t nti,
+	 rrulsp_t rr, const struct rrulcc_s *cc)
 {
 	const echs_instant_t proto = *tgt;
 	unsigned int y = proto.y;
@@ -1778,12 +1997,12 @@ rrul_fill_Mly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 	unsigned int H = proto.H;
 	unsigned int M = proto.M;
 	size_t res = 0UL;
-	uint8_t wd_mask = 0U;
-	unsigned int m_mask = 0U;
-	uint_fast32_t posd_mask = 0U;
-	uint_fast32_t negd_mask = 0U;
-	uint_fast32_t H_mask = 0U;
-	uint_fast64_t M_mask = 0U;
+	const uint8_t wd_mask = cc->wd_mask;
+	const unsigned int m_mask = cc->m_mask;
+	const uint_fast32_t posd_mask = cc->posd_mask;
+	const uint_fast32_t negd_mask = cc->negd_mask;
+	const uint_fast32_t H_mask = cc->H_mask;
+	const uint_fast64_t M_mask = cc->M_mask;
 	struct enum_s e;
 
 	if (UNLIKELY((unsigned int)rr->count < nti)) {
@@ -1802,83 +2021,7 @@ rrul_fill_Mly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 	}
 
 	/* generate a set of minutes and seconds */
-	(void)make_enum(&e, proto, rr);
-
-	/* set up the wday mask */
-	with (int tmp) {
-		for (bitint_iter_t dowi = 0UL;
-		     (tmp = bi447_next(&dowi, &rr->dow), dowi);) {
-			if (tmp >= (int)MON && tmp <= (int)SUN) {
-				wd_mask |= (uint8_t)(1U << (unsigned int)tmp);
-			} else {
-				/* non-0 wday counts, as in nMO,nTU, etc.
-				 * are illegal in the DAILY frequency */
-				wd_mask |= 0b1U;
-			}
-		}
-	}
-	if (!(wd_mask >> 1U)) {
-		/* because we're subtractive, allow all days in the wd_mask if
-		 * all of the actual mask days are 0 */
-		wd_mask |= 0b11111110U;
-	}
-
-	/* set up the month mask */
-	with (unsigned int tmp) {
-		for (bitint_iter_t moni = 0UL;
-		     (tmp = bui31_next(&moni, rr->mon), moni);) {
-			m_mask |= 1U << tmp;
-		}
-	}
-	if (!m_mask) {
-		/* because we're subtractive, allow all months in the m_mask if
-		 * all of the actual mask months are 0 */
-		m_mask = 0b1111111111110U;
-	}
-
-	/* set up the days masks */
-	with (int tmp) {
-		for (bitint_iter_t domi = 0UL;
-		     (tmp = bi31_next(&domi, rr->dom), domi);) {
-			if (tmp > 0) {
-				posd_mask |= 1U << tmp;
-			} else if (tmp < 0) {
-				negd_mask |= 1U << (unsigned int)(-++tmp);
-			}
-		}
-	}
-	if (!posd_mask && !negd_mask) {
-		/* because we're subtractive, allow all doms in the d_masks if
-		 * all of the actual day-of-months are 0 */
-		posd_mask = 0b11111111111111111111111111111111U;
-		negd_mask = 0b11111111111111111111111111111111U;
-	}
-
-	/* set up the hour mask */
-	with (unsigned int tmp) {
-		for (bitint_iter_t Hi = 0UL;
-		     (tmp = bui31_next(&Hi, rr->H), Hi);) {
-			H_mask |= 1U << tmp;
-		}
-	}
-	if (!H_mask) {
-		/* because we're limiting results, allow all hours when
-		 * the H bitsets isn't set */
-		H_mask = ~H_mask;
-	}
-
-	/* set up the minute mask */
-	with (unsigned int tmp) {
-		for (bitint_iter_t Mi = 0UL;
-		     (tmp = bui63_next(&Mi, rr->M), Mi);) {
-			M_mask |= 1ULL << tmp;
-		}
-	}
-	if (!M_mask) {
-		/* because we're limiting results, allow all minutes when
-		 * the M bits aren't set */
-		M_mask = ~M_mask;
-	}
+	cc_enum(&e, proto, cc);
 
 	/* check ranges before filling */
 	if (UNLIKELY(y < 1600U || !m || m > 12U || !d || d > 31U)) {
@@ -1897,7 +2040,7 @@ rrul_fill_Mly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 					     w = w % 7U ?: SUN;
 				     }
 				     while (d > maxd) {
-					     d--, d %= maxd, d++;
+					     d -= maxd;
 					     if (++m > 12U) {
 						     y++;
 						     m = 1U;
@@ -1927,7 +2070,8 @@ rrul_fill_Mly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 			continue;
 		}
 
-		for (ENUM_INIT(e, iS); ENUM_COND(e, iS); ENUM_ITER(e, iS)) {
+		for (ENUM_INIT(e, iS);
+		     res < nti && ENUM_COND(e, iS); ENUM_ITER(e, iS)) {
 			echs_instant_t x = {
 				.y = y,
 				.m = m,
@@ -1950,8 +2094,9 @@ fin:
 	return res;
 }
 
-size_t
-rrul_fill_Sly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
+static size_t
+kern_Sly(echs_instant_t *restrict tgt, size_t nti,
+	 rrulsp_t rr, const struct rrulcc_s *cc)
 {
 	const echs_instant_t proto = *tgt;
 	unsigned int y = proto.y;
@@ -1961,13 +2106,13 @@ rrul_fill_Sly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 	unsigned int M = proto.M;
 	unsigned int S = proto.S;
 	size_t res = 0UL;
-	uint8_t wd_mask = 0U;
-	unsigned int m_mask = 0U;
-	uint_fast32_t posd_mask = 0U;
-	uint_fast32_t negd_mask = 0U;
-	uint_fast32_t H_mask = 0U;
-	uint_fast64_t M_mask = 0U;
-	uint_fast64_t S_mask = 0U;
+	const uint8_t wd_mask = cc->wd_mask;
+	const unsigned int m_mask = cc->m_mask;
+	const uint_fast32_t posd_mask = cc->posd_mask;
+	const uint_fast32_t negd_mask = cc->negd_mask;
+	const uint_fast32_t H_mask = cc->H_mask;
+	const uint_fast64_t M_mask = cc->M_mask;
+	const uint_fast64_t S_mask = cc->S_mask;
 
 	if (UNLIKELY((unsigned int)rr->count < nti)) {
 		if (UNLIKELY((nti = rr->count) == 0UL)) {
@@ -1985,95 +2130,6 @@ rrul_fill_Sly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 		S = 0U;
 	}
 
-	/* set up the wday mask */
-	with (int tmp) {
-		for (bitint_iter_t dowi = 0UL;
-		     (tmp = bi447_next(&dowi, &rr->dow), dowi);) {
-			if (tmp >= (int)MON && tmp <= (int)SUN) {
-				wd_mask |= (uint8_t)(1U << (unsigned int)tmp);
-			} else {
-				/* non-0 wday counts, as in nMO,nTU, etc.
-				 * are illegal in the DAILY frequency */
-				wd_mask |= 0b1U;
-			}
-		}
-	}
-	if (!(wd_mask >> 1U)) {
-		/* because we're subtractive, allow all days in the wd_mask if
-		 * all of the actual mask days are 0 */
-		wd_mask |= 0b11111110U;
-	}
-
-	/* set up the month mask */
-	with (unsigned int tmp) {
-		for (bitint_iter_t moni = 0UL;
-		     (tmp = bui31_next(&moni, rr->mon), moni);) {
-			m_mask |= 1U << tmp;
-		}
-	}
-	if (!m_mask) {
-		/* because we're subtractive, allow all months in the m_mask if
-		 * all of the actual mask months are 0 */
-		m_mask = 0b1111111111110U;
-	}
-
-	/* set up the days masks */
-	with (int tmp) {
-		for (bitint_iter_t domi = 0UL;
-		     (tmp = bi31_next(&domi, rr->dom), domi);) {
-			if (tmp > 0) {
-				posd_mask |= 1U << tmp;
-			} else if (tmp < 0) {
-				negd_mask |= 1U << (unsigned int)(-++tmp);
-			}
-		}
-	}
-	if (!posd_mask && !negd_mask) {
-		/* because we're subtractive, allow all doms in the d_masks if
-		 * all of the actual day-of-months are 0 */
-		posd_mask = 0b11111111111111111111111111111111U;
-		negd_mask = 0b11111111111111111111111111111111U;
-	}
-
-	/* set up the hour mask */
-	with (unsigned int tmp) {
-		for (bitint_iter_t Hi = 0UL;
-		     (tmp = bui31_next(&Hi, rr->H), Hi);) {
-			H_mask |= 1U << tmp;
-		}
-	}
-	if (!H_mask) {
-		/* because we're limiting results, allow all hours when
-		 * the H bitsets isn't set */
-		H_mask = ~H_mask;
-	}
-
-	/* set up the minute mask */
-	with (unsigned int tmp) {
-		for (bitint_iter_t Mi = 0UL;
-		     (tmp = bui63_next(&Mi, rr->M), Mi);) {
-			M_mask |= 1ULL << tmp;
-		}
-	}
-	if (!M_mask) {
-		/* because we're limiting results, allow all minutes when
-		 * the M bits aren't set */
-		M_mask = ~M_mask;
-	}
-
-	/* set up the second mask */
-	with (unsigned int tmp) {
-		for (bitint_iter_t Si = 0UL;
-		     (tmp = bui63_next(&Si, rr->S), Si);) {
-			S_mask |= 1ULL << tmp;
-		}
-	}
-	if (!S_mask) {
-		/* because we're limiting results, allow all seconds when
-		 * the S bits aren't set */
-		S_mask = ~S_mask;
-	}
-
 	/* check ranges before filling */
 	if (UNLIKELY(y < 1600U || !m || m > 12U || !d || d > 31U)) {
 		goto fin;
@@ -2094,7 +2150,7 @@ rrul_fill_Sly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
 						     w = w % 7U ?: SUN;
 					     }
 					     while (d > maxd) {
-						     d--, d %= maxd, d++;
+						     d -= maxd;
 						     if (++m > 12U) {
 							     y++;
 							     m = 1U;
@@ -2143,46 +2199,1024 @@ fin:
 	return res;
 }
 
-
-/* rrules as query language */
-bool
-echs_instant_matches_p(rrulsp_t filt, echs_instant_t inst)
+static inline __attribute__((always_inline)) size_t
+__kern_lin(
+	echs_instant_t *restrict tgt, size_t nti,
+	rrulsp_t rr, const struct rrulcc_s *cc, const echs_freq_t freq)
 {
-	/* whitelisted events and state */
-	static echs_instant_t wl[256U];
-	static size_t nwl;
-	static size_t iwl;
+/* HOURLY, MINUTELY and SECONDLY rules without BY-parts other than
+ * BYHOUR, BYMINUTE and BYSECOND, periods are an arithmetic progression
+ * in seconds and each of them yields the same offsets into it */
+	const echs_instant_t proto = *tgt;
+	/* BYHOUR filters all of them, BYMINUTE and BYSECOND only
+	 * periods shorter than an hour or a minute respectively */
+	const uint32_t H_mask = cc->H_mask;
+	const uint64_t M_mask = freq != FREQ_HOURLY ? cc->M_mask : ~0ULL;
+	const uint64_t S_mask = freq == FREQ_SECONDLY ? cc->S_mask : ~0ULL;
+	const bool filtp = !!~H_mask || !!~M_mask || !!~S_mask;
+	unsigned int y = proto.y;
+	unsigned int m = proto.m;
+	unsigned int d = proto.d;
+	/* period length and second of day the current period starts at */
+	uint_fast64_t step;
+	uint_fast64_t t;
+	/* offsets of instants into each period */
+	uint16_t offs[64U];
+	size_t noffs = 0U;
+	/* comparison keys of proto and until */
+	const uint64_t kdel = ((echs_instant_t){.H = 1U, .ms = 1U}).u;
+	uint64_t kpro;
+	uint64_t kunt;
+	size_t res = 0UL;
 
-	if (UNLIKELY(nwl > countof(wl))) {
-		goto never;
+	if (UNLIKELY(echs_instant_all_day_p(proto) ||
+		     echs_instant_all_sec_p(proto))) {
+		/* leave the sanitising to the generic kernels */
+		switch (freq) {
+		case FREQ_HOURLY:
+			return kern_Hly(tgt, nti, rr, cc);
+		case FREQ_MINUTELY:
+			return kern_Mly(tgt, nti, rr, cc);
+		default:
+			return kern_Sly(tgt, nti, rr, cc);
+		}
 	}
-ffw:
-	/* fast-forward whitelist to within the range of INST */
-	for (; iwl < nwl && echs_instant_lt_p(wl[iwl], inst); iwl++);
-	if (UNLIKELY(iwl >= nwl)) {
-		/* refill filter list, start out with I */
-		echs_instant_t proto = inst;
 
-		proto.d = 0;
-		for (size_t i = 0UL; i < countof(wl); i++) {
-			wl[i] = proto;
-		}
-		if (UNLIKELY(!(nwl = rrul_fill_yly(wl, countof(wl), filt)))) {
-			nwl = -1UL;
-			goto never;
+	if (UNLIKELY((unsigned int)rr->count < nti)) {
+		if (UNLIKELY((nti = rr->count) == 0UL)) {
+			goto fin;
 		}
-		/* reset state */
-		iwl = 0UL;
-		/* retry the fast forwarding */
-		goto ffw;
 	}
-	/* now either wl[iwl] == inst ... */
-	if (echs_instant_eq_p(wl[iwl], inst)) {
-		return true;
+
+	/* check ranges before filling */
+	if (UNLIKELY(y < 1600U || !m || m > 12U || !d || d > 31U)) {
+		goto fin;
 	}
-never:
-	/* ... or we're past it */
-	return false;
+
+	switch (freq) {
+	case FREQ_HOURLY:
+		step = 3600U;
+		t = proto.H * 3600U;
+		for (size_t iM = 0U; iM < (cc->nM ?: 1U); iM++) {
+			const unsigned int M = cc->nM ? cc->M[iM] : proto.M;
+
+			for (size_t iS = 0U; iS < (cc->nS ?: 1U); iS++) {
+				const unsigned int S = cc->nS ? cc->S[iS] : proto.S;
+
+				offs[noffs++] = (uint16_t)(M * 60U + S);
+			}
+		}
+		break;
+	case FREQ_MINUTELY:
+		step = 60U;
+		t = proto.H * 3600U + proto.M * 60U;
+		for (size_t iS = 0U; iS < (cc->nS ?: 1U); iS++) {
+			offs[noffs++] = (uint16_t)(cc->nS ? cc->S[iS] : proto.S);
+		}
+		break;
+	default:
+		step = 1U;
+		t = proto.H * 3600U + proto.M * 60U + proto.S;
+		offs[noffs++] = 0U;
+		break;
+	}
+	step *= rr->inter;
+
+	/* compare keys as in echs_instant_lt_p(), none of the fields of
+	 * the instants generated here can overflow */
+	with (echs_instant_t k = proto) {
+		k.H++, k.ms++;
+		kpro = k.u;
+	}
+	with (echs_instant_t k = rr->until) {
+		k.H++, k.ms++;
+		kunt = k.u;
+	}
+
+	for (unsigned int maxd = __get_ndom(y, m); res < nti;) {
+		const echs_instant_t day = {.y = y, .m = m, .d = d, .ms = proto.ms};
+
+		if (UNLIKELY(echs_instant_lt_p(rr->until, day))) {
+			/* even when everything today is filtered */
+			goto fin;
+		}
+		/* all periods starting today */
+		for (; t < 86400U && res < nti; t += step) {
+			if (filtp &&
+			    (!(H_mask >> (t / 3600U) & 1U) ||
+			     !(M_mask >> (t / 60U % 60U) & 1U) ||
+			     !(S_mask >> (t % 60U) & 1U))) {
+				/* period is filtered */
+				continue;
+			}
+			for (size_t i = 0U; i < noffs && res < nti; i++) {
+				const unsigned int s = t + offs[i];
+				const echs_instant_t hms = {
+					.H = s / 3600U,
+					.M = s / 60U % 60U,
+					.S = s % 60U,
+				};
+				const echs_instant_t x = {.u = day.u | hms.u};
+
+				if (UNLIKELY(x.u + kdel < kpro)) {
+					continue;
+				} else if (UNLIKELY(kunt < x.u + kdel)) {
+					goto fin;
+				}
+				tgt[res++] = x;
+			}
+		}
+		/* carry over into the day the next period starts on */
+		for (; t >= 86400U; t -= 86400U) {
+			if (++d > maxd) {
+				d = 1U;
+				if (++m > 12U) {
+					y++;
+					m = 1U;
+				}
+				maxd = __get_ndom(y, m);
+			}
+		}
+	}
+fin:
+	return res;
+}
+
+static size_t
+kern_Hly_lin(echs_instant_t *restrict tgt, size_t nti,
+	     rrulsp_t rr, const struct rrulcc_s *cc)
+{
+	return __kern_lin(tgt, nti, rr, cc, FREQ_HOURLY);
+}
+
+static size_t
+kern_Mly_lin(echs_instant_t *restrict tgt, size_t nti,
+	     rrulsp_t rr, const struct rrulcc_s *cc)
+{
+	return __kern_lin(tgt, nti, rr, cc, FREQ_MINUTELY);
+}
+
+static size_t
+kern_Sly_lin(echs_instant_t *restrict tgt, size_t nti,
+	     rrulsp_t rr, const struct rrulcc_s *cc)
+{
+	return __kern_lin(tgt, nti, rr, cc, FREQ_SECONDLY);
+}
+
+static size_t
+kern_none(echs_instant_t *UNUSED(tgt), size_t UNUSED(nti),
+	  rrulsp_t UNUSED(rr), const struct rrulcc_s *UNUSED(cc))
+{
+	return 0UL;
+}
+
+static void
+compile(struct rrulcc_s *restrict tgt, rrulsp_t rr, echs_freq_t freq)
+{
+	unsigned int tmp;
+	int itmp;
+	bool linp;
+
+	memset(tgt, 0, sizeof(*tgt));
+
+	/* set up the wday masks */
+	for (bitint_iter_t dowi = 0UL;
+	     (itmp = bi447_next(&dowi, &rr->dow), dowi);) {
+		if (itmp >= (int)MON && itmp <= (int)SUN) {
+			tgt->wd_bits |= (uint8_t)(1U << (unsigned int)itmp);
+		} else {
+			/* use lsb of wd_bits to indicate
+			 * non-0 wday counts, as in nMO,nTU, etc. */
+			tgt->wd_bits |= 0b1U;
+		}
+	}
+	tgt->wd_mask = tgt->wd_bits;
+	if (!(tgt->wd_mask >> 1U)) {
+		/* because we're subtractive, allow all days in the wd_mask if
+		 * all of the actual mask days are 0 */
+		tgt->wd_mask |= 0b11111110U;
+	}
+
+	/* set up the month mask */
+	for (bitint_iter_t moni = 0UL;
+	     (tmp = bui31_next(&moni, rr->mon), moni);) {
+		tgt->m_mask |= (uint16_t)(1U << tmp);
+	}
+	if (!tgt->m_mask) {
+		tgt->m_mask = 0b1111111111110U;
+	}
+
+	/* set up the days masks */
+	for (bitint_iter_t domi = 0UL;
+	     (itmp = bi31_next(&domi, rr->dom), domi);) {
+		if (itmp > 0) {
+			tgt->posd_mask |= 1U << itmp;
+		} else if (itmp < 0) {
+			tgt->negd_mask |= 1U << (unsigned int)(-++itmp);
+		}
+	}
+	if (!tgt->posd_mask && !tgt->negd_mask) {
+		tgt->posd_mask = 0b11111111111111111111111111111111U;
+		tgt->negd_mask = 0b11111111111111111111111111111111U;
+	}
+
+	/* hours, minutes and seconds, as masks and enumerated */
+	for (bitint_iter_t Hi = 0UL; (tmp = bui31_next(&Hi, rr->H), Hi);) {
+		tgt->H_mask |= 1U << tmp;
+		tgt->H[tgt->nH++] = (uint8_t)tmp;
+	}
+	for (bitint_iter_t Mi = 0UL; (tmp = bui63_next(&Mi, rr->M), Mi);) {
+		tgt->M_mask |= 1ULL << tmp;
+		tgt->M[tgt->nM++] = (uint8_t)tmp;
+	}
+	for (bitint_iter_t Si = 0UL; (tmp = bui63_next(&Si, rr->S), Si);) {
+		tgt->S_mask |= 1ULL << tmp;
+		tgt->S[tgt->nS++] = (uint8_t)tmp;
+	}
+	/* because we're limiting results, allow everything if unset */
+	tgt->H_mask = tgt->H_mask ?: ~tgt->H_mask;
+	tgt->M_mask = tgt->M_mask ?: ~tgt->M_mask;
+	tgt->S_mask = tgt->S_mask ?: ~tgt->S_mask;
+
+	/* sub-daily rules with time BY-parts only are plain arithmetic */
+	linp = rr->scale == SCALE_GREGORIAN && !rr->shift &&
+		!tgt->wd_bits &&
+		!bui31_has_bits_p(rr->mon) &&
+		!bi31_has_bits_p(rr->dom) &&
+		!bi383_has_bits_p(&rr->doy) &&
+		!bi63_has_bits_p(rr->wk) &&
+		!bi383_has_bits_p(&rr->pos) &&
+		!bi383_has_bits_p(&rr->easter);
+
+	/* now find the kernel for what's there */
+	switch (freq) {
+	default:
+		tgt->fill = kern_none;
+		break;
+	case FREQ_YEARLY:
+		tgt->fill = kern_yly;
+		break;
+	case FREQ_MONTHLY:
+		if (tgt->wd_bits ||
+		    bi383_has_bits_p(&rr->pos) || rr->shift) {
+			tgt->fill = kern_mly;
+		} else if (bi31_has_bits_p(rr->dom) &&
+			   !~tgt->posd_mask && !~tgt->negd_mask) {
+			/* only 0 days-of-month, leave that to the generic
+			 * kernel */
+			tgt->fill = kern_mly;
+		} else {
+			tgt->fill = kern_mly_md;
+		}
+		break;
+	case FREQ_WEEKLY:
+		tgt->fill = kern_wly;
+		break;
+	case FREQ_DAILY:
+		if (tgt->wd_bits >> 1U && rr->inter == 1U) {
+			/* aaaah, what they want in fact is a weekly schedule
+			 * with the days in wd_mask */
+			tgt->fill = kern_wly;
+		} else if (tgt->m_mask != 0b1111111111110U ||
+			   ~tgt->posd_mask || ~tgt->negd_mask) {
+			tgt->fill = kern_dly;
+		} else if (tgt->wd_mask != 0b11111111U) {
+			tgt->fill = kern_dly_wd;
+		} else {
+			tgt->fill = kern_dly_all;
+		}
+		break;
+	case FREQ_HOURLY:
+		tgt->fill = !linp ? kern_Hly
+			: (tgt->nM ?: 1U) * (tgt->nS ?: 1U) <= 64U
+			? kern_Hly_lin : kern_Hly;
+		break;
+	case FREQ_MINUTELY:
+		tgt->fill = linp ? kern_Mly_lin : kern_Mly;
+		break;
+	case FREQ_SECONDLY:
+		tgt->fill = linp ? kern_Sly_lin : kern_Sly;
+		break;
+	}
+	return;
+}
+
+void
+rrul_compile(struct rrulcc_s *restrict tgt, rrulsp_t rr, echs_instant_t proto)
+{
+	compile(tgt, rr, rr->freq);
+	proto = echs_instant_rescale(proto, rr->scale);
+	proto = echs_instant_detach_scale(proto);
+	tgt->wd_anchor = echs_scale_wday(rr->scale, proto.y, proto.m, proto.d);
+	return;
+}
+
+size_t
+rrul_fill_wly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
+{
+	struct rrulcc_s cc;
+
+	compile(&cc, rr, FREQ_WEEKLY);
+	return kern_wly(tgt, nti, rr, &cc);
+}
+
+size_t
+rrul_fill_dly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
+{
+	struct rrulcc_s cc;
+
+	compile(&cc, rr, FREQ_DAILY);
+	return cc.fill(tgt, nti, rr, &cc);
+}
+
+size_t
+rrul_fill_Hly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
+{
+	struct rrulcc_s cc;
+
+	compile(&cc, rr, FREQ_HOURLY);
+	return cc.fill(tgt, nti, rr, &cc);
+}
+
+size_t
+rrul_fill_Mly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
+{
+	struct rrulcc_s cc;
+
+	compile(&cc, rr, FREQ_MINUTELY);
+	return cc.fill(tgt, nti, rr, &cc);
+}
+
+size_t
+rrul_fill_Sly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr)
+{
+	struct rrulcc_s cc;
+
+	compile(&cc, rr, FREQ_SECONDLY);
+	return cc.fill(tgt, nti, rr, &cc);
+}
+
+static __attribute__((const, pure)) int
+ymd_get_dnum(unsigned int y, unsigned int m, unsigned int d)
+{
+/* days since 0000-12-31 */
+	const int py = (int)(y - 1U);
+
+	return 365 * py + py / 4 - py / 100 + py / 400 + ymd_get_yd(y, m, d);
+}
+
+static __attribute__((const, pure)) int
+instant_get_snum(echs_instant_t i)
+{
+/* seconds since midnight */
+	if (UNLIKELY(echs_instant_all_day_p(i))) {
+		return 0;
+	}
+	return (i.H * 60 + i.M) * 60 + i.S;
+}
+
+echs_instant_t
+rrul_seek(echs_instant_t proto, rrulsp_t rr, echs_instant_t tgt)
+{
+/* We leave a margin of 2 periods and a day before TGT so that shifts,
+ * set positions and timezone offsets can't possibly push occurrences
+ * of the skipped periods past TGT. */
+	const int inter = rr->inter ?: 1U;
+	int64_t n;
+
+	if (UNLIKELY(rr->scale != SCALE_GREGORIAN)) {
+		/* periods don't line up with gregorian instants */
+		return proto;
+	} else if (UNLIKELY(echs_nul_instant_p(proto))) {
+		return proto;
+	}
+	tgt = echs_instant_detach_scale(tgt);
+
+	switch (rr->freq) {
+	case FREQ_YEARLY:
+		n = ((int)tgt.y - (int)proto.y) / inter - 2;
+		if (n > 0) {
+			proto.y += n * inter;
+		}
+		break;
+
+	case FREQ_MONTHLY:
+		with (int pm = proto.y * 12U + proto.m - 1U) {
+			n = ((int)(tgt.y * 12U + tgt.m - 1U) - pm) / inter - 2;
+			if (n > 0) {
+				pm += n * inter;
+				proto.y = pm / 12U;
+				proto.m = pm % 12U + 1U;
+			}
+		}
+		break;
+
+	case FREQ_WEEKLY:
+		if (inter > 1 && bi447_has_bits_p(&rr->dow)) {
+			/* the weekly filler anchors the week at its proto
+			 * so the grid isn't stable across refills */
+			break;
+		}
+		/*@fallthrough@*/
+	case FREQ_DAILY: {
+		const int step = rr->freq == FREQ_WEEKLY ? 7 * inter : inter;
+
+		n = ymd_get_dnum(tgt.y, tgt.m, tgt.d) -
+			ymd_get_dnum(proto.y, proto.m, proto.d);
+		n = (n - 1) / step - 2;
+		if (n > 0) {
+			n *= step * 86400000LL;
+			proto = echs_instant_add(proto, (echs_idiff_t){n});
+		}
+		break;
+	}
+
+	case FREQ_HOURLY:
+	case FREQ_MINUTELY:
+	case FREQ_SECONDLY: {
+		static const int secs[] = {
+			[FREQ_HOURLY] = 3600,
+			[FREQ_MINUTELY] = 60,
+			[FREQ_SECONDLY] = 1,
+		};
+		const int step = secs[rr->freq] * inter;
+
+		if (UNLIKELY(echs_instant_all_day_p(proto))) {
+			/* no intraday arithmetic on those */
+			break;
+		}
+		n = ymd_get_dnum(tgt.y, tgt.m, tgt.d) -
+			ymd_get_dnum(proto.y, proto.m, proto.d) - 1;
+		n *= 86400;
+		n += instant_get_snum(tgt) - instant_get_snum(proto);
+		n = n / step - 2;
+		if (n > 0) {
+			n *= step * 1000LL;
+			proto = echs_instant_add(proto, (echs_idiff_t){n});
+		}
+		break;
+	}
+
+	default:
+		break;
+	}
+	return proto;
+}
+
+static size_t
+fill_max(echs_instant_t *restrict max, echs_instant_t proto,
+	 struct rrulsp_s *restrict rr, const struct rrulcc_s *cc)
+{
+/* unroll RR from PROTO, keep the latest instant in MAX and return the
+ * number of instants, RR's COUNT is used up along the way */
+	echs_instant_t buf[2U * GRP_CCH_OFF];
+	echs_instant_t m = echs_instant_detach_scale(*max);
+	size_t res = 0U;
+
+	while (rr->count) {
+		size_t n;
+
+		for (size_t i = 0U; i < GRP_CCH_OFF; i++) {
+			buf[i] = proto;
+		}
+		n = cc->fill(buf, GRP_CCH_OFF, rr, cc);
+		for (size_t i = 0U; i < n; i++) {
+			echs_instant_t x = echs_instant_detach_scale(buf[i]);
+
+			if (echs_instant_lt_p(m, x)) {
+				m = x;
+				*max = buf[i];
+			}
+		}
+		if (n < GRP_CCH_OFF) {
+			/* exhausted */
+			res += n;
+			rr->count -= rr->count > 0 ? n : 0U;
+			break;
+		}
+		/* keep the last one as proto for the next round */
+		proto = buf[--n];
+		res += n;
+		rr->count -= rr->count > 0 ? n : 0U;
+	}
+	return res;
+}
+
+/* periods of YEARLY and MONTHLY rules */
+struct prd_s {
+	struct ymd_s c;
+	/* number of times of day per candidate day */
+	size_t nhms;
+	bool ylyp;
+	unsigned int y;
+	int m;
+	/* earliest candidate and end of the current period */
+	echs_instant_t beg;
+	echs_instant_t end;
+};
+
+static bool
+prd_init(struct prd_s *restrict p, echs_instant_t p0, rrulsp_t rr)
+{
+/* set up P for the period of RR that P0 is in */
+	struct enum_s e;
+
+	p->ylyp = rr->freq == FREQ_YEARLY;
+	p->y = p0.y, p->m = p0.m;
+	if (UNLIKELY(!p->ylyp && !mly_track(&p->y, &p->m, rr))) {
+		return false;
+	}
+	(void)make_enum(&e, p0, rr);
+	p->nhms = (size_t)e.nH * e.nM * e.nS;
+	make_ymd(&p->c, p0, rr, rr->freq);
+	/* periods start at their earliest candidate */
+	p->beg = p0;
+	if (!echs_instant_all_day_p(p0)) {
+		p->beg.H = bui31_has_bits_p(rr->H) ? 0U : p0.H;
+		p->beg.M = bui63_has_bits_p(rr->M) ? 0U : p0.M;
+		p->beg.S = bui63_has_bits_p(rr->S) ? 0U : p0.S;
+	}
+	p->end = (echs_instant_t){
+		.y = p->y, .m = p->ylyp ? 12 : p->m,
+		.d = 31U, .H = 23U, .M = 59U, .S = 60U, .ms = 999U,
+	};
+	return true;
+}
+
+static bool
+prd_cnt(size_t *restrict k, const struct prd_s *p, rrulsp_t rr)
+{
+/* put the number of occurrences in P's period into K, return false if
+ * the period spills into adjacent years */
+	bitint383_t cand[3U] = {0U};
+
+	if (p->ylyp) {
+		yly_cand(cand, p->y, rr, &p->c);
+	} else {
+		mly_cand(cand, p->y, p->m, rr, &p->c);
+	}
+	if (bi383_has_bits_p(cand + 1U) || bi383_has_bits_p(cand + 2U)) {
+		return false;
+	}
+	*k = bi383_cnt(cand) * p->nhms;
+	return true;
+}
+
+static void
+prd_step(struct prd_s *restrict p, rrulsp_t rr)
+{
+	if (p->ylyp) {
+		p->y += rr->inter;
+		p->beg.m = p->c.m0;
+	} else {
+		mly_step(&p->y, &p->m, rr);
+		p->beg.m = p->m;
+	}
+	p->beg.y = p->y, p->beg.d = p->c.d0;
+	p->end.y = p->y, p->end.m = p->ylyp ? 12 : p->m;
+	return;
+}
+
+static echs_instant_t
+last_ymd(echs_instant_t proto, struct rrulsp_s *restrict rr,
+	 const struct rrulcc_s *cc)
+{
+/* Count off whole periods of YEARLY and MONTHLY rules by the popcount
+ * of their candidate sets times the number of times of day, only the
+ * first period and the one holding the last occurrence are unrolled.
+ * Rules whose periods spill into adjacent years are unrolled in full. */
+	const echs_instant_t until = rr->until;
+	const int cnt = rr->count;
+	echs_instant_t res = echs_nul_instant();
+	echs_instant_t lbeg = echs_nul_instant();
+	echs_instant_t lend = echs_nul_instant();
+	struct prd_s p;
+	size_t k;
+
+	if (UNLIKELY(!prd_init(&p, echs_instant_detach_scale(proto), rr))) {
+		return res;
+	}
+	/* the first period, PROTO may well be in the middle of it */
+	if (!prd_cnt(&k, &p, rr)) {
+		goto unroll;
+	} else if (echs_instant_lt_p(p.end, until)) {
+		rr->until = p.end;
+	}
+	fill_max(&res, proto, rr, cc);
+	rr->until = until;
+
+	for (size_t nil = 0U; rr->count > 0 && nil < 64U;) {
+		prd_step(&p, rr);
+		if (echs_instant_lt_p(until, p.beg)) {
+			/* beyond UNTIL */
+			break;
+		} else if (!prd_cnt(&k, &p, rr)) {
+			goto unroll;
+		} else if (!k) {
+			nil++;
+			continue;
+		} else if (k >= (size_t)rr->count ||
+			   !echs_instant_lt_p(p.end, until)) {
+			/* the last one is in here */
+			echs_instant_t x = echs_nul_instant();
+
+			if (fill_max(&x, p.beg, rr, cc)) {
+				return x;
+			}
+			break;
+		}
+		rr->count -= k;
+		lbeg = p.beg, lend = p.end;
+		nil = 0U;
+	}
+	if (!echs_nul_instant_p(lbeg)) {
+		/* unroll the last non-empty period in full */
+		rr->count = -1;
+		rr->until = echs_instant_lt_p(lend, until) ? lend : until;
+		fill_max(&res, lbeg, rr, cc);
+	}
+	return res;
+
+unroll:
+	/* start over, the hard way */
+	res = echs_nul_instant();
+	rr->count = cnt;
+	rr->until = until;
+	fill_max(&res, proto, rr, cc);
+	return res;
+}
+
+static size_t
+skip_ymd(echs_instant_t *restrict proto, rrulsp_t rr, size_t n,
+	 echs_instant_t lim, const struct rrulcc_s *cc)
+{
+/* Like last_ymd() but stop at the period holding the N+1-th occurrence
+ * or reaching into LIM, PROTO is left at the beginning of that period.
+ * A period spilling into adjacent years may put candidates into the
+ * one before it, so that one is left alone as well. */
+	struct prd_s p;
+	echs_instant_t pbeg = *proto;
+	size_t res, pk, k;
+
+	if (UNLIKELY(!prd_init(&p, echs_instant_detach_scale(*proto), rr))) {
+		return 0U;
+	} else if (!prd_cnt(&k, &p, rr) || !echs_instant_lt_p(p.end, lim)) {
+		return 0U;
+	}
+	/* the rest of the first period the hard way */
+	with (struct rrulsp_s r = *rr) {
+		echs_instant_t x = echs_nul_instant();
+
+		r.count = -1;
+		r.until = p.end;
+		if ((res = fill_max(&x, *proto, &r, cc)) > n) {
+			return 0U;
+		}
+	}
+	pk = res;
+	for (size_t nil = 0U; nil < 64U;) {
+		prd_step(&p, rr);
+		if (!echs_instant_lt_p(p.end, lim)) {
+			break;
+		} else if (!prd_cnt(&k, &p, rr)) {
+			res -= pk;
+			p.beg = pbeg;
+			break;
+		} else if (k > n - res) {
+			break;
+		}
+		res += k;
+		pbeg = p.beg, pk = k;
+		nil = k ? 0U : nil + 1U;
+	}
+	*proto = p.beg;
+	return res;
+}
+
+static size_t
+skip_hms(echs_instant_t *restrict proto, rrulsp_t rr, size_t n,
+	 echs_instant_t lim)
+{
+/* HOURLY rules with at most BYMINUTE and BYSECOND, and MINUTELY rules
+ * with at most BYSECOND yield the same offsets into every period */
+	static const int secs[] = {
+		[FREQ_HOURLY] = 3600,
+		[FREQ_MINUTELY] = 60,
+		[FREQ_SECONDLY] = 1,
+	};
+	const echs_instant_t p = *proto;
+	struct enum_s e;
+	/* occurrences per period and those left in PROTO's */
+	size_t c = 1U, r0 = 1U;
+	int64_t k;
+
+	if (UNLIKELY(echs_nul_instant_p(p) || echs_instant_all_day_p(p))) {
+		return 0U;
+	} else if (bi31_has_bits_p(rr->dom) ||
+		   bi383_has_bits_p(&rr->doy) ||
+		   bi447_has_bits_p(&rr->dow) ||
+		   bui31_has_bits_p(rr->mon) ||
+		   bi63_has_bits_p(rr->wk) ||
+		   bui31_has_bits_p(rr->H) ||
+		   bi383_has_bits_p(&rr->pos) ||
+		   bi383_has_bits_p(&rr->easter)) {
+		/* filtered, periods may yield nothing */
+		return 0U;
+	} else if (rr->freq != FREQ_HOURLY && bui63_has_bits_p(rr->M)) {
+		return 0U;
+	} else if (rr->freq == FREQ_SECONDLY && bui63_has_bits_p(rr->S)) {
+		return 0U;
+	}
+
+	(void)make_enum(&e, p, rr);
+	switch (rr->freq) {
+	case FREQ_HOURLY:
+		c = (size_t)e.nM * e.nS;
+		r0 = 0U;
+		for (size_t i = 0U; i < e.nM; i++) {
+			for (size_t j = 0U; j < e.nS; j++) {
+				r0 += e.M[i] > p.M ||
+					(e.M[i] == p.M && e.S[j] >= p.S);
+			}
+		}
+		break;
+	case FREQ_MINUTELY:
+		c = e.nS;
+		r0 = 0U;
+		for (size_t j = 0U; j < e.nS; j++) {
+			r0 += e.S[j] >= p.S;
+		}
+		break;
+	default:
+		break;
+	}
+
+	with (const int step = secs[rr->freq] * (rr->inter ?: 1U)) {
+		k = ymd_get_dnum(lim.y, lim.m, lim.d) -
+			ymd_get_dnum(p.y, p.m, p.d) - 1;
+		k *= 86400;
+		k += instant_get_snum(lim) - instant_get_snum(p);
+		k = k / step - 2;
+		if (k <= 0 || r0 > n) {
+			return 0U;
+		}
+		/* whole periods after PROTO's */
+		with (size_t q = (n - r0) / c) {
+			if (q > (uint64_t)k - 1U) {
+				q = k - 1U;
+			}
+			*proto = echs_instant_add(
+				p, (echs_idiff_t){(q + 1U) * step * 1000LL});
+			r0 += q * c;
+		}
+	}
+	switch (rr->freq) {
+	case FREQ_HOURLY:
+		proto->M = e.M[0U];
+		/*@fallthrough@*/
+	case FREQ_MINUTELY:
+		proto->S = e.S[0U];
+		/*@fallthrough@*/
+	default:
+		break;
+	}
+	return r0;
+}
+
+size_t
+rrul_skip(echs_instant_t *restrict proto, rrulsp_t rr, size_t n,
+	  echs_instant_t tgt, const struct rrulcc_s *cc)
+{
+/* The same margin as in rrul_seek() applies, the periods of YEARLY and
+ * MONTHLY rules are counted off their candidate sets as in rrul_last(). */
+	if (UNLIKELY(rr->scale != SCALE_GREGORIAN || rr->shift)) {
+		return 0U;
+	} else if (UNLIKELY(echs_nul_instant_p(*proto))) {
+		return 0U;
+	}
+	tgt = echs_instant_detach_scale(tgt);
+
+	switch (rr->freq) {
+	case FREQ_YEARLY:
+	case FREQ_MONTHLY:
+		if (!echs_max_instant_p(tgt)) {
+			/* leave a day for timezone offsets */
+			tgt = echs_instant_add(tgt, (echs_idiff_t){-86400000LL});
+		}
+		if (echs_instant_lt_p(rr->until, tgt)) {
+			tgt = rr->until;
+		}
+		return skip_ymd(proto, rr, n, tgt, cc);
+	case FREQ_HOURLY:
+	case FREQ_MINUTELY:
+	case FREQ_SECONDLY:
+		if (echs_instant_lt_p(rr->until, tgt)) {
+			tgt = rr->until;
+		}
+		return skip_hms(proto, rr, n, tgt);
+	default:
+		break;
+	}
+	return 0U;
+}
+
+echs_instant_t
+rrul_last(echs_instant_t proto, rrulsp_t rr, const struct rrulcc_s *cc)
+{
+	struct rrulsp_s r = *rr;
+	echs_instant_t res = echs_nul_instant();
+
+	if (UNLIKELY(echs_nul_instant_p(proto) || !rr->count)) {
+		return res;
+	} else if (rr->count < 0 && echs_max_instant_p(rr->until)) {
+		/* unbounded */
+		return echs_max_instant();
+	} else if (rr->count < 0) {
+		/* UNTIL only, unroll from a little before UNTIL and look
+		 * further back if there's nothing there */
+		for (echs_instant_t tgt = rr->until;;) {
+			echs_instant_t p = rrul_seek(proto, rr, tgt);
+
+			if (fill_max(&res, p, &r, cc) ||
+			    echs_instant_eq_p(p, proto)) {
+				break;
+			}
+			with (echs_idiff_t d = echs_instant_diff(rr->until, p)) {
+				tgt = echs_instant_add(p, echs_idiff_neg(d));
+			}
+		}
+		return res;
+	}
+
+	switch (rr->freq) {
+	case FREQ_YEARLY:
+	case FREQ_MONTHLY:
+		if (rr->scale == SCALE_GREGORIAN && !rr->shift) {
+			return last_ymd(proto, &r, cc);
+		}
+		break;
+	case FREQ_HOURLY:
+	case FREQ_MINUTELY:
+	case FREQ_SECONDLY:
+		/* leave one for the unroll below */
+		r.count -= rrul_skip(&proto, rr, r.count - 1U, rr->until, cc);
+		break;
+	default:
+		break;
+	}
+	fill_max(&res, proto, &r, cc);
+	return res;
+}
+
+
+/* rrules as query language */
+static uint32_t
+filt_ytype(const struct rrulfc_s *fc, unsigned int y)
+{
+/* shifts spill over from adjacent years, key those by year */
+	struct ytpl_key_s k;
+
+	if (UNLIKELY(fc->rr.shift)) {
+		return y | 0x80000000U;
+	}
+	ytpl_key(&k, &fc->rr, 0U, 0, 0U);
+	return ytpl_ytype(y, &k);
+}
+
+static void
+filt_cand(bitset383_t *restrict tgt, const bitint383_t *cand)
+{
+	int c;
+
+	for (bitint_iter_t ci = 0UL; (c = bi383_next(&ci, cand), ci);) {
+		if (LIKELY(c > 0 && c < 384)) {
+			bs383_set(tgt, c);
+		}
+	}
+	return;
+}
+
+static const bitset383_t*
+filt_days(struct rrulfc_s *restrict fc, unsigned int y)
+{
+	static const bitset383_t all = {
+		.w = {
+			-1U, -1U, -1U, -1U, -1U, -1U,
+			-1U, -1U, -1U, -1U, -1U, -1U,
+		}
+	};
+	uint32_t yt;
+	size_t k;
+
+	if (!fc->datp) {
+		return &all;
+	}
+	yt = filt_ytype(fc, y);
+	k = (yt ^ yt >> 5U ^ yt >> 12U) % RRULFC_NSLOT;
+	if (fc->yt[k] != yt) {
+		struct ymd_s c;
+		bitint383_t cand[3U] = {0U};
+
+		/* no defaults for months and days, leave them free */
+		make_ymd(&c, (echs_instant_t){.y = y}, &fc->rr, FREQ_YEARLY);
+		memset(fc->days + k, 0, sizeof(*fc->days));
+		yly_cand(cand, y, &fc->rr, &c);
+		filt_cand(fc->days + k, cand + 0U);
+		if (fc->rr.shift) {
+			/* collect spills from the years around */
+			memset(cand, 0, sizeof(cand));
+			yly_cand(cand, y - 1U, &fc->rr, &c);
+			filt_cand(fc->days + k, cand + 2U);
+			memset(cand, 0, sizeof(cand));
+			yly_cand(cand, y + 1U, &fc->rr, &c);
+			filt_cand(fc->days + k, cand + 1U);
+		}
+		fc->yt[k] = yt;
+	}
+	return fc->days + k;
+}
+
+void
+rrul_filt_compile(struct rrulfc_s *restrict tgt, rrulsp_t rr)
+{
+	int tmp;
+
+	memset(tgt, 0, sizeof(*tgt));
+	tgt->rr = *rr;
+	tgt->datp = bi31_has_bits_p(rr->dom) ||
+		bi447_has_bits_p(&rr->dow) ||
+		bui31_has_bits_p(rr->mon) ||
+		bi63_has_bits_p(rr->wk) ||
+		bi383_has_bits_p(&rr->doy) ||
+		bi383_has_bits_p(&rr->easter);
+	tgt->timp = bui31_has_bits_p(rr->H) ||
+		bui63_has_bits_p(rr->M) ||
+		bui63_has_bits_p(rr->S);
+
+	for (bitint_iter_t Hi = 0UL; (tmp = bui31_next(&Hi, rr->H), Hi);) {
+		tgt->H_mask |= 1U << tmp;
+	}
+	for (bitint_iter_t Mi = 0UL; (tmp = bui63_next(&Mi, rr->M), Mi);) {
+		tgt->M_mask |= 1ULL << tmp;
+	}
+	for (bitint_iter_t Si = 0UL; (tmp = bui63_next(&Si, rr->S), Si);) {
+		tgt->S_mask |= 1ULL << tmp;
+	}
+	tgt->H_mask = tgt->H_mask ?: ~tgt->H_mask;
+	tgt->M_mask = tgt->M_mask ?: ~tgt->M_mask;
+	tgt->S_mask = tgt->S_mask ?: ~tgt->S_mask;
+	return;
+}
+
+size_t
+rrul_filt(bool *restrict res, const echs_instant_t *i, size_t n,
+	  struct rrulfc_s *restrict fc)
+{
+	const bool regp = fc->rr.scale == SCALE_GREGORIAN;
+	const uint_fast32_t H_mask = fc->H_mask;
+	const uint_fast64_t M_mask = fc->M_mask;
+	const uint_fast64_t S_mask = fc->S_mask;
+	const unsigned int notp = !fc->timp;
+	const bitset383_t *ds = NULL;
+	unsigned int y = 0U;
+	size_t nres = 0U;
+
+	for (size_t k = 0U; k < n; k++) {
+		echs_instant_t x = i[k];
+		unsigned int r;
+
+		if (UNLIKELY(!regp)) {
+			x = echs_instant_detach_scale(
+				echs_instant_rescale(x, fc->rr.scale));
+		}
+		if (UNLIKELY(x.y != y || ds == NULL)) {
+			ds = filt_days(fc, y = x.y);
+		}
+		r = bs383_has_bit_p(ds, ((x.m - 1U) * 32U + x.d) % 384U);
+		/* all-day instants have H beyond 23 */
+		r &= notp | ((x.H < 24U) &
+			     (unsigned int)(H_mask >> (x.H & 0x1fU)) &
+			     (unsigned int)(M_mask >> (x.M & 0x3fU)) &
+			     (unsigned int)(S_mask >> (x.S & 0x3fU)) & 0b1U);
+		res[k] = r;
+		nres += r;
+	}
+	return nres;
+}
+
+bool
+echs_instant_matches_p(rrulsp_t filt, echs_instant_t inst)
+{
+	static struct rrulfc_s fc;
+	static rrulsp_t cfilt;
+	bool res;
+
+	if (UNLIKELY(filt != cfilt)) {
+		rrul_filt_compile(&fc, filt);
+		cfilt = filt;
+	}
+	(void)rrul_filt(&res, &inst, 1U, &fc);
+	return res;
 }
 
 /* evrrul.c ends here */
@@ -38,12 +38,14 @@
 #define INCLUDED_evrrul_h_
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include "evstrm.h"
 #include "instant.h"
 #include "bitint.h"
 #include "scale.h"
 #include "shift.h"
+#include "intern.h"
 
 typedef const struct rrulsp_s *rrulsp_t;
 
@@ -118,6 +120,7 @@ typedef enum {
 #define GET_NTH(spec)	((spec) >> 8U)
 #define GET_WDAY(spec)	((spec) & 0xfU)
 
+/* default fill size, streams adapt theirs */
 #define GRP_CCH_OFF	64U
 
 struct rrulsp_s {
@@ -127,6 +130,8 @@ struct rrulsp_s {
 	unsigned int inter;
 	echs_instant_t until;
 	echs_shift_t shift;
+	/* business day calendar for SHIFTs, 0 for weekends only */
+	obint_t cal;
 
 	bitint31_t dom;
 	bitint383_t doy;
@@ -150,7 +155,38 @@ struct cd_s {
 	echs_wday_t dow;
 };
 
+/* rrules compiled into the masks and time enumerations of their BY-parts
+ * along with a fill kernel specialised for the parts present */
+struct rrulcc_s {
+	size_t(*fill)(echs_instant_t *restrict tgt, size_t nti,
+		      rrulsp_t rr, const struct rrulcc_s *cc);
+
+	/* BYDAY, as given (bit 0 for counted days) and as filter */
+	uint8_t wd_bits;
+	uint8_t wd_mask;
+	/* weekday weekly periods start on, 0 if on the proto's */
+	uint8_t wd_anchor;
+	/* BYMONTH, BYMONTHDAY (from the front and the back) and BYHOUR,
+	 * BYMINUTE, BYSECOND as filters, all bits set if absent */
+	uint16_t m_mask;
+	uint32_t posd_mask;
+	uint32_t negd_mask;
+	uint32_t H_mask;
+	uint64_t M_mask;
+	uint64_t S_mask;
+
+	/* BYHOUR, BYMINUTE, BYSECOND enumerated, count 0 means proto's */
+	uint8_t nH, nM, nS;
+	uint8_t H[24U];
+	uint8_t M[60U];
+	uint8_t S[60U];
+};
+
 
+/**
+ * Fill TGT with at most NTI instants of RR, TGT[0] is the proto instant.
+ * TGT must have room for 2 * NTI instants, groups (if any) go to the
+ * upper half. */
 extern size_t
 rrul_fill_yly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr);
 
@@ -172,6 +208,82 @@ rrul_fill_Mly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr);
 extern size_t
 rrul_fill_Sly(echs_instant_t *restrict tgt, size_t nti, rrulsp_t rr);
 
+/**
+ * Compile RR into TGT.  The rule's COUNT and UNTIL are not compiled in,
+ * rrul_fill() reads them off RR as they change while unrolling.
+ * PROTO is the rule's first instant, weekly periods are anchored there
+ * no matter which instant later fills are started from. */
+extern void
+rrul_compile(struct rrulcc_s *restrict tgt, rrulsp_t rr, echs_instant_t proto);
+
+/**
+ * Like the rrul_fill_*() routines but using the kernel compiled into CC. */
+static inline size_t
+rrul_fill(echs_instant_t *restrict tgt, size_t nti,
+	  rrulsp_t rr, const struct rrulcc_s *cc)
+{
+	return cc->fill(tgt, nti, rr, cc);
+}
+
+/**
+ * Return an instant on the period grid of RR anchored at PROTO that
+ * lies well before TGT, or PROTO itself if there's no such instant.
+ * The result can be used as proto for the rrul_fill_*() routines to
+ * skip unrolling the past.  COUNT is not taken into account. */
+extern echs_instant_t
+rrul_seek(echs_instant_t proto, rrulsp_t rr, echs_instant_t tgt);
+
+/**
+ * Advance PROTO past at most N occurrences of RR (compiled into CC) so
+ * that it stays well before TGT and return the number of occurrences
+ * skipped.  YEARLY and MONTHLY rules are counted off their candidate
+ * sets period by period, HOURLY, MINUTELY and SECONDLY ones only when
+ * their BY* parts are finer than their frequency.  For all other rules
+ * 0 is returned and PROTO is left untouched.  COUNT is not taken into
+ * account. */
+extern size_t
+rrul_skip(echs_instant_t *restrict proto, rrulsp_t rr, size_t n,
+	  echs_instant_t tgt, const struct rrulcc_s *cc);
+
+/**
+ * Return the last instant of RR (compiled into CC) unrolled from PROTO,
+ * the nul instant if there are none, or echs_max_instant() if RR has
+ * neither COUNT nor UNTIL.  YEARLY and MONTHLY rules are counted off
+ * their candidate sets period by period instead of being unrolled. */
+extern echs_instant_t
+rrul_last(echs_instant_t proto, rrulsp_t rr, const struct rrulcc_s *cc);
+
+/* rrules as filters, compiled into the days they select in the years
+ * seen so far, cached by year type, and masks of their time parts */
+#define RRULFC_NSLOT	(32U)
+
+struct rrulfc_s {
+	struct rrulsp_s rr;
+	/* whether there's date or time parts to check */
+	bool datp;
+	bool timp;
+	/* BYHOUR, BYMINUTE, BYSECOND as masks, all bits set if absent */
+	uint32_t H_mask;
+	uint64_t M_mask;
+	uint64_t S_mask;
+	/* year types, 0 for empty slots, and their days packed like
+	 * candidates, (m - 1) * 32 + d */
+	uint32_t yt[RRULFC_NSLOT];
+	bitset383_t days[RRULFC_NSLOT];
+};
+
+/**
+ * Compile RR, a rule without frequency, into filter TGT. */
+extern void rrul_filt_compile(struct rrulfc_s *restrict tgt, rrulsp_t rr);
+
+/**
+ * Set RES[i] to whether the (scale-detached) instant I[i] passes
+ * filter FC, for N instants, and return the number of passes.
+ * All-day instants never pass filters with time parts. */
+extern size_t
+rrul_filt(bool *restrict res, const echs_instant_t *i, size_t n,
+	  struct rrulfc_s *restrict fc);
+
 extern bool echs_instant_matches_p(rrulsp_t f, echs_instant_t i);
 
 
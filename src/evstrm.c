@@ -38,9 +38,13 @@
 # include "config.h"
 #endif	/* HAVE_CONFIG_H */
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "evstrm.h"
+#include "slab.h"
 #include "nifty.h"
 
 
@@ -51,22 +55,44 @@ struct evmux_s {
 	size_t ns;
 	/** all them streams */
 	echs_evstrm_t *s;
-	/** event cache */
-	echs_event_t ev[];
+	/** number of live streams, i.e. the size of the heap */
+	size_t nh;
+	/** event cache, organised as binary min-heap over NH cells */
+	struct evmux_cell_s {
+		/** the cached event */
+		echs_event_t ev;
+		/** index of the stream the event came from */
+		size_t si;
+	} ev[];
 };
 
 static echs_event_t next_evmux(echs_evstrm_t, bool popp);
 static void free_evmux(echs_evstrm_t);
 static echs_evstrm_t clone_evmux(echs_const_evstrm_t);
 static void seria_evmux(int, echs_const_evstrm_t);
+static size_t
+next_batch_evmux(echs_evstrm_t, echs_event_t*restrict, size_t, echs_instant_t);
+static void seek_evmux(echs_evstrm_t, echs_instant_t);
+static void clip_evmux(echs_evstrm_t, echs_instant_t);
+static size_t skip_evmux(echs_evstrm_t, size_t, echs_instant_t);
+static echs_event_t prev_evmux(echs_const_evstrm_t, echs_instant_t);
+static echs_event_t last_evmux(echs_const_evstrm_t);
 
 static const struct echs_evstrm_class_s evmux_cls = {
 	.next = next_evmux,
 	.free = free_evmux,
 	.clone = clone_evmux,
 	.seria = seria_evmux,
+	.next_batch = next_batch_evmux,
+	.seek = seek_evmux,
+	.clip = clip_evmux,
+	.skip = skip_evmux,
+	.prev = prev_evmux,
+	.last = last_evmux,
 };
 
+static struct echs_slab_s evmux_slab = ECHS_SLAB_INIT("evmux");
+
 static void
 seria_evmux(int whither, echs_const_evstrm_t strm)
 {
@@ -78,67 +104,311 @@ seria_evmux(int whither, echs_const_evstrm_t strm)
 	return;
 }
 
-static echs_event_t
-next_evmux(echs_evstrm_t strm, bool popp)
+/* heap helpers, cells are ordered by event instant first and
+ * stream index second, so simultaneous events are returned in
+ * the order of their streams, just like a linear scan would */
+static inline __attribute__((pure)) bool
+evmux_cell_lt_p(const struct evmux_cell_s *c1, const struct evmux_cell_s *c2)
 {
-	static const echs_event_t nul = {0U};
-	struct evmux_s *this = (struct evmux_s*)strm;
-	echs_event_t best;
-	size_t besti;
-	size_t i;
+	if (echs_event_lt_p(c1->ev, c2->ev)) {
+		return true;
+	} else if (echs_instant_eq_p(c1->ev.from, c2->ev.from)) {
+		return c1->si < c2->si;
+	}
+	return false;
+}
+
+static void
+evmux_sift_up(struct evmux_s *this, size_t k)
+{
+	struct evmux_cell_s c = this->ev[k];
+
+	while (k > 0U) {
+		size_t p = (k - 1U) / 2U;
+
+		if (!evmux_cell_lt_p(&c, this->ev + p)) {
+			break;
+		}
+		this->ev[k] = this->ev[p];
+		k = p;
+	}
+	this->ev[k] = c;
+	return;
+}
+
+static void
+evmux_sift_down(struct evmux_s *this, size_t k)
+{
+	struct evmux_cell_s c = this->ev[k];
+	const size_t nh = this->nh;
+
+	for (size_t l; (l = 2U * k + 1U) < nh;) {
+		/* find the smaller child */
+		if (l + 1U < nh && evmux_cell_lt_p(this->ev + l + 1U, this->ev + l)) {
+			l++;
+		}
+		if (!evmux_cell_lt_p(this->ev + l, &c)) {
+			break;
+		}
+		this->ev[k] = this->ev[l];
+		k = l;
+	}
+	this->ev[k] = c;
+	return;
+}
 
-	if (UNLIKELY(this->s == NULL)) {
-		return (echs_event_t){0};
-	} else if (UNLIKELY(echs_max_instant_p(this->ev[0].from))) {
+static void
+evmux_refill(struct evmux_s *this, size_t k)
+{
+/* refill heap cell K with the next event of its stream,
+ * streams that run dry are removed from the heap */
+	this->ev[k].ev = echs_evstrm_next(this->s[this->ev[k].si]);
+	if (UNLIKELY(echs_event_0_p(this->ev[k].ev))) {
+		/* move the last cell here */
+		if (k == --this->nh) {
+			return;
+		}
+		this->ev[k] = this->ev[this->nh];
+	}
+	/* streams should be monotonic but be defensive about it */
+	evmux_sift_up(this, k);
+	evmux_sift_down(this, k);
+	return;
+}
+
+static void
+evmux_advance(struct evmux_s *this, size_t k)
+{
+/* pop the event in heap cell K off its stream and refill the cell */
+	(void)echs_evstrm_pop(this->s[this->ev[k].si]);
+	evmux_refill(this, k);
+	return;
+}
+
+static size_t
+evmux_find_dup(const struct evmux_s *this, size_t k, echs_event_t e)
+{
+/* find a cell in the subtree rooted at K that is a duplicate of E,
+ * the root itself is never reported, 0 means no duplicate,
+ * all cells with the same instant as the root form a subtree at the
+ * top of the heap so we can prune as soon as the instants differ */
+	if (k >= this->nh || !echs_instant_eq_p(this->ev[k].ev.from, e.from)) {
+		return 0U;
+	} else if (k && echs_event_eq_p(this->ev[k].ev, e)) {
+		return k;
+	}
+	with (size_t r = evmux_find_dup(this, 2U * k + 1U, e)) {
+		if (r) {
+			return r;
+		}
+	}
+	return evmux_find_dup(this, 2U * k + 2U, e);
+}
+
+static const struct evmux_cell_s*
+evmux_top(struct evmux_s *this)
+{
+/* return the heap cell with the earliest event or NULL if all streams
+ * are exhausted, duplicates of the earliest event are dropped here */
+	if (UNLIKELY(echs_max_instant_p(this->ev[0].ev.from))) {
 		/* precache events, the max instant in ev[0] is the indicator
 		 * regardless of POPP we prefill without popping */
+		this->nh = 0U;
 		for (size_t j = 0UL; j < this->ns; j++) {
 			echs_evstrm_t s = this->s[j];
-			this->ev[j] = echs_evstrm_next(s);
+			echs_event_t e = echs_evstrm_next(s);
+
+			if (!echs_event_0_p(e)) {
+				this->ev[this->nh++] = (struct evmux_cell_s){e, j};
+			}
 		}
+		/* heapify */
+		for (size_t j = this->nh / 2U; j-- > 0U;) {
+			evmux_sift_down(this, j);
+		}
+	}
+	/* quick check if we hit the event boundary */
+	if (UNLIKELY(this->nh == 0U)) {
+		/* yep, keep the streams though, they still know what they
+		 * yielded for look-behinds, just don't precache again */
+		this->ev[0].ev = echs_nul_event();
+		return NULL;
 	}
-	/* best event so-far is the first non-null event */
-	for (i = 0U; i < this->ns; i++) {
-		best = this->ev[i];
+	/* drop duplicates of the top, should this be optional? --uniq? */
+	for (size_t k; (k = evmux_find_dup(this, 0U, this->ev[0].ev));) {
+		evmux_advance(this, k);
+	}
+	return this->ev;
+}
 
-		if (!echs_event_0_p(best)) {
-			besti = i;
+static echs_event_t
+next_evmux(echs_evstrm_t strm, bool popp)
+{
+	static const echs_event_t nul = {0U};
+	struct evmux_s *this = (struct evmux_s*)strm;
+	const struct evmux_cell_s *top;
+	echs_event_t best;
+
+	if (UNLIKELY((top = evmux_top(this)) == NULL)) {
+		return nul;
+	}
+	/* best event is at the top */
+	best = top->ev;
+	/* return best but refill its cell in popping mode */
+	if (popp) {
+		evmux_advance(this, 0U);
+	}
+	return best;
+}
+
+static size_t
+next_batch_evmux(
+	echs_evstrm_t strm, echs_event_t *restrict buf, size_t nbuf,
+	echs_instant_t till)
+{
+	struct evmux_s *this = (struct evmux_s*)strm;
+	const struct evmux_cell_s *top;
+	size_t n;
+
+	for (n = 0U; n < nbuf && (top = evmux_top(this)) != NULL; n++) {
+		if (echs_event_beyond_p(top->ev, till)) {
 			break;
 		}
+		buf[n] = top->ev;
+		evmux_advance(this, 0U);
 	}
-	/* quick check if we hit the event boundary */
-	if (UNLIKELY(i >= this->ns)) {
-		/* yep, bugger off free the streams and the stream array here */
-		for (size_t j = 0U; j < this->ns; j++) {
-			free_echs_evstrm(this->s[j]);
+	return n;
+}
+
+static void
+seek_evmux(echs_evstrm_t strm, echs_instant_t from)
+{
+	struct evmux_s *this = (struct evmux_s*)strm;
+
+	for (size_t i = 0U; i < this->ns; i++) {
+		if (LIKELY(this->s[i] != NULL)) {
+			echs_evstrm_seek(this->s[i], from);
 		}
-		free(this->s);
-		this->s = NULL;
-		return nul;
 	}
-	/* otherwise try and find an earlier event */
-	for (i++; i < this->ns; i++) {
-		echs_event_t ecur = this->ev[i];
+	/* the heap is stale now, have next_evmux() precache again */
+	this->ev[0].ev.from = echs_max_instant();
+	return;
+}
 
-		if (echs_event_0_p(ecur)) {
+static void
+clip_evmux(echs_evstrm_t strm, echs_instant_t till)
+{
+	struct evmux_s *this = (struct evmux_s*)strm;
+
+	/* cached events are fine, they've been generated already */
+	for (size_t i = 0U; i < this->ns; i++) {
+		if (LIKELY(this->s[i] != NULL)) {
+			echs_evstrm_clip(this->s[i], till);
+		}
+	}
+	return;
+}
+
+static inline __attribute__((const, pure)) echs_instant_t
+instant_pred(echs_instant_t x)
+{
+/* the instant right before X in the order of echs_instant_lt_p() */
+	x.H++, x.ms++;
+	x.u--;
+	x.H--, x.ms--;
+	return x;
+}
+
+static size_t
+skip_evmux(echs_evstrm_t strm, size_t n, echs_instant_t till)
+{
+/* let the top stream skip everything before the runner-up's head in one
+ * go, ties are popped one by one so duplicates are still dropped */
+	struct evmux_s *this = (struct evmux_s*)strm;
+	const struct evmux_cell_s *top;
+	size_t res = 0U;
+
+	while (res < n && (top = evmux_top(this)) != NULL) {
+		echs_instant_t lim = till;
+		size_t m;
+
+		if (echs_event_beyond_p(top->ev, till)) {
+			break;
+		} else if (this->nh > 1U) {
+			/* the runner-up is one of the root's children */
+			size_t r = 1U;
+
+			if (this->nh > 2U &&
+			    evmux_cell_lt_p(this->ev + 2U, this->ev + 1U)) {
+				r = 2U;
+			}
+			with (echs_instant_t x = this->ev[r].ev.from) {
+				x = instant_pred(echs_instant_detach_scale(x));
+				if (echs_instant_lt_p(x, lim)) {
+					lim = x;
+				}
+			}
+		}
+		if (!(m = echs_evstrm_skip(this->s[top->si], n - res, lim))) {
+			/* tied with the runner-up */
+			evmux_advance(this, 0U);
+			res++;
 			continue;
-		} else if (echs_event_lt_p(ecur, best)) {
-			best = ecur;
-			besti = i;
-		} else if (echs_event_eq_p(ecur, best)) {
-			/* should this be optional? --uniq? */
-			echs_evstrm_t s = this->s[i];
-			(void)echs_evstrm_pop(s);
-			this->ev[i] = echs_evstrm_next(s);
 		}
+		res += m;
+		evmux_refill(this, 0U);
 	}
-	/* return best but refill besti in popping mode */
-	if (popp) {
-		echs_evstrm_t s = this->s[besti];
-		(void)echs_evstrm_pop(s);
-		this->ev[besti] = echs_evstrm_next(s);
+	return res;
+}
+
+static echs_event_t
+prev_evmux(echs_const_evstrm_t strm, echs_instant_t before)
+{
+/* the latest of all the streams' previous events */
+	const struct evmux_s *this = (const struct evmux_s*)strm;
+	echs_event_t res = echs_nul_event();
+
+	for (size_t i = 0U; i < this->ns; i++) {
+		echs_event_t e;
+
+		if (UNLIKELY(this->s[i] == NULL)) {
+			continue;
+		} else if (echs_event_0_p(e = echs_evstrm_prev(this->s[i], before))) {
+			continue;
+		} else if (echs_event_0_p(res) ||
+			   echs_instant_lt_p(
+				   echs_instant_detach_scale(res.from),
+				   echs_instant_detach_scale(e.from))) {
+			res = e;
+		}
 	}
-	return best;
+	return res;
+}
+
+static echs_event_t
+last_evmux(echs_const_evstrm_t strm)
+{
+/* the latest of all the streams' last events, unbounded ones win */
+	const struct evmux_s *this = (const struct evmux_s*)strm;
+	echs_event_t res = echs_nul_event();
+
+	for (size_t i = 0U; i < this->ns; i++) {
+		echs_event_t e;
+
+		if (UNLIKELY(this->s[i] == NULL)) {
+			continue;
+		} else if (echs_event_0_p(e = echs_evstrm_last(this->s[i]))) {
+			continue;
+		} else if (echs_max_instant_p(e.from)) {
+			return e;
+		} else if (echs_event_0_p(res) ||
+			   echs_instant_lt_p(
+				   echs_instant_detach_scale(res.from),
+				   echs_instant_detach_scale(e.from))) {
+			res = e;
+		}
+	}
+	return res;
 }
 
 static echs_evstrm_t
@@ -155,17 +425,20 @@ make_evmux(echs_evstrm_t s[], size_t ns)
 		goto trivial;
 	}
 	/* otherwise we have to resort to merge-sorting aka muxing */
-	res = malloc(sizeof(*res) + ns * sizeof(*res->ev));
+	with (size_t z = sizeof(*res) + ns * sizeof(*res->ev)) {
+		res = echs_slab_alloc(&evmux_slab, z);
+	}
 	if (UNLIKELY(res == NULL)) {
 		return NULL;
 	}
 	res->class = &evmux_cls;
 	res->ns = ns;
 	res->s = s;
+	res->nh = 0U;
 	/* we used to precache events here but seeing as not every
 	 * echse command would need the unrolled stream we leave it
 	 * to next_evmux(), put an indicator into the event cache here */
-	res->ev[0].from = echs_max_instant();
+	res->ev[0].ev.from = echs_max_instant();
 	return (echs_evstrm_t)res;
 
 trivial:
@@ -179,15 +452,13 @@ free_evmux(echs_evstrm_t s)
 {
 	struct evmux_s *this = (struct evmux_s*)s;
 
-	if (LIKELY(this->s != NULL)) {
-		for (size_t i = 0; i < this->ns; i++) {
-			if (LIKELY(this->s[i] != NULL)) {
-				free_echs_evstrm(this->s[i]);
-			}
+	for (size_t i = 0; i < this->ns; i++) {
+		if (LIKELY(this->s[i] != NULL)) {
+			free_echs_evstrm(this->s[i]);
 		}
-		free(this->s);
 	}
-	free(this);
+	free(this->s);
+	echs_slab_free(&evmux_slab, this);
 	return;
 }
 
@@ -197,11 +468,8 @@ clone_evmux(echs_const_evstrm_t s)
 	const struct evmux_s *this = (const struct evmux_s*)s;
 	struct evmux_s *res;
 
-	if (UNLIKELY(this->s == NULL)) {
-		return NULL;
-	}
 	with (size_t z = this->ns * sizeof(*this->ev) + sizeof(*this)) {
-		res = malloc(z);
+		res = echs_slab_alloc(&evmux_slab, z);
 		if (UNLIKELY(res == NULL)) {
 			return NULL;
 		}
@@ -210,7 +478,7 @@ clone_evmux(echs_const_evstrm_t s)
 	/* clone all streams */
 	res->s = malloc(this->ns * sizeof(*this->s));
 	if (UNLIKELY(res->s == NULL)) {
-		free(res);
+		echs_slab_free(&evmux_slab, res);
 		return NULL;
 	}
 	for (size_t i = 0U; i < this->ns; i++) {
@@ -239,7 +507,7 @@ echs_evstrm_mux(echs_evstrm_t s, ...)
 		return NULL;
 	}
 	/* otherwise we've got at least 1 argument */
-	strm = malloc((allocz = 16U) + sizeof(*strm));
+	strm = malloc((allocz = 16U) * sizeof(*strm));
 	if (UNLIKELY(strm == NULL)) {
 		return NULL;
 	}
@@ -252,14 +520,14 @@ echs_evstrm_mux(echs_evstrm_t s, ...)
 			}
 			strm = x;
 		}
-		strm[nstrm++] = clone_echs_evstrm(s);
+		strm[nstrm++] = s;
 	}
 	va_end(ap);
 	return make_evmux(strm, nstrm);
 free:
 	va_end(ap);
 	for (size_t i = 0U; i < nstrm; i++) {
-		free(strm[i]);
+		free_echs_evstrm(strm[i]);
 	}
 	free(strm);
 	return NULL;
@@ -277,7 +545,7 @@ echs_evstrm_mux_clon(echs_evstrm_t s, ...)
 		return NULL;
 	}
 	/* otherwise we've got at least 1 argument */
-	strm = malloc((allocz = 16U) + sizeof(*strm));
+	strm = malloc((allocz = 16U) * sizeof(*strm));
 	if (UNLIKELY(strm == NULL)) {
 		return NULL;
 	}
@@ -290,14 +558,14 @@ echs_evstrm_mux_clon(echs_evstrm_t s, ...)
 			}
 			strm = x;
 		}
-		strm[nstrm++] = s;
+		strm[nstrm++] = clone_echs_evstrm(s);
 	}
 	va_end(ap);
 	return make_evmux(strm, nstrm);
 free:
 	va_end(ap);
 	for (size_t i = 0U; i < nstrm; i++) {
-		free(strm[i]);
+		free_echs_evstrm(strm[i]);
 	}
 	free(strm);
 	return NULL;
@@ -370,7 +638,7 @@ echs_evstrm_vmux_clon(const echs_evstrm_t s[], size_t n)
 	if (UNLIKELY(nstrm == 0UL)) {
 		return NULL;
 	} else if (UNLIKELY(nstrm == 1UL)) {
-		return s[strm1];
+		return clone_echs_evstrm(s[strm1]);
 	}
 	/* otherwise make a copy of S and then pass it to
 	 * our make_evstrm(), it's the right signature already */
@@ -406,17 +674,744 @@ echs_evstrm_demux(echs_evstrm_t *restrict tgt, size_t tsz,
 	return res;
 }
 
+size_t
+echs_evstrm_next_batch_gen(echs_evstrm_t s,
+			   echs_event_t *restrict buf, size_t nbuf,
+			   echs_instant_t till)
+{
+	size_t n;
+
+	for (n = 0U; n < nbuf; n++) {
+		echs_event_t e = echs_evstrm_next(s);
+
+		if (UNLIKELY(echs_event_0_p(e))) {
+			break;
+		} else if (echs_event_beyond_p(e, till)) {
+			break;
+		}
+		(void)echs_evstrm_pop(s);
+		buf[n] = e;
+	}
+	return n;
+}
+
+void
+echs_evstrm_seek_gen(echs_evstrm_t s, echs_instant_t from)
+{
+	echs_event_t e;
+
+	while (!echs_event_0_p(e = echs_evstrm_next(s)) &&
+	       echs_event_before_p(e, from)) {
+		(void)echs_evstrm_pop(s);
+	}
+	return;
+}
+
+echs_event_t
+echs_evstrm_prev_gen(echs_const_evstrm_t s, echs_instant_t before)
+{
+	echs_event_t res = echs_nul_event();
+	echs_evstrm_t clon;
+
+	if (UNLIKELY((clon = s->class->clone(s)) == NULL)) {
+		return res;
+	}
+	for (echs_event_t e;
+	     !echs_event_0_p(e = echs_evstrm_pop(clon)) &&
+		     echs_event_before_p(e, before);) {
+		res = e;
+	}
+	free_echs_evstrm(clon);
+	return res;
+}
+
+size_t
+echs_evstrm_skip_gen(echs_evstrm_t s, size_t n, echs_instant_t till)
+{
+	echs_event_t buf[64U];
+	size_t res = 0U;
+
+	for (size_t m; res < n; res += m) {
+		const size_t nbuf = n - res < countof(buf) ? n - res : countof(buf);
+
+		if (!(m = echs_evstrm_next_batch(s, buf, nbuf, till))) {
+			break;
+		}
+	}
+	return res;
+}
+
+size_t
+echs_evstrm_count(echs_evstrm_t s, echs_instant_t from, echs_instant_t till)
+{
+	if (UNLIKELY(s == NULL)) {
+		return 0U;
+	}
+	if (!echs_nul_instant_p(from) && !echs_min_instant_p(from)) {
+		echs_evstrm_seek(s, from);
+	}
+	echs_evstrm_clip(s, till);
+	return echs_evstrm_skip(s, SIZE_MAX, till);
+}
+
+echs_event_t
+echs_evstrm_nth(echs_evstrm_t s, size_t n)
+{
+	if (UNLIKELY(s == NULL || n == 0U)) {
+		return echs_nul_event();
+	} else if (echs_evstrm_skip(s, n - 1U, echs_max_instant()) < n - 1U) {
+		return echs_nul_event();
+	}
+	return echs_evstrm_pop(s);
+}
+
+
+/* tee streams */
+struct evtee_buf_s {
+	/** the generator, kept after it's run dry for look-behinds */
+	echs_evstrm_t s;
+	bool dryp;
+	/** ring buffer of generated events, CAP is a power of 2 */
+	echs_event_t *ev;
+	size_t cap;
+	/** absolute indices of the oldest and one past the newest event */
+	size_t beg;
+	size_t end;
+	/** number of cursors sitting at BEG */
+	size_t nbeg;
+	/** all cursors reading off this buffer, NCUR is the ref count */
+	struct evtee_s **cur;
+	size_t ncur;
+	size_t zcur;
+};
+
+struct evtee_s {
+	echs_evstrm_class_t class;
+	/** shared buffer */
+	struct evtee_buf_s *b;
+	/** absolute index of the next event */
+	size_t pos;
+};
+
+static echs_event_t next_evtee(echs_evstrm_t, bool popp);
+static void free_evtee(echs_evstrm_t);
+static echs_evstrm_t clone_evtee(echs_const_evstrm_t);
+static void seria_evtee(int, echs_const_evstrm_t);
+static void seek_evtee(echs_evstrm_t, echs_instant_t);
+static void clip_evtee(echs_evstrm_t, echs_instant_t);
+static echs_event_t prev_evtee(echs_const_evstrm_t, echs_instant_t);
+static echs_event_t last_evtee(echs_const_evstrm_t);
+
+static const struct echs_evstrm_class_s evtee_cls = {
+	.next = next_evtee,
+	.free = free_evtee,
+	.clone = clone_evtee,
+	.seria = seria_evtee,
+	.seek = seek_evtee,
+	.clip = clip_evtee,
+	.prev = prev_evtee,
+	.last = last_evtee,
+};
+
+static struct echs_slab_s evtee_slab = ECHS_SLAB_INIT("evtee");
+
+/* cursors falling this many events behind are split off */
+#define EVTEE_CAP_MAX	(4096U)
+
+static void
+evtee_trim(struct evtee_buf_s *b)
+{
+/* find the slowest cursor(s) and drop everything before them */
+	size_t min = b->end;
+	size_t nmin = 0U;
+
+	for (size_t i = 0U; i < b->ncur; i++) {
+		if (b->cur[i]->pos < min) {
+			min = b->cur[i]->pos;
+			nmin = 1U;
+		} else if (b->cur[i]->pos == min) {
+			nmin++;
+		}
+	}
+	b->beg = min;
+	b->nbeg = nmin;
+	return;
+}
+
+static int evtee_split(struct evtee_buf_s *b);
+
+static int
+evtee_fill(struct evtee_buf_s *b)
+{
+/* pull one event off the generator and append it to the ring,
+ * return -1 if the generator is exhausted or the ring cannot grow */
+	echs_event_t e;
+
+	if (UNLIKELY(b->dryp)) {
+		return -1;
+	}
+	/* cursors lagging too far behind go their own way */
+	while (b->end - b->beg >= EVTEE_CAP_MAX && !evtee_split(b));
+	if (UNLIKELY(b->end - b->beg >= b->cap)) {
+		/* double the ring, unwrapping it on the go,
+		 * do this before popping so a failure won't lose events */
+		const size_t ncap = b->cap ? b->cap * 2U : 64U;
+		echs_event_t *nev = malloc(ncap * sizeof(*nev));
+
+		if (UNLIKELY(nev == NULL)) {
+			return -1;
+		}
+		for (size_t i = b->beg; i < b->end; i++) {
+			nev[i & (ncap - 1U)] = b->ev[i & (b->cap - 1U)];
+		}
+		free(b->ev);
+		b->ev = nev;
+		b->cap = ncap;
+	}
+	if (UNLIKELY(echs_event_0_p(e = echs_evstrm_pop(b->s)))) {
+		b->dryp = true;
+		return -1;
+	}
+	b->ev[b->end++ & (b->cap - 1U)] = e;
+	return 0;
+}
+
+static void
+evtee_advance(struct evtee_s *this)
+{
+	struct evtee_buf_s *b = this->b;
+
+	if (this->pos++ == b->beg && !--b->nbeg) {
+		/* we were the last of the slowest */
+		evtee_trim(b);
+	}
+	return;
+}
+
+static int
+evtee_split(struct evtee_buf_s *b)
+{
+/* move the slowest cursors onto a buffer of their own that is fed by a
+ * clone of the generator, return -1 if that can't be done */
+	struct evtee_buf_s *nb;
+	echs_evstrm_t s;
+
+	if (UNLIKELY((s = clone_echs_evstrm(b->s)) == NULL)) {
+		return -1;
+	} else if (UNLIKELY((nb = echs_slab_calloc(
+			     &evtee_slab, sizeof(*nb))) == NULL)) {
+		goto nomem;
+	} else if (UNLIKELY((nb->ev = malloc(b->cap * sizeof(*nb->ev))) == NULL)) {
+		goto nomem;
+	} else if (UNLIKELY((nb->cur = malloc(b->nbeg * sizeof(*nb->cur))) == NULL)) {
+		goto nomem;
+	}
+	/* positions are absolute, keep them */
+	memcpy(nb->ev, b->ev, b->cap * sizeof(*nb->ev));
+	nb->s = s;
+	nb->cap = b->cap;
+	nb->beg = b->beg;
+	nb->end = b->end;
+	nb->zcur = b->nbeg;
+	for (size_t i = 0U; i < b->ncur;) {
+		struct evtee_s *c = b->cur[i];
+
+		if (c->pos != b->beg) {
+			i++;
+			continue;
+		}
+		c->b = nb;
+		nb->cur[nb->ncur++] = c;
+		b->cur[i] = b->cur[--b->ncur];
+	}
+	nb->nbeg = nb->ncur;
+	evtee_trim(b);
+	return 0;
+
+nomem:
+	if (nb != NULL) {
+		free(nb->ev);
+		echs_slab_free(&evtee_slab, nb);
+	}
+	free_echs_evstrm(s);
+	return -1;
+}
+
+static struct evtee_s*
+make_evtee(struct evtee_buf_s *b, size_t pos)
+{
+	struct evtee_s *res;
+
+	if (UNLIKELY(b->ncur >= b->zcur)) {
+		const size_t nz = b->zcur ? b->zcur * 2U : 4U;
+		void *nu = realloc(b->cur, nz * sizeof(*b->cur));
+
+		if (UNLIKELY(nu == NULL)) {
+			return NULL;
+		}
+		b->cur = nu;
+		b->zcur = nz;
+	}
+	res = echs_slab_alloc(&evtee_slab, sizeof(*res));
+	if (UNLIKELY(res == NULL)) {
+		return NULL;
+	}
+	res->class = &evtee_cls;
+	res->b = b;
+	res->pos = pos;
+	b->cur[b->ncur++] = res;
+	if (pos == b->beg) {
+		b->nbeg++;
+	}
+	return res;
+}
+
+static echs_event_t
+next_evtee(echs_evstrm_t s, bool popp)
+{
+	struct evtee_s *this = (struct evtee_s*)s;
+	struct evtee_buf_s *b = this->b;
+	echs_event_t res;
+
+	if (this->pos >= b->end && evtee_fill(b) < 0) {
+		return echs_nul_event();
+	}
+	res = b->ev[this->pos & (b->cap - 1U)];
+	if (popp) {
+		evtee_advance(this);
+	}
+	return res;
+}
+
+static void
+free_evtee(echs_evstrm_t s)
+{
+	struct evtee_s *this = (struct evtee_s*)s;
+	struct evtee_buf_s *b = this->b;
+	const size_t pos = this->pos;
+
+	/* unregister */
+	for (size_t i = 0U; i < b->ncur; i++) {
+		if (b->cur[i] == this) {
+			b->cur[i] = b->cur[--b->ncur];
+			break;
+		}
+	}
+	echs_slab_free(&evtee_slab, this);
+	if (b->ncur) {
+		if (pos == b->beg && !--b->nbeg) {
+			evtee_trim(b);
+		}
+		return;
+	}
+	/* last one out turns off the lights */
+	free_echs_evstrm(b->s);
+	free(b->ev);
+	free(b->cur);
+	echs_slab_free(&evtee_slab, b);
+	return;
+}
+
+static echs_evstrm_t
+clone_evtee(echs_const_evstrm_t s)
+{
+	const struct evtee_s *this = (const struct evtee_s*)s;
+
+	return (echs_evstrm_t)make_evtee(this->b, this->pos);
+}
+
+static void
+seria_evtee(int whither, echs_const_evstrm_t s)
+{
+/* cursors don't have a life of their own, serialise the generator */
+	const struct evtee_s *this = (const struct evtee_s*)s;
+
+	if (LIKELY(!this->b->dryp)) {
+		echs_evstrm_seria(whither, this->b->s);
+	}
+	return;
+}
+
+static void
+seek_evtee(echs_evstrm_t s, echs_instant_t from)
+{
+	struct evtee_s *this = (struct evtee_s*)s;
+	struct evtee_buf_s *b = this->b;
+
+	if (b->ncur == 1U) {
+		/* sole reader, skip what's buffered first, peeked events
+		 * included, then let the generator do the skipping */
+		while (this->pos < b->end &&
+		       echs_event_before_p(b->ev[this->pos & (b->cap - 1U)], from)) {
+			evtee_advance(this);
+		}
+		if (this->pos == b->end && !b->dryp) {
+			echs_evstrm_seek(b->s, from);
+		}
+		return;
+	}
+	echs_evstrm_seek_gen(s, from);
+	return;
+}
+
+static void
+clip_evtee(echs_evstrm_t s, echs_instant_t till)
+{
+	struct evtee_s *this = (struct evtee_s*)s;
+	struct evtee_buf_s *b = this->b;
+
+	if (b->ncur == 1U && !b->dryp) {
+		/* sole reader, noone else could want more */
+		echs_evstrm_clip(b->s, till);
+	}
+	return;
+}
+
+static echs_event_t
+prev_evtee(echs_const_evstrm_t s, echs_instant_t before)
+{
+	const struct evtee_s *this = (const struct evtee_s*)s;
+
+	/* the generator looks behind all events it yielded */
+	return echs_evstrm_prev(this->b->s, before);
+}
+
+static echs_event_t
+last_evtee(echs_const_evstrm_t s)
+{
+	const struct evtee_s *this = (const struct evtee_s*)s;
+
+	return echs_evstrm_last(this->b->s);
+}
+
+echs_evstrm_t
+echs_evstrm_tee(echs_evstrm_t s)
+{
+	struct evtee_buf_s *b;
+	struct evtee_s *res;
+
+	if (UNLIKELY(s == NULL)) {
+		return NULL;
+	} else if (s->class == &evtee_cls) {
+		/* already shared */
+		return s;
+	} else if (UNLIKELY((b = echs_slab_calloc(
+			     &evtee_slab, sizeof(*b))) == NULL)) {
+		return NULL;
+	}
+	b->s = s;
+	if (UNLIKELY((res = make_evtee(b, 0U)) == NULL)) {
+		free(b->cur);
+		echs_slab_free(&evtee_slab, b);
+		return NULL;
+	}
+	return (echs_evstrm_t)res;
+}
+
+echs_evstrm_t
+echs_evstrm_share(echs_evstrm_t *s)
+{
+	echs_evstrm_t t;
+
+	if (UNLIKELY(*s == NULL)) {
+		return NULL;
+	} else if (UNLIKELY((t = echs_evstrm_tee(*s)) == NULL)) {
+		/* fall back to a deep copy */
+		return clone_echs_evstrm(*s);
+	}
+	*s = t;
+	return clone_echs_evstrm(t);
+}
+
+
+/* window streams */
+struct evwin_s {
+	echs_evstrm_class_t class;
+	/** the stream we're looking at */
+	echs_evstrm_t s;
+	/** no events after this */
+	echs_instant_t till;
+};
+
+static echs_event_t next_evwin(echs_evstrm_t, bool popp);
+static void free_evwin(echs_evstrm_t);
+static echs_evstrm_t clone_evwin(echs_const_evstrm_t);
+static void seria_evwin(int, echs_const_evstrm_t);
+static size_t
+next_batch_evwin(echs_evstrm_t, echs_event_t*restrict, size_t, echs_instant_t);
+static void seek_evwin(echs_evstrm_t, echs_instant_t);
+static void clip_evwin(echs_evstrm_t, echs_instant_t);
+static size_t skip_evwin(echs_evstrm_t, size_t, echs_instant_t);
+static echs_event_t prev_evwin(echs_const_evstrm_t, echs_instant_t);
+static echs_event_t last_evwin(echs_const_evstrm_t);
+
+static const struct echs_evstrm_class_s evwin_cls = {
+	.next = next_evwin,
+	.free = free_evwin,
+	.clone = clone_evwin,
+	.seria = seria_evwin,
+	.next_batch = next_batch_evwin,
+	.seek = seek_evwin,
+	.clip = clip_evwin,
+	.skip = skip_evwin,
+	.prev = prev_evwin,
+	.last = last_evwin,
+};
+
+static struct echs_slab_s evwin_slab = ECHS_SLAB_INIT("evwin");
+
+static echs_evstrm_t
+make_evwin(echs_evstrm_t s, echs_instant_t till)
+{
+	struct evwin_s *res;
+
+	res = echs_slab_alloc(&evwin_slab, sizeof(*res));
+	if (UNLIKELY(res == NULL)) {
+		return NULL;
+	}
+	res->class = &evwin_cls;
+	res->s = s;
+	res->till = till;
+	return (echs_evstrm_t)res;
+}
+
+static echs_event_t
+next_evwin(echs_evstrm_t s, bool popp)
+{
+	struct evwin_s *this = (struct evwin_s*)s;
+	echs_event_t e = echs_evstrm_next(this->s);
+
+	if (UNLIKELY(echs_event_0_p(e))) {
+		return e;
+	} else if (echs_event_beyond_p(e, this->till)) {
+		return echs_nul_event();
+	} else if (popp) {
+		(void)echs_evstrm_pop(this->s);
+	}
+	return e;
+}
+
+static void
+free_evwin(echs_evstrm_t s)
+{
+	struct evwin_s *this = (struct evwin_s*)s;
+
+	free_echs_evstrm(this->s);
+	echs_slab_free(&evwin_slab, this);
+	return;
+}
+
+static echs_evstrm_t
+clone_evwin(echs_const_evstrm_t s)
+{
+	const struct evwin_s *this = (const struct evwin_s*)s;
+	echs_evstrm_t clon;
+	echs_evstrm_t res;
+
+	if (UNLIKELY((clon = clone_echs_evstrm(this->s)) == NULL)) {
+		return NULL;
+	} else if (UNLIKELY((res = make_evwin(clon, this->till)) == NULL)) {
+		free_echs_evstrm(clon);
+		return NULL;
+	}
+	return res;
+}
+
+static void
+seria_evwin(int whither, echs_const_evstrm_t s)
+{
+	const struct evwin_s *this = (const struct evwin_s*)s;
+
+	echs_evstrm_seria(whither, this->s);
+	return;
+}
+
+static size_t
+next_batch_evwin(
+	echs_evstrm_t s, echs_event_t *restrict buf, size_t nbuf,
+	echs_instant_t till)
+{
+	struct evwin_s *this = (struct evwin_s*)s;
+
+	if (echs_instant_lt_p(this->till, till)) {
+		till = this->till;
+	}
+	return echs_evstrm_next_batch(this->s, buf, nbuf, till);
+}
+
+static void
+seek_evwin(echs_evstrm_t s, echs_instant_t from)
+{
+	struct evwin_s *this = (struct evwin_s*)s;
+
+	echs_evstrm_seek(this->s, from);
+	return;
+}
+
+static void
+clip_evwin(echs_evstrm_t s, echs_instant_t till)
+{
+	struct evwin_s *this = (struct evwin_s*)s;
+
+	if (echs_instant_lt_p(till, this->till)) {
+		this->till = till;
+		echs_evstrm_clip(this->s, till);
+	}
+	return;
+}
+
+static size_t
+skip_evwin(echs_evstrm_t s, size_t n, echs_instant_t till)
+{
+	struct evwin_s *this = (struct evwin_s*)s;
+
+	if (echs_instant_lt_p(this->till, till)) {
+		till = this->till;
+	}
+	return echs_evstrm_skip(this->s, n, till);
+}
+
+static echs_event_t
+prev_evwin(echs_const_evstrm_t s, echs_instant_t before)
+{
+	const struct evwin_s *this = (const struct evwin_s*)s;
+	echs_event_t res = echs_evstrm_prev(this->s, before);
+
+	/* walk back into the window */
+	while (!echs_event_0_p(res) && echs_event_beyond_p(res, this->till)) {
+		res = echs_evstrm_prev(
+			this->s, echs_instant_detach_scale(res.from));
+	}
+	return res;
+}
+
+static echs_event_t
+last_evwin(echs_const_evstrm_t s)
+{
+	const struct evwin_s *this = (const struct evwin_s*)s;
+	echs_event_t res = echs_evstrm_last(this->s);
+
+	if (!echs_event_0_p(res) && echs_event_beyond_p(res, this->till)) {
+		/* the last one not beyond TILL then */
+		echs_idiff_t d = {
+			echs_instant_all_day_p(this->till) ? 86400000 : 1,
+		};
+		res = prev_evwin(s, echs_instant_add(this->till, d));
+	}
+	return res;
+}
+
+echs_evstrm_t
+echs_evstrm_window(echs_evstrm_t s, echs_instant_t from, echs_instant_t till)
+{
+	echs_evstrm_t res;
+
+	if (UNLIKELY(s == NULL)) {
+		return NULL;
+	}
+	if (!echs_nul_instant_p(from) && !echs_min_instant_p(from)) {
+		echs_evstrm_seek(s, from);
+	}
+	if (echs_nul_instant_p(till) || echs_max_instant_p(till)) {
+		/* nothing to cut off */
+		return s;
+	}
+	echs_evstrm_clip(s, till);
+	if (UNLIKELY((res = make_evwin(s, till)) == NULL)) {
+		free_echs_evstrm(s);
+	}
+	return res;
+}
+
 
 /* file prober and ctor */
 #include "evical.h"
+#include "task.h"
+#include "bdcal.h"
 
 echs_evstrm_t
 make_echs_evstrm_from_file(const char *fn)
 {
 /* just try the usual readers for now,
  * DSO support and config files will come later */
-	(void)fn;
-	return NULL;
+	char buf[65536U];
+	ical_parser_t pp = NULL;
+	echs_evstrm_t *s = NULL;
+	size_t ns = 0U, zs = 0U;
+	echs_evstrm_t res;
+	const char *ref;
+	ssize_t nrd;
+	int fd;
+
+	if (UNLIKELY((fd = open(fn, O_RDONLY)) < 0)) {
+		return NULL;
+	}
+	/* calendars are referenced relative to FN */
+	ref = echs_bdcal_ref(fn);
+more:
+	switch ((nrd = read(fd, buf, sizeof(buf)))) {
+		echs_instruc_t ins;
+
+	default:
+		if (echs_evical_push(&pp, buf, nrd) < 0) {
+			/* pushing more brings nothing */
+			break;
+		}
+		/*@fallthrough@*/
+	case 0:
+		do {
+			struct echs_task_s *t;
+
+			ins = echs_evical_pull(&pp);
+
+			if (UNLIKELY(ins.v != INSVERB_SCHE)) {
+				break;
+			} else if (UNLIKELY((t = deconst(ins.t)) == NULL)) {
+				continue;
+			} else if (LIKELY(t->strm != NULL)) {
+				if (UNLIKELY(ns >= zs)) {
+					const size_t nz = (zs ?: 8U) * 2U;
+					echs_evstrm_t *nu = realloc(s, nz * sizeof(*s));
+
+					if (UNLIKELY(nu == NULL)) {
+						/* drop the stream, keep the rest */
+						free_echs_task(t);
+						continue;
+					}
+					s = nu;
+					zs = nz;
+				}
+				/* steal the task's stream */
+				s[ns++] = t->strm;
+				t->strm = NULL;
+			}
+			free_echs_task(t);
+		} while (1);
+		if (LIKELY(nrd > 0)) {
+			goto more;
+		}
+		/*@fallthrough@*/
+	case -1:
+		/* last ever pull this morning */
+		ins = echs_evical_last_pull(&pp);
+
+		if (UNLIKELY(ins.v != INSVERB_SCHE)) {
+			break;
+		} else if (UNLIKELY(ins.t != NULL)) {
+			/* half-finished thing */
+			free_echs_task(ins.t);
+		}
+		break;
+	}
+	close(fd);
+	(void)echs_bdcal_ref(ref);
+
+	/* the muxer takes a copy of S */
+	res = echs_evstrm_vmux(s, ns);
+	if (s != NULL) {
+		free(s);
+	}
+	return res;
 }
 
 /* evstrm.c ends here */
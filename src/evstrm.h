@@ -55,6 +55,30 @@ struct echs_evstrm_class_s {
 	void(*free)(echs_evstrm_t);
 	/** serialiser method */
 	void(*seria)(int whither, echs_const_evstrm_t);
+	/** batch method, optional
+	 * pop at most NBUF events not beyond TILL into BUF */
+	size_t(*next_batch)(
+		echs_evstrm_t, echs_event_t *restrict buf, size_t nbuf,
+		echs_instant_t till);
+	/** seek method, optional
+	 * discard all events that start before the instant given */
+	void(*seek)(echs_evstrm_t, echs_instant_t);
+	/** clip method, optional
+	 * no events starting after the instant given will be asked for,
+	 * generators may stop early */
+	void(*clip)(echs_evstrm_t, echs_instant_t);
+	/** skip method, optional
+	 * discard at most N events not beyond TILL, return their number */
+	size_t(*skip)(echs_evstrm_t, size_t n, echs_instant_t till);
+	/** prev method, optional
+	 * return the last event starting before the instant given,
+	 * already popped events included, the stream is left untouched */
+	echs_event_t(*prev)(echs_const_evstrm_t, echs_instant_t);
+	/** last method, optional
+	 * return the last event of the stream, already popped events
+	 * included, the nul event if there are none, an event starting
+	 * at echs_max_instant() if the stream has no end */
+	echs_event_t(*last)(echs_const_evstrm_t);
 };
 
 struct echs_evstrm_s {
@@ -102,7 +126,78 @@ extern size_t
 echs_evstrm_demux(echs_evstrm_t *restrict tgt, size_t tsz,
 		  const struct echs_evstrm_s *s, size_t offset);
 
-
+/**
+ * Tee, turn S into a shared stream and return a cursor on it.
+ * Cursors are cheap to clone (`clone_echs_evstrm()') and read the
+ * events generated by S at their own pace, S itself is advanced only
+ * once for all of them.  Events are buffered until the slowest cursor
+ * has consumed them, cursors falling too far behind are handed a copy
+ * of the generator instead.  S is repurposed and freed with the last
+ * cursor. */
+extern echs_evstrm_t echs_evstrm_tee(echs_evstrm_t s);
+
+/**
+ * Share the stream in *S with another reader.
+ * *S is replaced by a tee cursor (see `echs_evstrm_tee()') unless it
+ * is one already and a second cursor is returned, so both read the
+ * events of one generator.  Falls back to cloning *S.
+ * Sharing is never done behind the caller's back, the clone methods
+ * of all stream classes make deep copies. */
+extern echs_evstrm_t echs_evstrm_share(echs_evstrm_t *s);
+
+/**
+ * Window, produce an evstrm that yields the events of S that start
+ * in [FROM, TILL] (scale information disregarded).
+ * FROM is pushed down into S by seeking, TILL by clipping so that
+ * generators don't produce occurrences beyond the window.
+ * S is repurposed in the window stream. */
+extern echs_evstrm_t
+echs_evstrm_window(echs_evstrm_t s, echs_instant_t from, echs_instant_t till);
+
+/**
+ * Return the number of events of S that start in [FROM, TILL]
+ * (scale information disregarded).
+ * S is advanced past TILL and should be freed afterwards. */
+extern size_t
+echs_evstrm_count(echs_evstrm_t s, echs_instant_t from, echs_instant_t till);
+
+/**
+ * Pop the N-th event off S, counting from 1, or the nul event if S
+ * runs out of events before that.  Preceding events are skipped. */
+extern echs_event_t echs_evstrm_nth(echs_evstrm_t s, size_t n);
+
+/**
+ * Generic batch puller, pop events off S into BUF (of size NBUF)
+ * one by one as long as they do not start after TILL.
+ * Return the number of events put into BUF.
+ * This is used for stream classes without a `next_batch' method. */
+extern size_t
+echs_evstrm_next_batch_gen(echs_evstrm_t s,
+			   echs_event_t *restrict buf, size_t nbuf,
+			   echs_instant_t till);
+
+/**
+ * Generic seeker, pop events off S one by one as long as they start
+ * before FROM.
+ * This is used for stream classes without a `seek' method. */
+extern void echs_evstrm_seek_gen(echs_evstrm_t s, echs_instant_t from);
+
+/**
+ * Generic look-behind, scan a clone of S from its current position
+ * and return the last event that starts before BEFORE.
+ * This is used for stream classes without a `prev' method. */
+extern echs_event_t
+echs_evstrm_prev_gen(echs_const_evstrm_t s, echs_instant_t before);
+
+/**
+ * Generic skipper, pop events off S in batches as long as they do not
+ * start after TILL, but at most N of them.  Return the number of
+ * events popped.
+ * This is used for stream classes without a `skip' method. */
+extern size_t
+echs_evstrm_skip_gen(echs_evstrm_t s, size_t n, echs_instant_t till);
+
+
 static inline echs_event_t
 echs_evstrm_pop(echs_evstrm_t s)
 {
@@ -128,6 +223,92 @@ clone_echs_evstrm(echs_evstrm_t s)
 	return s->class->clone(s);
 }
 
+/**
+ * Pop at most NBUF events off S into BUF, stop at the first event that
+ * starts after TILL (scale information disregarded), that event is not
+ * popped.  Return the number of events put into BUF, 0 means the stream
+ * is exhausted or its next event is beyond TILL. */
+static inline size_t
+echs_evstrm_next_batch(
+	echs_evstrm_t s, echs_event_t *restrict buf, size_t nbuf,
+	echs_instant_t till)
+{
+	if (s->class->next_batch != NULL) {
+		return s->class->next_batch(s, buf, nbuf, till);
+	}
+	return echs_evstrm_next_batch_gen(s, buf, nbuf, till);
+}
+
+/**
+ * Discard all events of S that start before FROM (scale information
+ * disregarded) so that the next event is the first one not before FROM. */
+static inline void
+echs_evstrm_seek(echs_evstrm_t s, echs_instant_t from)
+{
+	if (s->class->seek != NULL) {
+		s->class->seek(s, from);
+		return;
+	}
+	echs_evstrm_seek_gen(s, from);
+	return;
+}
+
+/**
+ * Promise that no events of S starting after TILL (scale information
+ * disregarded) will be asked for.  Streams may stop generating
+ * events beyond TILL but they won't stop at TILL necessarily,
+ * see `echs_evstrm_window()' for that. */
+static inline void
+echs_evstrm_clip(echs_evstrm_t s, echs_instant_t till)
+{
+	if (s->class->clip != NULL) {
+		s->class->clip(s, till);
+	}
+	return;
+}
+
+/**
+ * Discard at most N events of S that don't start after TILL (scale
+ * information disregarded), return the number of discarded events. */
+static inline size_t
+echs_evstrm_skip(echs_evstrm_t s, size_t n, echs_instant_t till)
+{
+	if (s->class->skip != NULL) {
+		return s->class->skip(s, n, till);
+	}
+	return echs_evstrm_skip_gen(s, n, till);
+}
+
+/**
+ * Return the last event of S that starts before BEFORE (scale
+ * information disregarded) or the nul event if there is none.
+ * Streams with a `prev' method look at all their events, also the
+ * ones popped already, others are scanned from their current position.
+ * S itself is not advanced. */
+static inline echs_event_t
+echs_evstrm_prev(echs_const_evstrm_t s, echs_instant_t before)
+{
+	if (s->class->prev != NULL) {
+		return s->class->prev(s, before);
+	}
+	return echs_evstrm_prev_gen(s, before);
+}
+
+/**
+ * Return the last event S will ever yield, also counting the ones
+ * popped already, the nul event if there are none, or an event that
+ * starts at echs_max_instant() if S is unbounded or doesn't know.
+ * Streams without a `last' method are taken to be unbounded.
+ * S itself is not advanced. */
+static inline echs_event_t
+echs_evstrm_last(echs_const_evstrm_t s)
+{
+	if (s->class->last != NULL) {
+		return s->class->last(s);
+	}
+	return (echs_event_t){.from = echs_max_instant()};
+}
+
 static inline void
 echs_evstrm_seria(int whither, echs_evstrm_t s)
 {
@@ -64,7 +64,7 @@ __get_mdays(unsigned int y, unsigned int m)
 	};
 	unsigned int res = mdays[m];
 
-	if (UNLIKELY(!(y % 4U) && m == 2U)) {
+	if (UNLIKELY(m == 2U && !(y % 4U) && (y % 100U || !(y % 400U)))) {
 		res++;
 	}
 	return res;
@@ -75,7 +75,8 @@ __doy(echs_instant_t i)
 {
 	unsigned int res = doy[i.m] + i.d;
 
-	if (UNLIKELY((i.y % 4U) == 0) && i.m >= 3) {
+	if (UNLIKELY((i.y % 4U) == 0) && i.m >= 3 &&
+	    (i.y % 100U || !(i.y % 400U))) {
 		res++;
 	}
 	return res;
@@ -304,6 +305,113 @@ fixup_S:
 	return res;
 }
 
+
+/* civil <-> epoch, after H. Hinnant's days_from_civil() and
+ * civil_from_days(), with years starting in March so the leap day comes
+ * last, good for the full proleptic gregorian range of instants */
+#define DAYS_PER_ERA	(146097)
+#define UNIX_EPOCH_DAYS	(719468)
+
+static inline __attribute__((const, pure)) int64_t
+__days_from_civil(unsigned int y, unsigned int m, unsigned int d)
+{
+	/* one era ahead so that January and February of year 0 are fine */
+	const unsigned int yy = y + 400U - (m <= 2U);
+	const unsigned int era = yy / 400U;
+	const unsigned int yoe = yy % 400U;
+	const unsigned int mp = m > 2U ? m - 3U : m + 9U;
+	const unsigned int yd = (153U * mp + 2U) / 5U + d - 1U;
+	const unsigned int doe = yoe * 365U + yoe / 4U - yoe / 100U + yd;
+
+	return (int64_t)era * DAYS_PER_ERA + doe -
+		(UNIX_EPOCH_DAYS + DAYS_PER_ERA);
+}
+
+static inline __attribute__((const, pure)) echs_instant_t
+__civil_from_days(int64_t z)
+{
+	echs_instant_t res = {.u = 0U};
+	int64_t era;
+	unsigned int doe, yoe, yd, mp;
+
+	z += UNIX_EPOCH_DAYS;
+	era = (z >= 0 ? z : z - (DAYS_PER_ERA - 1)) / DAYS_PER_ERA;
+	doe = (unsigned int)(z - era * DAYS_PER_ERA);
+	yoe = (doe - doe / 1460U + doe / 36524U - doe / 146096U) / 365U;
+	yd = doe - (365U * yoe + yoe / 4U - yoe / 100U);
+	mp = (5U * yd + 2U) / 153U;
+
+	res.d = yd - (153U * mp + 2U) / 5U + 1U;
+	res.m = mp < 10U ? mp + 3U : mp - 9U;
+	res.y = (unsigned int)(era * 400 + yoe) + (mp >= 10U);
+	return res;
+}
+
+static inline __attribute__((const, pure)) time_t
+__inst_to_epoch(echs_instant_t i)
+{
+	time_t t = (time_t)__days_from_civil(i.y, i.m, i.d) * SECS_PER_DAY;
+
+	if (LIKELY(!echs_instant_all_day_p(i))) {
+		t += (i.H * MINS_PER_HOUR + i.M) * SECS_PER_MIN + i.S;
+	}
+	return t;
+}
+
+static inline __attribute__((const, pure)) echs_instant_t
+__epoch_to_inst(time_t t)
+{
+	/* floor division, stamps before 1970 are negative */
+	const time_t d = (t >= 0 ? t : t - (time_t)(SECS_PER_DAY - 1U)) /
+		(time_t)SECS_PER_DAY;
+	unsigned int s = (unsigned int)(t - d * (time_t)SECS_PER_DAY);
+	echs_instant_t res = __civil_from_days(d);
+
+	res.S = s % SECS_PER_MIN, s /= SECS_PER_MIN;
+	res.M = s % MINS_PER_HOUR, s /= MINS_PER_HOUR;
+	res.H = s;
+	/* epoch stamps have second resolution */
+	res.ms = ECHS_ALL_SEC;
+	return res;
+}
+
+int64_t
+echs_ymd_to_days(unsigned int y, unsigned int m, unsigned int d)
+{
+	return __days_from_civil(y, m, d);
+}
+
+time_t
+echs_instant_to_epoch(echs_instant_t i)
+{
+	return __inst_to_epoch(i);
+}
+
+echs_instant_t
+epoch_to_echs_instant(time_t t)
+{
+	return __epoch_to_inst(t);
+}
+
+void
+echs_instant_to_epoch_v(time_t *restrict tgt, const echs_instant_t *src, size_t n)
+{
+	/* no branches beyond the loop, leave the rest to the vectoriser */
+	for (size_t k = 0U; k < n; k++) {
+		tgt[k] = __inst_to_epoch(src[k]);
+	}
+	return;
+}
+
+void
+epoch_to_echs_instant_v(echs_instant_t *restrict tgt, const time_t *src, size_t n)
+{
+	for (size_t k = 0U; k < n; k++) {
+		tgt[k] = __epoch_to_inst(src[k]);
+	}
+	return;
+}
+
 void
 echs_instant_sort(echs_instant_t *restrict in, size_t nin)
 {
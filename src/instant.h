@@ -39,6 +39,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <time.h>
 #include "boobs.h"
 
 typedef struct echs_idiff_s echs_idiff_t;
@@ -103,13 +104,28 @@ extern echs_instant_t echs_instant_add(echs_instant_t bas, echs_idiff_t add);
 extern void echs_instant_sort(echs_instant_t *restrict in, size_t nin);
 
 /**
- * Convert echs_instant_t to epoch time. */
+ * Return the number of days from 1970-01-01 to the gregorian Y-M-D. */
+extern int64_t echs_ymd_to_days(unsigned int y, unsigned int m, unsigned int d);
+
+/**
+ * Convert echs_instant_t to epoch time, all-day instants map to the
+ * beginning of their day. */
 extern time_t echs_instant_to_epoch(echs_instant_t);
 
 /**
  * Convert epoch time to echs_instant_t. */
 extern echs_instant_t epoch_to_echs_instant(time_t);
 
+/**
+ * Convert the N instants SRC to epoch times in TGT. */
+extern void
+echs_instant_to_epoch_v(time_t *restrict tgt, const echs_instant_t *src, size_t n);
+
+/**
+ * Convert the N epoch times SRC to instants in TGT. */
+extern void
+epoch_to_echs_instant_v(echs_instant_t *restrict tgt, const time_t *src, size_t n);
+
 
 #define ECHS_ALL_DAY	(0xffU)
 #define ECHS_ALL_SEC	(0x3ffU)
@@ -214,7 +214,7 @@ __ndim_greg(unsigned int y, unsigned int m)
 	};
 	unsigned int res = mdays[m];
 
-	if (UNLIKELY(!(y % 4U) && m == 2U)) {
+	if (UNLIKELY(m == 2U && !(y % 4U) && (y % 100U || !(y % 400U)))) {
 		res++;
 	}
 	return res;
@@ -0,0 +1,255 @@
+/*** slab.c -- slab allocator for stream objects
+ *
+ * Copyright (C) 2013-2020 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of echse.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "slab.h"
+#include "nifty.h"
+
+/* every chunk starts with this */
+struct chunk_s {
+	/* links in the list of chunks with free objects */
+	struct chunk_s *next;
+	struct chunk_s *prev;
+	/* free objects in this chunk */
+	void *fl;
+	/* size class */
+	size_t cls;
+	/* number of objects handed out */
+	size_t nlive;
+};
+
+/* every object is preceded by this, keeps objects 16-byte aligned */
+struct hdr_s {
+	/* chunk or NULL for malloc()'d objects */
+	struct chunk_s *ch;
+	/* requested size */
+	size_t z;
+};
+
+/* chunks are at least this big */
+#define CHUNKZ		(65536U)
+/* objects start this far into a chunk */
+#define CHDRZ		((sizeof(struct chunk_s) + 15U) & ~(size_t)15U)
+
+/* all slabs in use */
+static echs_slab_t slabs;
+
+
+static inline size_t
+cls_size(size_t c)
+{
+/* size classes go 32, 48, 64, 96, 128, 192, ... */
+	return (2U | (c & 1U)) << (c / 2U + 4U);
+}
+
+static inline size_t
+size_cls(size_t z)
+{
+	size_t c;
+
+	for (c = 0U; c < ECHS_SLAB_NCLS && cls_size(c) < z; c++);
+	return c;
+}
+
+static inline size_t
+chunk_size(size_t c)
+{
+/* room for at least 16 objects */
+	const size_t nz = CHDRZ + 16U * cls_size(c);
+	return CHUNKZ > nz ? CHUNKZ : nz;
+}
+
+static inline void
+link_chunk(echs_slab_t s, struct chunk_s *ch)
+{
+	if ((ch->next = s->fl[ch->cls]) != NULL) {
+		ch->next->prev = ch;
+	}
+	ch->prev = NULL;
+	s->fl[ch->cls] = ch;
+	return;
+}
+
+static inline void
+unlink_chunk(echs_slab_t s, struct chunk_s *ch)
+{
+	if (ch->next != NULL) {
+		ch->next->prev = ch->prev;
+	}
+	if (ch->prev != NULL) {
+		ch->prev->next = ch->next;
+	} else {
+		s->fl[ch->cls] = ch->next;
+	}
+	return;
+}
+
+static int
+carve(echs_slab_t s, size_t c)
+{
+/* get a new chunk and thread its objects onto its free list */
+	const size_t cz = cls_size(c);
+	const size_t nz = chunk_size(c);
+	struct chunk_s *ch;
+
+	if (UNLIKELY((ch = malloc(nz)) == NULL)) {
+		return -1;
+	}
+	ch->fl = NULL;
+	ch->cls = c;
+	ch->nlive = 0U;
+	for (char *p = (char*)ch + CHDRZ + (nz - CHDRZ) / cz * cz - cz,
+		     *const p0 = (char*)ch + CHDRZ; p >= p0; p -= cz) {
+		*(void**)p = ch->fl;
+		ch->fl = p;
+	}
+	link_chunk(s, ch);
+	s->nchunk++;
+	s->zchunk += nz;
+	/* register S for the statistics if need be */
+	for (echs_slab_t x = slabs; x != s; x = x->next) {
+		if (x == NULL) {
+			s->next = slabs;
+			slabs = s;
+			break;
+		}
+	}
+	return 0;
+}
+
+
+void*
+echs_slab_alloc(echs_slab_t s, size_t z)
+{
+	const size_t c = size_cls(z + sizeof(struct hdr_s));
+	struct chunk_s *ch;
+	struct hdr_s *h;
+
+	if (UNLIKELY(c >= ECHS_SLAB_NCLS)) {
+		/* too big for us */
+		if (UNLIKELY((h = malloc(z + sizeof(*h))) == NULL)) {
+			return NULL;
+		}
+		ch = NULL;
+	} else if (UNLIKELY(s->fl[c] == NULL && carve(s, c) < 0)) {
+		return NULL;
+	} else {
+		ch = s->fl[c];
+		h = ch->fl;
+		ch->nlive++;
+		if ((ch->fl = *(void**)h) == NULL) {
+			/* full now, no need to look at it */
+			unlink_chunk(s, ch);
+		}
+	}
+	h->ch = ch;
+	h->z = z;
+	s->nlive++;
+	s->zlive += z;
+	return h + 1U;
+}
+
+void*
+echs_slab_calloc(echs_slab_t s, size_t z)
+{
+	void *res;
+
+	if (LIKELY((res = echs_slab_alloc(s, z)) != NULL)) {
+		memset(res, 0, z);
+	}
+	return res;
+}
+
+void
+echs_slab_free(echs_slab_t s, void *p)
+{
+	struct chunk_s *ch;
+	struct hdr_s *h;
+
+	if (UNLIKELY(p == NULL)) {
+		return;
+	}
+	h = (struct hdr_s*)p - 1U;
+	s->nlive--;
+	s->zlive -= h->z;
+	if (UNLIKELY((ch = h->ch) == NULL)) {
+		free(h);
+		return;
+	} else if (ch->fl == NULL) {
+		/* was full, make it available again */
+		link_chunk(s, ch);
+	}
+	/* the free list link overwrites the header */
+	*(void**)h = ch->fl;
+	ch->fl = h;
+	if (UNLIKELY(!--ch->nlive) &&
+	    (ch->prev != NULL || ch->next != NULL)) {
+		/* empty and another chunk has room, give it back */
+		unlink_chunk(s, ch);
+		s->nchunk--;
+		s->zchunk -= chunk_size(ch->cls);
+		free(ch);
+	}
+	return;
+}
+
+void
+echs_slab_clear(echs_slab_t s)
+{
+	for (size_t c = 0U; c < ECHS_SLAB_NCLS; c++) {
+		for (struct chunk_s *ch = s->fl[c], *nx; ch != NULL; ch = nx) {
+			nx = ch->next;
+			free(ch);
+		}
+	}
+	memset(s->fl, 0, sizeof(s->fl));
+	s->nchunk = 0U;
+	s->zchunk = 0U;
+	return;
+}
+
+echs_slab_t
+echs_slabs(void)
+{
+	return slabs;
+}
+
+/* slab.c ends here */
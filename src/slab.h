@@ -0,0 +1,94 @@
+/*** slab.h -- slab allocator for stream objects
+ *
+ * Copyright (C) 2013-2020 Sebastian Freundt
+ *
+ * Author:  Sebastian Freundt <freundt@ga-group.nl>
+ *
+ * This file is part of echse.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the author nor the names of any contributors
+ *    may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ***/
+#if !defined INCLUDED_slab_h_
+#define INCLUDED_slab_h_
+
+#include <stddef.h>
+
+/**
+ * Slabs hand out objects of one stream class from big chunks that are
+ * carved into size classes, freed objects go back onto their chunk's
+ * free list.  A chunk that runs empty is given back to the system
+ * unless it is the only one of its size class with room left.
+ * Objects beyond the largest size class are malloc()'d.
+ * Slabs are not thread-safe. */
+#define ECHS_SLAB_NCLS	(18U)
+
+typedef struct echs_slab_s *echs_slab_t;
+
+struct echs_slab_s {
+	/** name for the statistics */
+	const char *name;
+	/** number of live objects */
+	size_t nlive;
+	/** number of bytes requested by the live objects */
+	size_t zlive;
+	/** number of chunks held */
+	size_t nchunk;
+	/** number of bytes held in chunks */
+	size_t zchunk;
+	/** chunks with free objects, one list per size class */
+	void *fl[ECHS_SLAB_NCLS];
+	/** link to the next slab in use */
+	echs_slab_t next;
+};
+
+#define ECHS_SLAB_INIT(x)	{.name = (x)}
+
+
+/**
+ * Return a pointer to an object of Z bytes from slab S or NULL. */
+extern void *echs_slab_alloc(echs_slab_t s, size_t z);
+
+/**
+ * Like `echs_slab_alloc()' but zero out the object. */
+extern void *echs_slab_calloc(echs_slab_t s, size_t z);
+
+/**
+ * Give object P back to slab S. */
+extern void echs_slab_free(echs_slab_t s, void *p);
+
+/**
+ * Return the remaining chunks of slab S to the system.
+ * All objects of S must have been freed. */
+extern void echs_slab_clear(echs_slab_t s);
+
+/**
+ * Return the first slab in use, go to the next one with ->next. */
+extern echs_slab_t echs_slabs(void);
+
+#endif	/* INCLUDED_slab_h_ */
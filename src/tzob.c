@@ -66,16 +66,27 @@ static size_t obz;
 /* next ob */
 static size_t obn;
 
+/* maximum number of zones, tzobs have 6 bits in instants */
+#if !defined ECHS_MAX_ZONES
+# define ECHS_MAX_ZONES	(63U)
+#elif ECHS_MAX_ZONES > 63U
+# error "ECHS_MAX_ZONES must not exceed 63"
+#endif	/* !ECHS_MAX_ZONES */
+
 /* the hx obarray, specs and size just like the string obarray */
-static hash_t hxa[64U];
+static hash_t hxa[ECHS_MAX_ZONES];
 static size_t hxn;
 
-/* MFU cache of zifs */
-static struct {
-	echs_tzob_t z;
-	size_t cnt;
-} tmfu[16U];
-static zif_t zmfu[16U];
+/* registry of zifs, indexed like the hx obarray, zones once opened
+ * stay open so their converted transitions are built once per process
+ * and inherited by forked workers (echse -j); the TZif files are
+ * mapped MAP_SHARED, so their pages are shared through the page cache,
+ * but the converted tables hold pointers and stay private, which costs
+ * little as echsd schedules everything in one process and each exec'd
+ * echsx only opens the zones of its one task */
+static zif_t zifs[ECHS_MAX_ZONES];
+/* zones that failed to open, so we don't retry */
+static uint64_t zbad;
 
 static void*
 recalloc(void *buf, size_t nmemb_ol, size_t nmemb_nu, size_t membz)
@@ -128,7 +139,7 @@ make_tzob(size_t x)
 static inline size_t
 make_size(echs_tzob_t z)
 {
-	return ((z >> 8U) & 0b111100U) ^ ((z >> 6U) & 0b11U);
+	return ((z >> 10U) & 0b111100U) ^ ((z >> 6U) & 0b11U);
 }
 
 static echs_tzob_t
@@ -138,7 +149,7 @@ bang_tzob(hash_t hx)
  * readily shifted to the needs of ECHS_DMASK and ECHS_IMASK */
 	if (UNLIKELY(hxn >= countof(hxa))) {
 		/* nope, let's do fuckall instead
-		 * more than 64 timezones?  we're not THAT international */
+		 * more than 63 timezones?  we're not THAT international */
 		return 0U;
 	}
 	/* just push the hx in question and advance the counter */
@@ -166,144 +177,25 @@ static zif_t
 __tzob_zif(echs_tzob_t zob)
 {
 /* return a zif_t object from ZOB. */
-#define SWP(x, y)					\
-	do {						\
-		__typeof(x) paste(__tmp, __LINE__) = x;	\
-		x = y;					\
-		y = paste(__tmp, __LINE__);		\
-	} while (0)
+	const char *fn;
 	size_t i;
 
-	for (i = 0U; i < countof(tmfu) - 1U; i++) {
-		if (UNLIKELY(!tmfu[i].z)) {
-			/* found an empty guy */
-			break;
-		} else if (LIKELY(tmfu[i].z == zob)) {
-			/* found him */
-			if (i && tmfu[i - 1U].cnt < ++tmfu[i].cnt) {
-				/* swap with predecessor because
-				 * obviously item I is used more often now
-				 * this will slowly let the most used items
-				 * bubble up */
-				SWP(tmfu[i - 1U], tmfu[i]);
-				SWP(zmfu[i - 1U], zmfu[i]);
-				i--;
-			}
-			return zmfu[i];
-		}
-	}
-	/* `i' should be <=countof(tmfu) - 1U, so do the usual checks */
-	const char *fn;
-	zif_t this;
-
-	if (tmfu[i].z == zob) {
-		/* how lucky can we get? */
-		this = zmfu[i];
-	} else if (UNLIKELY((fn = echs_zone(zob)) == NULL)) {
-		/* yea, bollocks */
-		this = NULL;
-	} else if (UNLIKELY((this = zif_open(fn)) == NULL)) {
+	if (UNLIKELY(!(i = make_size(zob)) || i > hxn)) {
+		/* UTC or unknown */
+		return NULL;
+	} else if (LIKELY(zifs[--i] != NULL)) {
+		/* found him */
+		return zifs[i];
+	} else if (UNLIKELY(zbad >> i & 0b1U)) {
+		/* tried that before */
+		return NULL;
+	} else if (UNLIKELY((fn = echs_zone(zob)) == NULL ||
+			    (zifs[i] = zif_open(fn)) == NULL)) {
 		/* just resort to doing fuckall */
-		this = NULL;
-	} else {
-		if (zmfu[i] != NULL) {
-			/* clear the zif out */
-			zif_close(zmfu[i]);
-		}
-		zmfu[i] = this;
-		tmfu[i].z = zob;
-		tmfu[i].cnt = 1U;
-	}
-	return this;
-}
-
-
-#define DAISY_UNIX_BASE	(7977U)
-#define DAISY_BASE_YEAR	(1948U)
-
-static time_t
-__inst_to_epoch(echs_instant_t i)
-{
-	static const uint16_t __mon_yday[] = {
-		/* this is \sum ml, for mar->feb years */
-		0U,
-		306U, 337U, 0U, 31U, 61U, 92U,
-		122U, 153U, 184U, 214U, 245U, 275U
-	};
-	unsigned int by = i.y - DAISY_BASE_YEAR;
-	/* no bullshit years in our lifetime */
-	unsigned int j0 = by * 365U + by / 4U;
-	/* yday by lookup */
-	unsigned int yd = (LIKELY(i.m <= 12U))
-		? __mon_yday[i.m] + i.d
-		: 0U;
-
-	return ((((j0 + yd - DAISY_UNIX_BASE) * 24U +
-		  (LIKELY(i.H <= 24U) ? i.H : 24U)) * 60U + i.M) * 60U) + i.S;
-}
-
-static echs_instant_t
-__epoch_to_inst(time_t t)
-{
-	unsigned int d = t / 86400U + DAISY_UNIX_BASE;
-	unsigned int s = t % 86400U;
-	echs_instant_t ti;
-
-	/* now here's the deal:
-	 * d is actually y * 365U + y / 4U + doy
-	 * or more abstractly (ya + y/b + c), multiply by b yields
-	 * (ya + y/b + c) b = yab + y + cb = y(ab + 1) + cb
-	 * and since ab+1 > cb always we can simply divide to get y */
-	with (unsigned int by = d / 365U) {
-		unsigned int f0 = by * 365U + by / 4U;
-		unsigned int doy;
-
-		if (UNLIKELY(f0 >= d)) {
-			f0 = (by--, by * 365U + by / 4U);
-		}
-		/* get the doy in the year going from Mar to Feb */
-		doy = d - f0;
-
-		/* freundt method for doy -> m+d conversion
-		 * stolen from dateutils but adapted for Mar->Feb years */
-		{
-#define GET_REM(x)	(rem[x])
-			static const uint8_t rem[] = {
-				19, 19, 18, 16, 15, 13, 12, 11, 9, 8, 6, 5, 4, 1
-			};
-			static const uint8_t rm[] = {
-				0, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 1, 2, 0
-			};
-			unsigned int mon;
-			unsigned int dom;
-			unsigned int beef;
-			unsigned int cake;
-
-			/* get 32-adic doys */
-			mon = (doy + 19U) / 32U;
-			dom = (doy + 19U) % 32U;
-			beef = GET_REM(mon);
-			cake = GET_REM(mon + 1U);
-
-			if (dom <= cake) {
-				dom = doy - ((mon - 1U) * 32U - 19U + beef);
-			} else {
-				dom = doy - (mon++ * 32U - 19U + cake);
-			}
-
-			ti.y = by + DAISY_BASE_YEAR + (mon > 10U);
-			ti.m = rm[mon];
-			ti.d = dom;
-#undef GET_REM
-		}
+		zbad |= 1ULL << i;
+		return NULL;
 	}
-	/* assign times */
-	ti.S = s % 60U, s /= 60U;
-	ti.M = s % 60U, s /= 60U;
-	ti.H = s;
-	/* unix epoch has second resolution */
-	ti.ms = ECHS_ALL_DAY;
-	return ti;
+	return zifs[i];
 }
 
 
@@ -449,15 +341,15 @@ clear_tzobs(void)
 	obz = 0U;
 	obn = 0U;
 
-	/* clear MFU cache */
-	for (size_t i = 0U; i < countof(zmfu); i++) {
-		if (UNLIKELY(zmfu[i] == NULL)) {
-			break;
+	/* clear the registry */
+	for (size_t i = 0U; i < hxn; i++) {
+		if (zifs[i] != NULL) {
+			zif_close(zifs[i]);
 		}
-		zif_close(zmfu[i]);
 	}
-	memset(tmfu, 0, sizeof(tmfu));
-	memset(zmfu, 0, sizeof(zmfu));
+	memset(zifs, 0, sizeof(zifs));
+	zbad = 0U;
+	hxn = 0U;
 	return;
 }
 
@@ -471,7 +363,7 @@ echs_instant_utc(echs_instant_t i, echs_tzob_t zob)
 		/* just do fuckall */
 		;
 	} else if (LIKELY((z = __tzob_zif(zob)) != NULL)) {
-		time_t loc = __inst_to_epoch(i);
+		time_t loc = echs_instant_to_epoch(i);
 		time_t nix = zif_utc_time(z, loc);
 		echs_idiff_t d = {.d = 1000 * (nix - loc)};
 
@@ -490,7 +382,7 @@ echs_instant_loc(echs_instant_t i, echs_tzob_t zob)
 		/* just do fuckall */
 		;
 	} else if (LIKELY((z = __tzob_zif(zob)) != NULL)) {
-		time_t nix = __inst_to_epoch(i);
+		time_t nix = echs_instant_to_epoch(i);
 		time_t loc = zif_local_time(z, nix);
 		echs_idiff_t d = {.d = 1000 * (loc - nix)};
 
@@ -513,21 +405,96 @@ echs_tzob_offs(echs_tzob_t z, echs_instant_t i, int x)
 		return 0;
 	}
 	/* just convert the instant now */
-	nix = __inst_to_epoch(i);
+	nix = echs_instant_to_epoch(i);
 	return zif_find_zrng(_z, nix + x).offs;
 }
 
-/* these are borrowed from instant.h, seeing as we've got the routines here */
-time_t
-echs_instant_to_epoch(echs_instant_t i)
+static inline int
+__zrng_offs(struct zrng_s *restrict r, zif_t z, time_t t)
 {
-	return __inst_to_epoch(i);
+/* offset of T in Z, only looked up when T leaves the range R */
+	if (UNLIKELY(t < r->prev || t >= r->next)) {
+		*r = zif_find_zrng(z, t);
+	}
+	return r->offs;
 }
 
-echs_instant_t
-epoch_to_echs_instant(time_t t)
+size_t
+echs_tzob_shift_v(echs_instant_t *restrict i, size_t n, echs_tzob_t z, int ref)
 {
-	return __epoch_to_inst(t);
+	/* empty range, forces a lookup for the first instant */
+	struct zrng_s r = {.prev = 0, .next = 0};
+	const zif_t _z = __tzob_zif(z);
+	size_t res = 0U;
+
+	if (_z == NULL && !ref) {
+		/* offsets are 0 throughout */
+		return 0U;
+	}
+	for (size_t k = 0U; k < n; k++) {
+		const echs_instant_t x = echs_instant_detach_tzob(i[k]);
+		int offs = 0;
+
+		if (UNLIKELY(echs_instant_all_day_p(x))) {
+			/* all-day shit isn't offset at all */
+			;
+		} else if (LIKELY(_z != NULL)) {
+			/* instants are sorted so the range
+			 * changes once per transition */
+			offs = __zrng_offs(&r, _z, echs_instant_to_epoch(x));
+		}
+		if (UNLIKELY(offs != ref)) {
+			const echs_idiff_t df = {.d = (ref - offs) * 1000};
+
+			i[k] = echs_instant_add(i[k], df);
+			res++;
+		}
+	}
+	return res;
+}
+
+size_t
+echs_instant_utc_v(echs_instant_t *restrict i, size_t n, echs_tzob_t zob)
+{
+	/* one range per lookup of the fixpoint iteration */
+	struct zrng_s r1 = {.prev = 0, .next = 0};
+	struct zrng_s r2 = {.prev = 0, .next = 0};
+	const zif_t z = __tzob_zif(zob);
+	time_t loc[64U];
+	size_t res = 0U;
+
+	for (size_t k0 = 0U; k0 < n; k0 += countof(loc)) {
+		echs_instant_t *restrict x = i + k0;
+		const size_t m = n - k0 < countof(loc) ? n - k0 : countof(loc);
+
+		/* do the civil arithmetic for the whole chunk */
+		for (size_t k = 0U; k < m; k++) {
+			x[k] = echs_instant_detach_tzob(x[k]);
+		}
+		echs_instant_to_epoch_v(loc, x, m);
+		if (UNLIKELY(z == NULL)) {
+			continue;
+		}
+		for (size_t k = 0U; k < m; k++) {
+			int o;
+
+			if (UNLIKELY(echs_instant_all_day_p(x[k]))) {
+				/* just do fuckall */
+				continue;
+			}
+			/* same two steps as zif_utc_time() */
+			if ((o = __zrng_offs(&r1, z, loc[k]))) {
+				o = __zrng_offs(&r2, z, loc[k] - o);
+			}
+			if (o) {
+				const echs_idiff_t d = {.d = -1000 * o};
+
+				x[k] = echs_instant_add(x[k], d);
+				res++;
+			}
+		}
+	}
+	return res;
 }
 
 /* tzob.c ends here */
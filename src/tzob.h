@@ -67,10 +67,25 @@ extern echs_instant_t echs_instant_utc(echs_instant_t i, echs_tzob_t z);
  * Convert instant I (in UTC) to local time in zone Z. */
 extern echs_instant_t echs_instant_loc(echs_instant_t i, echs_tzob_t z);
 
+/**
+ * Convert the N instants I to UTC time from zone Z, in situ.
+ * The zone is resolved once and, for sorted I, its transitions walked
+ * alongside.  Return the number of instants moved. */
+extern size_t
+echs_instant_utc_v(echs_instant_t *restrict i, size_t n, echs_tzob_t z);
+
 /**
  * Return the curent UTC-offset of Z (in seconds) at instant I (+X seconds). */
 extern int echs_tzob_offs(echs_tzob_t z, echs_instant_t i, int x);
 
+/**
+ * For the N instants I, sorted and in local time of Z, move those whose
+ * UTC-offset in Z differs from REF (in seconds) by the difference.
+ * The zone is resolved once and its transitions walked alongside I.
+ * Return the number of instants moved. */
+extern size_t
+echs_tzob_shift_v(echs_instant_t *restrict i, size_t n, echs_tzob_t z, int ref);
+
 
 /**
  * Extract tz information from instant I. */
@@ -67,6 +67,8 @@
 #include "boobs.h"
 /* for LIKELY/UNLIKELY/etc. */
 #include "nifty.h"
+/* for days from civil dates */
+#include "instant.h"
 /* me own header, innit */
 #include "tzraw.h"
 
@@ -131,6 +133,29 @@ struct zleap_tr_s {
 	int32_t corr;
 };
 
+/* rule part of a POSIX TZ string, Jn, n or Mm.w.d */
+struct zrul_s {
+	/* 'J', 'M' or \0 for 0-based days */
+	char typ;
+	uint8_t m;
+	uint8_t w;
+	uint8_t d;
+	uint16_t n;
+	/* local time of the switch in seconds */
+	int32_t secs;
+};
+
+/* POSIX TZ string of v2+ files, in force past the last transition */
+struct zftr_s {
+	/* utc offsets of standard and daylight saving time */
+	int32_t std;
+	int32_t dst;
+	/* switch to daylight saving time and back */
+	struct zrul_s beg;
+	struct zrul_s end;
+	bool dstp;
+};
+
 /* leap second support missing */
 struct zif_s {
 	size_t mpsz;
@@ -151,8 +176,33 @@ struct zif_s {
 	/* for special zones */
 	coord_zone_t cz;
 
+	/* native index, offset of the index relative to the zif_s */
+	size_t idxo;
+	/* number of listed transitions, v2+ if available */
+	size_t ntim;
+	/* offset before the first transition */
+	int32_t ofs0;
+	/* transition times, sorted, and offsets after each transition */
+	int64_t *tim;
+	int32_t *ofs;
+	/* transition times in eytzinger order and their sorted indices */
+	int64_t *eyt;
+	uint32_t *eyx;
+
 	/* zone caching, between PREV and NEXT the offset is OFFS */
 	struct zrng_s cache;
+	/* full transition number of the cached range */
+	int ctrno;
+
+	/* footer rule and the transitions materialised from it so far,
+	 * numbered on from the listed ones, first year and next year */
+	struct zftr_s ftr;
+	int64_t *ftim;
+	int32_t *fofs;
+	size_t nft;
+	size_t zft;
+	int fy0;
+	int fy;
 };
 
 
@@ -176,6 +226,11 @@ static const char coord_fn[] = "/usr/share/zoneinfo/UTC";
 
 #define AS_MUT_ZIF(x)	((struct zif_s*)deconst(x))
 
+#define ZTIME_MIN	(INT64_MIN)
+#define ZTIME_MAX	(INT64_MAX)
+/* don't materialise footer transitions past this year */
+#define ZFTR_YMAX	(9999)
+
 /* special zone names */
 static const char coord_zones[][4] = {
 	"",
@@ -428,15 +483,538 @@ __conv_zif(struct zif_s tgt[static 1U], const struct zif_s src[static 1U])
 	return;
 }
 
+/* where to find the 64-bit payload and footer of v2+ files */
+struct zsrc_s {
+	size_t ntr;
+	size_t nty;
+	/* width of a transition time, 4 or 8 bytes */
+	size_t wid;
+	const uint8_t *trs;
+	const uint8_t *tys;
+	const struct ztrdtl_s *tda;
+	/* footer, between newlines, or NULL */
+	const char *ftr;
+	const char *eoftr;
+};
+
+static size_t
+__data_size(const struct zih_s h[static 1U], size_t wid)
+{
+/* size of the data block following the BE header H */
+	return be32toh(h->tzh_timecnt) * (wid + 1U) +
+		be32toh(h->tzh_typecnt) * sizeof(struct ztrdtl_s) +
+		be32toh(h->tzh_charcnt) +
+		be32toh(h->tzh_leapcnt) * (wid + 4U) +
+		be32toh(h->tzh_ttisstdcnt) +
+		be32toh(h->tzh_ttisgmtcnt);
+}
+
+static void
+__find_src(struct zsrc_s tgt[static 1U], const struct zif_s z[static 1U])
+{
+/* find the best payload in the BE file Z, the v1 one by default */
+	const char *eof = (const char*)z->hdr + z->mpsz;
+	const struct zih_s *h = z->hdr;
+	const char *p = (const char*)(h + 1);
+
+	*tgt = (struct zsrc_s){.wid = 4U};
+	if (h->tzh_version[0U] >= '2') {
+		/* v2+, skip the v1 payload */
+		const struct zih_s *h2 = (const void*)(p + __data_size(h, 4U));
+		const char *q = (const char*)(h2 + 1);
+
+		if ((const char*)h2 < (const char*)h ||
+		    q > eof || memcmp(h2->tzh_magic, TZ_MAGIC, 4U) ||
+		    (p = q + __data_size(h2, 8U)) >= eof || *p++ != '\n') {
+			/* bugger, stick with v1 */
+			goto v1;
+		}
+		/* footer goes up to the next newline */
+		tgt->ftr = p;
+		for (; p < eof && *p != '\n'; p++);
+		tgt->eoftr = p;
+		if (UNLIKELY(p >= eof)) {
+			tgt->ftr = NULL;
+		}
+		h = h2;
+		p = q;
+		tgt->wid = 8U;
+	}
+v1:
+	tgt->ntr = be32toh(h->tzh_timecnt);
+	tgt->nty = be32toh(h->tzh_typecnt);
+	tgt->trs = (const uint8_t*)p;
+	tgt->tys = tgt->trs + tgt->ntr * tgt->wid;
+	tgt->tda = (const void*)(tgt->tys + tgt->ntr);
+	return;
+}
+
+static inline int64_t
+__src_trans(const struct zsrc_s src[static 1U], size_t i)
+{
+	if (src->wid > 4U) {
+		uint64_t x;
+		memcpy(&x, src->trs + i * 8U, sizeof(x));
+		return (int64_t)be64toh(x);
+	} else {
+		uint32_t x;
+		memcpy(&x, src->trs + i * 4U, sizeof(x));
+		return (int32_t)be32toh(x);
+	}
+}
+
+static inline int32_t
+__src_offs(const struct zsrc_s src[static 1U], uint8_t idx)
+{
+	uint32_t x;
+
+	if (UNLIKELY(idx >= src->nty)) {
+		return 0;
+	}
+	memcpy(&x, &src->tda[idx].offs, sizeof(x));
+	return (int32_t)be32toh(x);
+}
+
+
+/* POSIX TZ strings, as found in the footer of v2+ files */
+static const char*
+__ftr_num(int32_t *restrict tgt, const char *s, const char *e)
+{
+	const char *p = s;
+	int32_t x = 0;
+
+	for (; s < e && *s >= '0' && *s <= '9' && x < 100000; s++) {
+		x = 10 * x + (*s - '0');
+	}
+	*tgt = x;
+	return s > p ? s : NULL;
+}
+
+static const char*
+__ftr_name(const char *s, const char *e)
+{
+	const char *p = s;
+
+	if (s < e && *s == '<') {
+		/* quoted form, anything goes */
+		for (s++; s < e && *s != '>'; s++);
+		return s < e ? s + 1 : NULL;
+	}
+	for (; s < e && ((*s | 0x20) >= 'a' && (*s | 0x20) <= 'z'); s++);
+	return s - p >= 3 ? s : NULL;
+}
+
+static const char*
+__ftr_secs(int32_t *restrict tgt, const char *s, const char *e)
+{
+/* [+-]hh[:mm[:ss]] */
+	static const int32_t mul[] = {3600, 60, 1};
+	int32_t sgn = 1;
+	int32_t res = 0;
+
+	if (s < e && (*s == '+' || *s == '-')) {
+		sgn = *s++ == '-' ? -1 : 1;
+	}
+	for (size_t i = 0U; i < countof(mul); i++) {
+		int32_t x;
+
+		if ((s = __ftr_num(&x, s, e)) == NULL) {
+			return NULL;
+		}
+		res += x * mul[i];
+		if (i + 1U >= countof(mul) || s >= e || *s != ':') {
+			break;
+		}
+		s++;
+	}
+	*tgt = sgn * res;
+	return s;
+}
+
+static const char*
+__ftr_rule(struct zrul_s *restrict tgt, const char *s, const char *e)
+{
+/* Jn, n or Mm.w.d, then optionally /time */
+	int32_t x;
+
+	if (s >= e) {
+		return NULL;
+	}
+	switch ((tgt->typ = *s)) {
+	case 'J':
+		if ((s = __ftr_num(&x, s + 1, e)) == NULL || x < 1 || x > 365) {
+			return NULL;
+		}
+		tgt->n = (uint16_t)x;
+		break;
+	case 'M':
+		if ((s = __ftr_num(&x, s + 1, e)) == NULL || x < 1 || x > 12) {
+			return NULL;
+		}
+		tgt->m = (uint8_t)x;
+		if (s >= e || *s++ != '.' ||
+		    (s = __ftr_num(&x, s, e)) == NULL || x < 1 || x > 5) {
+			return NULL;
+		}
+		tgt->w = (uint8_t)x;
+		if (s >= e || *s++ != '.' ||
+		    (s = __ftr_num(&x, s, e)) == NULL || x > 6) {
+			return NULL;
+		}
+		tgt->d = (uint8_t)x;
+		break;
+	default:
+		tgt->typ = '\0';
+		if ((s = __ftr_num(&x, s, e)) == NULL || x > 365) {
+			return NULL;
+		}
+		tgt->n = (uint16_t)x;
+		break;
+	}
+	/* switches happen at 02:00:00 unless stated otherwise */
+	tgt->secs = 7200;
+	if (s < e && *s == '/') {
+		s = __ftr_secs(&tgt->secs, s + 1, e);
+	}
+	return s;
+}
+
+static int
+__ftr_parse(struct zftr_s *restrict tgt, const char *s, const char *e)
+{
+	int32_t x;
+
+	tgt->dstp = false;
+	if ((s = __ftr_name(s, e)) == NULL ||
+	    (s = __ftr_secs(&x, s, e)) == NULL) {
+		return -1;
+	}
+	/* POSIX offsets count westwards */
+	tgt->std = -x;
+	if (s >= e) {
+		/* no daylight saving time */
+		return 0;
+	} else if ((s = __ftr_name(s, e)) == NULL) {
+		return -1;
+	}
+	tgt->dst = tgt->std + 3600;
+	if (s < e && *s != ',') {
+		if ((s = __ftr_secs(&x, s, e)) == NULL) {
+			return -1;
+		}
+		tgt->dst = -x;
+	}
+	if (s >= e) {
+		/* no rules given, use the US ones like everyone else */
+		tgt->beg = (struct zrul_s){'M', 3U, 2U, 0U, 0U, 7200};
+		tgt->end = (struct zrul_s){'M', 11U, 1U, 0U, 0U, 7200};
+	} else if (*s++ != ',' ||
+		   (s = __ftr_rule(&tgt->beg, s, e)) == NULL ||
+		   s >= e || *s++ != ',' ||
+		   (s = __ftr_rule(&tgt->end, s, e)) == NULL || s < e) {
+		return -1;
+	}
+	tgt->dstp = true;
+	return 0;
+}
+
+static inline bool
+__leapp(int y)
+{
+	return !(y % 4) && (y % 100 || !(y % 400));
+}
+
+static int64_t
+__rule_days(const struct zrul_s r[static 1U], int y)
+{
+/* days since 1970-01-01 of the switch day in year Y */
+	static const uint8_t mdays[] = {
+		31U, 28U, 31U, 30U, 31U, 30U, 31U, 31U, 30U, 31U, 30U, 31U,
+	};
+
+	switch (r->typ) {
+		int64_t d1;
+		unsigned int wd1, md, d;
+
+	case 'J':
+		/* 1-based, february 29 is never counted */
+		return echs_ymd_to_days((unsigned int)y, 1U, 1U) + r->n - 1 +
+			(r->n >= 60U && __leapp(y));
+	case 'M':
+		d1 = echs_ymd_to_days((unsigned int)y, r->m, 1U);
+		/* 1970-01-01 was a thursday */
+		wd1 = (unsigned int)(((d1 + 4) % 7 + 7) % 7);
+		md = mdays[r->m - 1U] + (r->m == 2U && __leapp(y));
+		d = (r->d + 7U - wd1) % 7U + 7U * (r->w - 1U);
+		if (d >= md) {
+			/* w == 5 means the last one */
+			d -= 7U;
+		}
+		return d1 + d;
+	default:
+		/* 0-based, february 29 counts in leap years */
+		return echs_ymd_to_days((unsigned int)y, 1U, 1U) + r->n;
+	}
+}
+
+static inline int
+__year_of(int64_t t)
+{
+/* approximate year of T, off by one around new year at most */
+	int64_t q = t / 31556952;
+
+	return 1970 + (int)(q - (t % 31556952 < 0));
+}
+
+static inline int64_t
+__trtim(const struct zif_s z[static 1U], size_t k)
+{
+	return k < z->ntim ? z->tim[k] : z->ftim[k - z->ntim];
+}
+
+static inline int32_t
+__trofs(const struct zif_s z[static 1U], size_t k)
+{
+	return k < z->ntim ? z->ofs[k] : z->fofs[k - z->ntim];
+}
+
+static void
+__ftr_switch(int64_t *b, int64_t *e, const struct zftr_s f[static 1U], int y)
+{
+/* utc stamps of the switches to dst and back in year Y,
+ * the switch to dst is in standard time, the switch back in dst */
+	*b = __rule_days(&f->beg, y) * 86400 + f->beg.secs - f->std;
+	*e = __rule_days(&f->end, y) * 86400 + f->end.secs - f->dst;
+	return;
+}
+
+static int32_t
+__ftr_offs(const struct zftr_s f[static 1U], int64_t t)
+{
+/* the offset footer rule F prescribes at T */
+	int64_t best = ZTIME_MIN;
+	int32_t res = f->std;
+
+	if (!f->dstp) {
+		return res;
+	}
+	for (int y = __year_of(t) - 1, ey = y + 2; y <= ey; y++) {
+		int64_t b, e;
+
+		__ftr_switch(&b, &e, f, y);
+		if (b <= t && b > best) {
+			best = b;
+			res = f->dst;
+		}
+		if (e <= t && e > best) {
+			best = e;
+			res = f->std;
+		}
+	}
+	return res;
+}
+
+static int
+__ftr_more(struct zif_s z[static 1U])
+{
+/* materialise another year's worth of transitions from the footer
+ * rule and append them to the tail index */
+	const struct zftr_s *f = &z->ftr;
+	int64_t b, e, last;
+	int64_t t[2U];
+	int32_t o[2U];
+
+	if (!f->dstp || z->fy > ZFTR_YMAX) {
+		return -1;
+	} else if (z->nft + 2U > z->zft) {
+		size_t nu = z->zft ? 2U * z->zft : 64U;
+		int64_t *nt;
+		int32_t *no;
+
+		if ((nt = realloc(z->ftim, nu * sizeof(*nt))) == NULL) {
+			return -1;
+		}
+		z->ftim = nt;
+		if ((no = realloc(z->fofs, nu * sizeof(*no))) == NULL) {
+			return -1;
+		}
+		z->fofs = no;
+		z->zft = nu;
+	}
+	__ftr_switch(&b, &e, f, z->fy);
+	if (b < e) {
+		t[0U] = b, o[0U] = f->dst;
+		t[1U] = e, o[1U] = f->std;
+	} else {
+		/* southern hemisphere */
+		t[0U] = e, o[0U] = f->std;
+		t[1U] = b, o[1U] = f->dst;
+	}
+	last = z->nft ? z->ftim[z->nft - 1U]
+		: z->ntim ? z->tim[z->ntim - 1U] : ZTIME_MIN;
+	for (size_t i = 0U; i < countof(t); i++) {
+		if (t[i] > last) {
+			z->ftim[z->nft] = t[i];
+			z->fofs[z->nft] = o[i];
+			z->nft++;
+		}
+	}
+	z->fy++;
+	return 0;
+}
+
+static int
+__find_ftrno(struct zif_s z[static 1U], int64_t t)
+{
+/* like __find_trno() but for T past the last listed transition */
+	size_t k;
+
+	/* materialise up to T */
+	while ((!z->nft || z->ftim[z->nft - 1U] <= t) && __ftr_more(z) >= 0);
+	if (!z->nft || t < z->ftim[0U]) {
+		return (int)z->ntim - 1;
+	}
+	/* two transitions a year, guess and walk from there */
+	with (int64_t x = 2 * (int64_t)(__year_of(t) - z->fy0)) {
+		k = x <= 0 ? 0U : (size_t)x < z->nft ? (size_t)x : z->nft - 1U;
+	}
+	while (k > 0U && z->ftim[k] > t) {
+		k--;
+	}
+	while (k + 1U < z->nft && z->ftim[k + 1U] <= t) {
+		k++;
+	}
+	return (int)(z->ntim + k);
+}
+
+static inline size_t
+__idx_size(size_t ntr)
+{
+/* bytes needed for the native index of NTR transitions */
+	return (ntr + ntr + 1U) * sizeof(int64_t) +
+		(ntr + ntr + 1U) * sizeof(uint32_t);
+}
+
+static void
+__init_idx(struct zif_s z[static 1U])
+{
+	size_t ntr = z->ntim;
+
+	z->tim = (int64_t*)((char*)z + z->idxo);
+	z->eyt = z->tim + ntr;
+	z->ofs = (int32_t*)(z->eyt + ntr + 1U);
+	z->eyx = (uint32_t*)(z->ofs + ntr);
+	return;
+}
+
+static size_t
+__eytz(struct zif_s z[static 1U], size_t i, size_t k)
+{
+/* lay out the sorted transitions in eytzinger order, i.e. the implicit
+ * binary search tree with the root at 1 and the kids of K at 2K, 2K+1 */
+	size_t ntr = z->ntim;
+
+	if (k <= ntr) {
+		i = __eytz(z, i, 2U * k);
+		z->eyt[k] = z->tim[i];
+		z->eyx[k] = i++;
+		i = __eytz(z, i, 2U * k + 1U);
+	}
+	return i;
+}
+
+static void
+__mk_idx(struct zif_s z[static 1U], const struct zsrc_s src[static 1U])
+{
+	size_t ntr = z->ntim = src->ntr;
+
+	__init_idx(z);
+	for (size_t i = 0; i < ntr; i++) {
+		z->tim[i] = __src_trans(src, i);
+		z->ofs[i] = __src_offs(src, src->tys[i]);
+	}
+	/* v2+ files use the first type before the first transition,
+	 * v1 ones might start with a made-up transition, so we assume
+	 * the first offset has always been there */
+	z->ofs0 = src->wid > 4U ? __src_offs(src, 0U)
+		: ntr ? z->ofs[0U] : __src_offs(src, 0U);
+	/* slot 0 is where searches past the last transition end up */
+	z->eyt[0U] = ZTIME_MIN;
+	z->eyx[0U] = ntr;
+	(void)__eytz(z, 0U, 1U);
+
+	/* footer rule for anything past the last transition */
+	if (src->ftr == NULL ||
+	    __ftr_parse(&z->ftr, src->ftr, src->eoftr) < 0) {
+		z->ftr.dstp = false;
+	} else if (ntr) {
+		/* the footer rules from the last transition on, slim
+		 * files may even list the wrong type for it */
+		z->ofs[ntr - 1U] = __ftr_offs(&z->ftr, z->tim[ntr - 1U]);
+	}
+	z->fy0 = z->fy = ntr ? __year_of(z->tim[ntr - 1U]) - 1 : 1970;
+	return;
+}
+
+static int
+__find_trno(struct zif_s z[static 1U], int64_t t)
+{
+/* find the last transition before T, T is expected to be UTC
+ * if T is before any known transition return -1 */
+	size_t ntr = z->ntim;
+	size_t k = 1U;
+
+	if (z->ftr.dstp && (!ntr || t >= z->tim[ntr - 1U])) {
+		/* past the listed ones */
+		return __find_ftrno(z, t);
+	}
+	/* descend the eytzinger tree, going right iff the node is <= T */
+	while (k <= ntr) {
+		k = 2U * k + (z->eyt[k] <= t);
+	}
+	/* undo the trailing right turns and the final left turn, which
+	 * leaves us at the first transition after T, or 0 if there is none */
+	k >>= __builtin_ffsll(~(unsigned long long)k);
+	return (int)z->eyx[k] - 1;
+}
+
+static struct zrng_s
+__zrng(struct zif_s z[static 1U], int trno)
+{
+/* the range of validity of transition TRNO */
+	struct zrng_s res;
+
+	/* make sure the transition after TRNO is known, if any */
+	while ((size_t)(trno + 1) >= z->ntim + z->nft && __ftr_more(z) >= 0);
+
+	if (UNLIKELY(trno < 0)) {
+		res.trno = 0U;
+		res.prev = ZTIME_MIN;
+		res.next = z->ntim + z->nft ? __trtim(z, 0U) : ZTIME_MAX;
+		res.offs = z->ofs0;
+		return res;
+	}
+	res.trno = (uint8_t)trno;
+	res.prev = __trtim(z, trno);
+	res.next = trno + 1U < z->ntim + z->nft
+		? __trtim(z, trno + 1U) : ZTIME_MAX;
+	res.offs = __trofs(z, trno);
+	return res;
+}
+
 static struct zif_s*
 __copy_conv(const struct zif_s z[static 1U])
 {
 /* copy Z and do byte-order conversions */
 	size_t mpsz;
+	size_t idxo;
+	struct zsrc_s src[1U];
 	struct zif_s *res = NULL;
 
-	/* compute a size */
-	mpsz = z->mpsz + sizeof(*z);
+	/* compute a size, the index goes 8-byte aligned past the payload */
+	__find_src(src, z);
+	idxo = sizeof(*z) + ((z->mpsz + 7U) & ~7U);
+	mpsz = idxo + __idx_size(src->ntr);
 
 	/* we'll mmap ourselves a slightly larger struct so
 	 * res + 1 points to the header, while res + 0 is the zif_t */
@@ -454,6 +1032,11 @@ __copy_conv(const struct zif_s z[static 1U])
 
 	/* convert the header and payload now */
 	__conv_zif(res, z);
+	/* build the index off the best payload */
+	res->idxo = idxo;
+	__mk_idx(res, src);
+	res->cache = __zrng(res, -1);
+	res->ctrno = -1;
 
 	/* that's all :) */
 	return res;
@@ -475,7 +1058,17 @@ __copy(const struct zif_s z[static 1U])
 		return NULL;
 	}
 	memcpy(res, z, z->mpsz);
+	/* rebase pointers into the copy */
+	res->hdr = (void*)(res + 1);
 	__init_zif(res);
+	__init_idx(res);
+	/* the copy materialises its own footer transitions */
+	res->ftim = NULL;
+	res->fofs = NULL;
+	res->nft = res->zft = 0U;
+	res->fy = res->fy0;
+	res->cache = __zrng(res, -1);
+	res->ctrno = -1;
 	return res;
 }
 
@@ -496,6 +1089,10 @@ __close(const struct zif_s z[static 1U])
 {
 	if (z->fd > STDIN_FILENO) {
 		close(z->fd);
+	} else {
+		/* materialised footer transitions */
+		free(z->ftim);
+		free(z->fofs);
 	}
 	/* check if z is in mmap()'d space */
 	if (z->hdr == MAP_FAILED) {
@@ -551,96 +1148,28 @@ zif_open(const char *file)
 }
 
 
-static inline int
-__find_trno(const struct zif_s z[static 1U], int32_t t, int min, int max)
-{
-/* find the last transition before T, T is expected to be UTC
- * if T is before any known transition return -1 */
-	if (UNLIKELY(max == 0)) {
-		/* special case */
-		return -1;
-	} else if (UNLIKELY(t < zif_trans(z, min))) {
-		return -1;
-	} else if (UNLIKELY(t > zif_trans(z, max))) {
-		return max - 1;
-	}
-
-	do {
-		int32_t tl, tu;
-		int this = (min + max) / 2;
-
-		tl = zif_trans(z, this);
-		tu = zif_trans(z, this + 1);
-
-		if (t >= tl && t < tu) {
-			/* found him */
-			return this;
-		} else if (t >= tu) {
-			min = this;
-		} else if (t < tl) {
-			max = this;
-		}
-	} while (true);
-	/* not reached */
-}
-
 DEFUN inline int
 zif_find_trans(zif_t z, time_t t)
 {
 /* find the last transition before T, T is expected to be UTC
  * if T is before any known transition return -1 */
-	int max = zif_ntrans(z);
-	int min = 0;
-
-	return __find_trno(z, t, min, max);
-}
-
-static struct zrng_s
-__find_zrng(const struct zif_s z[static 1U], int32_t t, int min, int max)
-{
-	struct zrng_s res;
-	int trno;
-
-	trno = __find_trno(z, t, min, max);
-	res.prev = zif_trans(z, trno);
-	if (UNLIKELY(trno <= 0 && t < res.prev)) {
-		res.trno = 0U;
-		res.prev = INT_MIN;
-		/* assume the first offset has always been there */
-		res.next = res.prev;
-	} else if (UNLIKELY(trno < 0)) {
-		/* special case where no transitions are recorded */
-		res.trno = 0U;
-		res.prev = INT_MIN;
-		res.next = INT_MAX;
-	} else {
-		res.trno = (uint8_t)trno;
-		if (LIKELY(trno + 1U < zif_ntrans(z))) {
-			res.next = zif_trans(z, trno + 1U);
-		} else {
-			res.next = INT_MAX;
-		}
-	}
-	res.offs = zif_troffs(z, res.trno);
-	return res;
+	return __find_trno(AS_MUT_ZIF(z), t);
 }
 
 DEFUN inline struct zrng_s
 zif_find_zrng(zif_t z, time_t t)
 {
 /* find the last transition before time, time is expected to be UTC */
-	int max = zif_ntrans(z);
-	int min = 0;
-
-	return __find_zrng(z, t, min, max);
+	struct zif_s *mz = AS_MUT_ZIF(z);
+	return __zrng(mz, __find_trno(mz, t));
 }
 
 static int32_t
-__offs(struct zif_s z[static 1U], int32_t t)
+__offs(struct zif_s z[static 1U], int64_t t)
 {
 /* return the offset of T in Z and cache the result. */
-	int min;
-	size_t max;
+	struct zrng_s r;
+	int trno;
 
 	switch (z->cz) {
 	default:
@@ -650,22 +1179,18 @@ __offs(struct zif_s z[static 1U], int32_t t)
 		return 0;
 	}
 
-	/* use the classic code */
 	if (LIKELY(t >= z->cache.prev && t < z->cache.next)) {
 		/* use the cached offset */
 		return z->cache.offs;
-	} else if (t >= z->cache.next) {
-		min = z->cache.trno + 1;
-		max = zif_ntrans(z);
-	} else if (t < z->cache.prev) {
-		max = z->cache.trno;
-		min = 0;
+	} else if (t >= z->cache.next &&
+		   t < (r = __zrng(z, trno = z->ctrno + 1)).next) {
+		/* monotone access, T is in the range right after ours */
+		;
 	} else {
-		/* we shouldn't end up here at all */
-		min = 0;
-		max = 0;
+		r = __zrng(z, trno = __find_trno(z, t));
 	}
-	return (z->cache = __find_zrng(z, t, min, max)).offs;
+	z->ctrno = trno;
+	return (z->cache = r).offs;
 }
 
 DEFUN time_t
@@ -74,7 +74,8 @@ __yd_to_md(struct yd_s yd)
 	cake = GET_REM(m + 1);
 
 	/* put leap years into cake */
-	if (UNLIKELY((yd.y % 4) == 0U && cake < 16U)) {
+	if (UNLIKELY((yd.y % 4) == 0U && cake < 16U) &&
+	    (yd.y % 100U || !(yd.y % 400U))) {
 		/* note how all leap-affected cakes are < 16 */
 		beef += beef < 16U;
 		cake++;
@@ -97,7 +98,8 @@ __md_to_yd(unsigned int y, struct md_s md)
 		0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
 	};
 	unsigned int doy = __mon_yday[md.m - 1] + md.d +
-		(UNLIKELY((y % 4U) == 0) && md.m >= 3U);
+		(UNLIKELY((y % 4U) == 0) && md.m >= 3U &&
+		 (y % 100U || !(y % 400U)));
 
 	return (struct yd_s){.y = y, .d = doy};
 }
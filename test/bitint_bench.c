@@ -0,0 +1,140 @@
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "bitint.h"
+
+/* whole-set kernels against their bit-by-bit equivalents on candidate
+ * sets of the size yearly rules produce, from a handful of days to
+ * all weekend days in a year */
+static const size_t nms[] = {16U, 64U, 128U};
+
+#define NSET	(64U)
+
+static double
+tdiff(struct timespec t0, struct timespec t1)
+{
+	return (double)(t1.tv_sec - t0.tv_sec) * 1e9 +
+		(double)(t1.tv_nsec - t0.tv_nsec);
+}
+
+static void
+mkset(bitint383_t *restrict x, size_t nm)
+{
+	*x = (bitint383_t){0U};
+	for (size_t i = 0U; i < nm; i++) {
+		/* packed month/day candidates */
+		ass_bi383(x, 32 * (rand() % 12) + 1 + rand() % 28);
+	}
+	return;
+}
+
+static size_t
+iter_cnt(const bitint383_t *x)
+{
+	size_t n = 0U;
+
+	for (bitint_iter_t i = 0U; (bi383_next(&i, x), i); n++);
+	return n;
+}
+
+static int
+iter_nth(const bitint383_t *x, size_t n)
+{
+	int v = 0;
+
+	for (bitint_iter_t i = 0U; (v = bi383_next(&i, x), i) && n; n--);
+	return v;
+}
+
+static void
+iter_or(bitint383_t *restrict tgt, const bitint383_t *src)
+{
+	int v;
+
+	for (bitint_iter_t i = 0U; (v = bi383_next(&i, src), i);) {
+		ass_bi383(tgt, v);
+	}
+	return;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	size_t nops = 1000000U;
+	bitint383_t xs[NSET], ys[NSET];
+
+	if (argc > 1) {
+		nops = strtoul(argv[1], NULL, 10);
+	}
+	for (size_t k = 0U; k < sizeof(nms) / sizeof(*nms); k++) {
+		struct timespec t0, t1;
+		volatile size_t sink = 0U;
+		double ti, tw;
+
+		srand(nms[k]);
+		for (size_t i = 0U; i < NSET; i++) {
+			mkset(xs + i, nms[k]);
+			mkset(ys + i, nms[k]);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for (size_t i = 0U; i < nops; i++) {
+			sink += iter_cnt(xs + i % NSET);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		ti = tdiff(t0, t1);
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for (size_t i = 0U; i < nops; i++) {
+			sink += bi383_cnt(xs + i % NSET);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		tw = tdiff(t0, t1);
+		printf("%zu ints\tcnt\titer %.1f ns/op\twhole %.1f ns/op\n",
+		       nms[k], ti / (double)nops, tw / (double)nops);
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for (size_t i = 0U; i < nops; i++) {
+			const bitint383_t *x = xs + i % NSET;
+			sink += iter_nth(x, i % bi383_cnt(x));
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		ti = tdiff(t0, t1);
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for (size_t i = 0U; i < nops; i++) {
+			const bitint383_t *x = xs + i % NSET;
+			sink += bi383_nth(x, i % bi383_cnt(x));
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		tw = tdiff(t0, t1);
+		printf("%zu ints\tnth\titer %.1f ns/op\twhole %.1f ns/op\n",
+		       nms[k], ti / (double)nops, tw / (double)nops);
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for (size_t i = 0U; i < nops; i++) {
+			bitint383_t z = xs[i % NSET];
+			iter_or(&z, ys + i % NSET);
+			sink += *z.pos;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		ti = tdiff(t0, t1);
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for (size_t i = 0U; i < nops; i++) {
+			bitint383_t z = xs[i % NSET];
+			bi383_or(&z, ys + i % NSET);
+			sink += *z.pos;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		tw = tdiff(t0, t1);
+		printf("%zu ints\tor\titer %.1f ns/op\twhole %.1f ns/op\n",
+		       nms[k], ti / (double)nops, tw / (double)nops);
+		(void)sink;
+	}
+	return 0;
+}
+
+/* bitint_bench.c ends here */
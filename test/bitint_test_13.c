@@ -0,0 +1,70 @@
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdio.h>
+#include "bitint.h"
+
+static void
+prnt(const bitint383_t *x)
+{
+	const size_t n = bi383_cnt(x);
+	size_t k = 0U;
+	int v;
+
+	printf("cnt %zu\n", n);
+	/* nth must agree with the iterator */
+	for (bitint_iter_t i = 0U; (v = bi383_next(&i, x), i); k++) {
+		printf("got %d\t%d\n", v, bi383_nth(x, k));
+	}
+	if (k != n) {
+		puts("count mismatch");
+	}
+	putchar('\n');
+	return;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	bitint383_t x = {0U};
+	bitint383_t y = {0U};
+	bitint383_t z;
+
+	/* natively stored */
+	ass_bi383(&x, 36);
+	ass_bi383(&x, -48);
+	ass_bi383(&x, 0);
+	ass_bi383(&x, 59);
+	prnt(&x);
+
+	/* bitset */
+	for (int i = 1; i <= 12; i++) {
+		ass_bi383(&y, 31 * i);
+	}
+	ass_bi383(&y, 0);
+	ass_bi383(&y, -1);
+	ass_bi383(&y, -33);
+	ass_bi383(&y, 59);
+	prnt(&y);
+
+	z = x;
+	bi383_or(&z, &y);
+	prnt(&z);
+
+	z = x;
+	bi383_and(&z, &y);
+	prnt(&z);
+
+	z = y;
+	bi383_andn(&z, &x);
+	prnt(&z);
+
+	/* empty results are empty again */
+	z = x;
+	bi383_andn(&z, &x);
+	printf("%d\n", bi383_has_bits_p(&z));
+	return 0;
+}
+
+/* bitint_test.c ends here */
@@ -0,0 +1,30 @@
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdio.h>
+#include "bitint.h"
+
+
+int
+main(int argc, char *argv[])
+{
+	bitset383_t x = {0U};
+	static const unsigned int b[] = {1U, 31U, 32U, 33U, 95U, 200U, 383U};
+
+	for (size_t i = 0U; i < sizeof(b) / sizeof(*b); i++) {
+		bs383_set(&x, b[i]);
+	}
+	bs383_clr(&x, 33U);
+
+	/* select must invert rank */
+	for (size_t n = 0U; n <= 6U; n++) {
+		const int v = bs383_select(&x, n);
+
+		printf("%zu\t%d\t%zu\n", n, v, v >= 0 ? bs383_rank(&x, v) : 0U);
+	}
+	printf("%zu %zu %zu\n",
+	       bs383_rank(&x, 0U), bs383_rank(&x, 96U), bs383_rank(&x, 384U));
+	return 0;
+}
+
+/* bitint_test.c ends here */
@@ -0,0 +1,121 @@
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "evstrm.h"
+
+/* a synthetic stream, events are FROM + n * STEP milliseconds
+ * so that all the time is spent in the muxer */
+struct bstrm_s {
+	echs_evstrm_class_t class;
+	uint64_t cur;
+	uint64_t step;
+	echs_oid_t oid;
+};
+
+static echs_instant_t
+ctr_to_instant(uint64_t c)
+{
+	echs_instant_t r = {.y = 2000U, .m = 1U, .d = 1U};
+
+	r.ms = c % 1000U, c /= 1000U;
+	r.S = c % 60U, c /= 60U;
+	r.M = c % 60U, c /= 60U;
+	r.H = c % 24U, c /= 24U;
+	r.d += c % 28U, c /= 28U;
+	r.m += c % 12U, c /= 12U;
+	r.y += c;
+	return r;
+}
+
+static echs_event_t
+next_bstrm(echs_evstrm_t s, bool popp)
+{
+	struct bstrm_s *this = (struct bstrm_s*)s;
+	echs_event_t e = {
+		.from = ctr_to_instant(this->cur),
+		.oid = this->oid,
+	};
+
+	if (popp) {
+		this->cur += this->step;
+	}
+	return e;
+}
+
+static void
+free_bstrm(echs_evstrm_t s)
+{
+	free(s);
+	return;
+}
+
+static echs_evstrm_t
+clone_bstrm(echs_const_evstrm_t s)
+{
+	struct bstrm_s *res = malloc(sizeof(*res));
+
+	*res = *(const struct bstrm_s*)s;
+	return (echs_evstrm_t)res;
+}
+
+static const struct echs_evstrm_class_s bstrm_cls = {
+	.next = next_bstrm,
+	.free = free_bstrm,
+	.clone = clone_bstrm,
+};
+
+static double
+bench(size_t ns, size_t npop)
+{
+	echs_evstrm_t *s = malloc(ns * sizeof(*s));
+	echs_evstrm_t mux;
+	struct timespec t0, t1;
+
+	srand(ns);
+	for (size_t i = 0U; i < ns; i++) {
+		struct bstrm_s *b = malloc(sizeof(*b));
+
+		b->class = &bstrm_cls;
+		b->cur = rand() % 1000U;
+		b->step = 1U + rand() % ns;
+		b->oid = i + 1U;
+		s[i] = (echs_evstrm_t)b;
+	}
+	mux = echs_evstrm_vmux(s, ns);
+	free(s);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (size_t i = 0U; i < npop; i++) {
+		(void)echs_evstrm_pop(mux);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	free_echs_evstrm(mux);
+	return (double)(t1.tv_sec - t0.tv_sec) * 1e9 +
+		(double)(t1.tv_nsec - t0.tv_nsec);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	static const size_t nss[] = {10U, 1000U, 100000U};
+	size_t npop = 1000000U;
+
+	if (argc > 1) {
+		npop = strtoul(argv[1], NULL, 10);
+	}
+	for (size_t i = 0U; i < sizeof(nss) / sizeof(*nss); i++) {
+		double ns = bench(nss[i], npop);
+
+		printf("%zu streams\t%zu pops\t%.1f ns/pop\t%.0f pops/s\n",
+		       nss[i], npop, ns / (double)npop,
+		       (double)npop / ns * 1e9);
+	}
+	return 0;
+}
+
+/* evmux_bench.c ends here */
@@ -0,0 +1,119 @@
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdio.h>
+#include "evstrm.h"
+
+/* one generator, several readers */
+
+static void
+prnt(const char *who, echs_evstrm_t s, size_t n)
+{
+	for (; n > 0U; n--) {
+		echs_event_t e = echs_evstrm_pop(s);
+
+		if (echs_event_0_p(e)) {
+			printf("%s\t-\n", who);
+			break;
+		}
+		printf("%s\t%04u-%02u-%02u\n", who, e.from.y, e.from.m, e.from.d);
+	}
+	return;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	static const echs_instant_t i1959 = {
+		.y = 1959U, .m = 5U, .d = 25U, .H = ECHS_ALL_DAY
+	};
+	static const echs_instant_t i2012 = {
+		.y = 2012U, .m = 1U, .d = 1U, .H = ECHS_ALL_DAY
+	};
+	echs_evstrm_t a, b, c, m, x;
+
+	if (argc <= 1) {
+		return 1;
+	}
+
+	/* two cursors at their own pace */
+	if ((a = echs_evstrm_tee(make_echs_evstrm_from_file(argv[1]))) == NULL) {
+		return 1;
+	}
+	b = clone_echs_evstrm(a);
+	prnt("a", a, 3U);
+	prnt("b", b, 5U);
+	prnt("a", a, 3U);
+	/* peek with B, then make B the sole reader and seek
+	 * to the event it peeked at */
+	(void)echs_evstrm_next(b);
+	free_echs_evstrm(a);
+	echs_evstrm_seek(b, i1959);
+	prnt("b", b, 1U);
+	echs_evstrm_seek(b, i2012);
+	prnt("b", b, 2U);
+	free_echs_evstrm(b);
+
+	/* the ring grows while one cursor runs ahead */
+	if ((a = echs_evstrm_tee(make_echs_evstrm_from_file(argv[1]))) == NULL) {
+		return 1;
+	}
+	b = clone_echs_evstrm(a);
+	(void)echs_evstrm_skip(a, 99U, echs_max_instant());
+	prnt("a", a, 1U);
+	(void)echs_evstrm_skip(b, 99U, echs_max_instant());
+	prnt("b", b, 1U);
+	free_echs_evstrm(a);
+	free_echs_evstrm(b);
+
+	/* clones of muxes and filters leave their source alone */
+	if ((m = make_echs_evstrm_from_file(argv[1])) == NULL) {
+		return 1;
+	}
+	prnt("m", m, 2U);
+	c = clone_echs_evstrm(m);
+	prnt("m", m, 2U);
+	prnt("c", c, 3U);
+	free_echs_evstrm(c);
+	if (echs_evstrm_demux(&x, 1U, m, 0U)) {
+		echs_evstrm_t y = clone_echs_evstrm(x);
+
+		echs_evstrm_seek(y, i2012);
+		prnt("y", y, 2U);
+		free_echs_evstrm(y);
+	}
+	prnt("m", m, 1U);
+	/* sharing is explicit */
+	if ((x = echs_evstrm_share(&m)) == NULL) {
+		return 1;
+	}
+	prnt("m", m, 1U);
+	prnt("x", x, 2U);
+	prnt("m", m, 1U);
+	free_echs_evstrm(x);
+	free_echs_evstrm(m);
+
+	if (argc <= 2) {
+		return 0;
+	}
+	/* a cursor lagging far behind gets split off */
+	if ((a = echs_evstrm_tee(make_echs_evstrm_from_file(argv[2]))) == NULL) {
+		return 1;
+	}
+	b = clone_echs_evstrm(a);
+	c = clone_echs_evstrm(a);
+	prnt("b", b, 1U);
+	(void)echs_evstrm_skip(a, 9999U, echs_max_instant());
+	prnt("a", a, 1U);
+	(void)echs_evstrm_skip(b, 9998U, echs_max_instant());
+	prnt("b", b, 1U);
+	free_echs_evstrm(a);
+	free_echs_evstrm(b);
+	(void)echs_evstrm_skip(c, 9999U, echs_max_instant());
+	prnt("c", c, 1U);
+	free_echs_evstrm(c);
+	return 0;
+}
+
+/* evstrm_test_01.c ends here */
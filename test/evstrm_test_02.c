@@ -0,0 +1,220 @@
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdio.h>
+#include <stdlib.h>
+#include "evstrm.h"
+#include "evmrul.h"
+
+/* movers and their look-behinds */
+
+static void
+prnt(const char *who, echs_event_t e)
+{
+	if (echs_event_0_p(e)) {
+		printf("%s\t-\n", who);
+		return;
+	}
+	printf("%s\t%04u-%02u-%02u\n", who, e.from.y, e.from.m, e.from.d);
+	return;
+}
+
+static echs_instant_t
+mkday(unsigned int y, unsigned int m, unsigned int d)
+{
+	return (echs_instant_t){.y = y, .m = m, .d = d, .H = ECHS_ALL_DAY};
+}
+
+static int
+mrul(echs_mdir_t dir, const char *movf, const char *stsf)
+{
+	echs_evstrm_t mov = make_echs_evstrm_from_file(movf);
+	echs_evstrm_t sts = make_echs_evstrm_from_file(stsf);
+	mrulsp_t mr = {.mdir = dir};
+	echs_evstrm_t s;
+
+	if (mov == NULL || sts == NULL) {
+		return -1;
+	}
+	/* move away from whatever the states say */
+	mr.from = echs_evstrm_next(sts).sts;
+	if ((s = make_evmrul(&mr, mov, sts)) == NULL) {
+		return -1;
+	}
+	echs_evstrm_seek(s, mkday(2014U, 1U, 1U));
+	prnt("next", echs_evstrm_pop(s));
+	/* right before a mover's original spot and right before the
+	 * spot it's moved to */
+	prnt("prev", echs_evstrm_prev(s, mkday(2014U, 2U, 21U)));
+	prnt("prev", echs_evstrm_prev(s, mkday(2014U, 2U, 20U)));
+	prnt("prev", echs_evstrm_prev(s, mkday(2014U, 2U, 25U)));
+	prnt("next", echs_evstrm_pop(s));
+	prnt("next", echs_evstrm_pop(s));
+	/* same again with the movers popped already */
+	prnt("prev", echs_evstrm_prev(s, mkday(2014U, 2U, 21U)));
+	prnt("prev", echs_evstrm_prev(s, mkday(2014U, 2U, 20U)));
+	prnt("prev", echs_evstrm_prev(s, mkday(2014U, 2U, 25U)));
+	free_echs_evstrm(s);
+	return 0;
+}
+
+static int
+adv(echs_mdir_t dir, const char *movf, const char *stsf)
+{
+/* states that have been read ahead still block movers */
+	echs_evstrm_t mov = make_echs_evstrm_from_file(movf);
+	echs_evstrm_t sts = make_echs_evstrm_from_file(stsf);
+	mrulsp_t mr = {.mdir = dir};
+	echs_evstrm_t s;
+
+	if (mov == NULL || sts == NULL) {
+		return -1;
+	}
+	mr.from = echs_evstrm_next(sts).sts;
+	echs_evstrm_seek(sts, mkday(2015U, 1U, 1U));
+	if ((s = make_evmrul(&mr, mov, sts)) == NULL) {
+		return -1;
+	}
+	echs_evstrm_seek(s, mkday(2014U, 1U, 1U));
+	for (size_t i = 0U; i < 3U; i++) {
+		prnt("adv", echs_evstrm_pop(s));
+	}
+	free_echs_evstrm(s);
+	return 0;
+}
+
+static int
+mux(const char *movf, const char *stsf)
+{
+	const echs_instant_t from = mkday(2014U, 1U, 1U);
+	const echs_instant_t till = mkday(2014U, 1U, 31U);
+	echs_evstrm_t s;
+	size_t n = 0U;
+
+	s = echs_evstrm_mux(
+		echs_evstrm_window(make_echs_evstrm_from_file(movf), from, till),
+		echs_evstrm_window(make_echs_evstrm_from_file(stsf), from, till),
+		NULL);
+	if (s == NULL) {
+		return -1;
+	}
+	/* run it dry, then look behind */
+	for (; !echs_event_0_p(echs_evstrm_pop(s)); n++);
+	printf("mux\t%zu\n", n);
+	prnt("prev", echs_evstrm_prev(s, mkday(2014U, 1U, 17U)));
+	prnt("prev", echs_evstrm_prev(s, mkday(2015U, 1U, 1U)));
+	free_echs_evstrm(s);
+	return 0;
+}
+
+/* a stream class that can't look behind by itself */
+struct plain_s {
+	echs_evstrm_class_t class;
+	echs_evstrm_t s;
+};
+
+static echs_evstrm_t make_plain(echs_evstrm_t);
+
+static echs_event_t
+next_plain(echs_evstrm_t s, bool popp)
+{
+	struct plain_s *this = (struct plain_s*)s;
+
+	return this->s->class->next(this->s, popp);
+}
+
+static echs_evstrm_t
+clone_plain(echs_const_evstrm_t s)
+{
+	const struct plain_s *this = (const struct plain_s*)s;
+
+	return make_plain(clone_echs_evstrm(this->s));
+}
+
+static void
+free_plain(echs_evstrm_t s)
+{
+	struct plain_s *this = (struct plain_s*)s;
+
+	free_echs_evstrm(this->s);
+	free(this);
+	return;
+}
+
+static void
+seria_plain(int whither, echs_const_evstrm_t s)
+{
+	const struct plain_s *this = (const struct plain_s*)s;
+
+	echs_evstrm_seria(whither, this->s);
+	return;
+}
+
+static const struct echs_evstrm_class_s plain_cls = {
+	.next = next_plain,
+	.clone = clone_plain,
+	.free = free_plain,
+	.seria = seria_plain,
+};
+
+static echs_evstrm_t
+make_plain(echs_evstrm_t s)
+{
+	struct plain_s *res;
+
+	if (s == NULL || (res = malloc(sizeof(*res))) == NULL) {
+		return NULL;
+	}
+	res->class = &plain_cls;
+	res->s = s;
+	return (echs_evstrm_t)res;
+}
+
+static int
+plain(const char *movf)
+{
+	echs_evstrm_t s = make_plain(make_echs_evstrm_from_file(movf));
+
+	if (s == NULL) {
+		return -1;
+	}
+	/* scanned forward from where the stream is */
+	echs_evstrm_seek(s, mkday(2014U, 1U, 1U));
+	prnt("prev", echs_evstrm_prev(s, mkday(2014U, 1U, 1U)));
+	prnt("prev", echs_evstrm_prev(s, mkday(2014U, 2U, 21U)));
+	prnt("next", echs_evstrm_pop(s));
+	prnt("prev", echs_evstrm_prev(s, mkday(2014U, 2U, 21U)));
+	prnt("next", echs_evstrm_next(s));
+	free_echs_evstrm(s);
+	return 0;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	if (argc <= 2) {
+		return 1;
+	}
+	if (mrul(MDIR_PAST, argv[1], argv[2]) < 0) {
+		return 1;
+	}
+	if (mrul(MDIR_FUTURE, argv[1], argv[2]) < 0) {
+		return 1;
+	}
+	if (adv(MDIR_PAST, argv[1], argv[2]) < 0) {
+		return 1;
+	}
+	if (adv(MDIR_FUTURE, argv[1], argv[2]) < 0) {
+		return 1;
+	}
+	if (mux(argv[1], argv[2]) < 0) {
+		return 1;
+	}
+	if (plain(argv[1]) < 0) {
+		return 1;
+	}
+	return 0;
+}
+
+/* evstrm_test_02.c ends here */
@@ -0,0 +1,125 @@
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "instant.h"
+#include "nifty.h"
+
+/* civil <-> epoch over the full range of years */
+
+static void
+prnt(echs_instant_t i)
+{
+	const time_t t = echs_instant_to_epoch(i);
+	const echs_instant_t r = epoch_to_echs_instant(t);
+
+	printf("%04u-%02u-%02u", i.y, i.m, i.d);
+	if (!echs_instant_all_day_p(i)) {
+		printf("T%02u:%02u:%02u", i.H, i.M, i.S);
+	}
+	printf("\t%lld\t%04u-%02u-%02uT%02u:%02u:%02u\n",
+	       (long long int)t, r.y, r.m, r.d, r.H, r.M, r.S);
+	return;
+}
+
+static echs_instant_t
+next_day(echs_instant_t i)
+{
+	static const unsigned int mdays[] = {
+		0U, 31U, 28U, 31U, 30U, 31U, 30U, 31U, 31U, 30U, 31U, 30U, 31U,
+	};
+	const unsigned int y = i.y;
+	const unsigned int ndim = mdays[i.m] +
+		(i.m == 2U && !(y % 4U) && (y % 100U || !(y % 400U)));
+
+	if (++i.d > ndim) {
+		i.d = 1U;
+		if (++i.m > 12U) {
+			i.m = 1U;
+			i.y++;
+		}
+	}
+	return i;
+}
+
+static size_t
+days(void)
+{
+/* every day of every year, the dates must come out consecutive and
+ * convert back to the same day number */
+	const int64_t d0 = echs_ymd_to_days(0U, 1U, 1U);
+	const int64_t dn = echs_ymd_to_days(65535U, 12U, 31U);
+	echs_instant_t p = {.y = 0U, .m = 1U, .d = 1U};
+	size_t nbad = 0U;
+
+	for (int64_t d = d0; d <= dn; d++) {
+		const time_t t = (time_t)d * 86400;
+		const echs_instant_t i = epoch_to_echs_instant(t);
+		const echs_instant_t q = d > d0 ? next_day(p) : p;
+
+		if (i.y != q.y || i.m != q.m || i.d != q.d ||
+		    echs_ymd_to_days(i.y, i.m, i.d) != d) {
+			nbad++;
+		}
+		p = i;
+	}
+	printf("days\t%lld\t%zu\n", (long long int)(dn - d0 + 1), nbad);
+	return nbad;
+}
+
+static size_t
+vect(void)
+{
+/* the array versions agree with the scalar ones */
+	static const echs_instant_t i[] = {
+		{.y = 0U, .m = 1U, .d = 1U, .H = 0U},
+		{.y = 1969U, .m = 12U, .d = 31U, .H = 23U, .M = 59U, .S = 59U},
+		{.y = 2000U, .m = 2U, .d = 29U, .H = ECHS_ALL_DAY},
+		{.y = 2038U, .m = 1U, .d = 19U, .H = 3U, .M = 14U, .S = 8U},
+		{.y = 65535U, .m = 12U, .d = 31U, .H = 23U, .M = 59U, .S = 59U},
+	};
+	time_t t[countof(i)];
+	echs_instant_t r[countof(i)];
+	size_t nbad = 0U;
+
+	echs_instant_to_epoch_v(t, i, countof(i));
+	epoch_to_echs_instant_v(r, t, countof(i));
+	for (size_t k = 0U; k < countof(i); k++) {
+		nbad += t[k] != echs_instant_to_epoch(i[k]);
+		nbad += !echs_instant_eq_p(r[k], epoch_to_echs_instant(t[k]));
+	}
+	printf("vect\t%zu\n", nbad);
+	return nbad;
+}
+
+
+int
+main(void)
+{
+	/* the ends of the range and the odd leap years in between */
+	prnt((echs_instant_t){.y = 0U, .m = 1U, .d = 1U, .H = 0U});
+	prnt((echs_instant_t){.y = 0U, .m = 2U, .d = 29U, .H = 12U});
+	prnt((echs_instant_t){.y = 1600U, .m = 2U, .d = 29U, .H = 0U});
+	prnt((echs_instant_t){.y = 1900U, .m = 3U, .d = 1U, .H = 0U});
+	prnt((echs_instant_t){.y = 1969U, .m = 12U, .d = 31U,
+				.H = 23U, .M = 59U, .S = 59U});
+	prnt((echs_instant_t){.y = 1970U, .m = 1U, .d = 1U, .H = 0U});
+	prnt((echs_instant_t){.y = 2038U, .m = 1U, .d = 19U,
+				.H = 3U, .M = 14U, .S = 8U});
+	prnt((echs_instant_t){.y = 2100U, .m = 2U, .d = 28U, .H = 0U});
+	prnt((echs_instant_t){.y = 2100U, .m = 3U, .d = 1U, .H = 0U});
+	prnt((echs_instant_t){.y = 65535U, .m = 12U, .d = 31U,
+				.H = 23U, .M = 59U, .S = 59U});
+	/* all-day instants map to the start of their day */
+	prnt((echs_instant_t){.y = 1969U, .m = 12U, .d = 31U,
+				.H = ECHS_ALL_DAY});
+	prnt((echs_instant_t){.y = 2000U, .m = 2U, .d = 29U,
+				.H = ECHS_ALL_DAY});
+	prnt((echs_instant_t){.y = 2400U, .m = 12U, .d = 31U,
+				.H = ECHS_ALL_DAY});
+	return days() || vect();
+}
+
+/* instant_test_01.c ends here */
@@ -0,0 +1,105 @@
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "slab.h"
+
+/* inject/eject churn, keep NLIVE objects alive and replace a random
+ * one at a time, sizes are roughly those of the stream objects:
+ * filters and tee cursors, muxers over a handful of streams and
+ * rrule groups which are the big ones */
+static const size_t zs[] = {32U, 64U, 200U, 520U, 1100U, 2300U};
+
+static struct echs_slab_s bench_slab = ECHS_SLAB_INIT("bench");
+
+static double
+tdiff(struct timespec t0, struct timespec t1)
+{
+	return (double)(t1.tv_sec - t0.tv_sec) * 1e9 +
+		(double)(t1.tv_nsec - t0.tv_nsec);
+}
+
+static double
+bench_malloc(void **p, const size_t *z, size_t nlive, size_t nchurn)
+{
+	struct timespec t0, t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (size_t i = 0U; i < nlive; i++) {
+		p[i] = malloc(z[i]);
+	}
+	for (size_t i = 0U, j = 0U; i < nchurn; i++) {
+		j = (j * 1103515245U + 12345U) % nlive;
+		free(p[j]);
+		p[j] = malloc(z[(i + j) % nlive]);
+	}
+	for (size_t i = 0U; i < nlive; i++) {
+		free(p[i]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return tdiff(t0, t1);
+}
+
+static double
+bench_slab_(void **p, const size_t *z, size_t nlive, size_t nchurn)
+{
+	struct timespec t0, t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (size_t i = 0U; i < nlive; i++) {
+		p[i] = echs_slab_alloc(&bench_slab, z[i]);
+	}
+	for (size_t i = 0U, j = 0U; i < nchurn; i++) {
+		j = (j * 1103515245U + 12345U) % nlive;
+		echs_slab_free(&bench_slab, p[j]);
+		p[j] = echs_slab_alloc(&bench_slab, z[(i + j) % nlive]);
+	}
+	for (size_t i = 0U; i < nlive; i++) {
+		echs_slab_free(&bench_slab, p[i]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return tdiff(t0, t1);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	static const size_t nls[] = {16U, 1024U, 65536U};
+	size_t nchurn = 10000000U;
+
+	if (argc > 1) {
+		nchurn = strtoul(argv[1], NULL, 10);
+	}
+	for (size_t i = 0U; i < sizeof(nls) / sizeof(*nls); i++) {
+		const size_t nl = nls[i];
+		void **p = malloc(nl * sizeof(*p));
+		size_t *z = malloc(nl * sizeof(*z));
+		double tm, ts;
+
+		srand(nl);
+		for (size_t j = 0U; j < nl; j++) {
+			/* small objects are much more common */
+			size_t k = rand() % 16U;
+			z[j] = zs[k < 6U ? 0U : k < 10U ? 1U : k < 13U ? 2U
+				  : k < 14U ? 3U : k < 15U ? 4U : 5U];
+		}
+		tm = bench_malloc(p, z, nl, nchurn);
+		ts = bench_slab_(p, z, nl, nchurn);
+
+		printf("%zu live\t%zu churns\tmalloc %.1f ns/op\t"
+		       "slab %.1f ns/op\t(%zu objects, %zu bytes left, "
+		       "%zu chunks held)\n",
+		       nl, nchurn, tm / (double)nchurn, ts / (double)nchurn,
+		       bench_slab.nlive, bench_slab.zlive, bench_slab.nchunk);
+		echs_slab_clear(&bench_slab);
+		free(p);
+		free(z);
+	}
+	return 0;
+}
+
+/* slab_bench.c ends here */
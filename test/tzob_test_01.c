@@ -0,0 +1,86 @@
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdio.h>
+#include <string.h>
+#include "tzob.h"
+#include "nifty.h"
+
+/* bulk utc conversion against the scalar one */
+
+static size_t
+cmp(echs_tzob_t z, const echs_instant_t *in, size_t n)
+{
+	echs_instant_t v[1024U];
+	size_t nmov;
+	size_t nbad = 0U;
+
+	memcpy(v, in, n * sizeof(*in));
+	nmov = echs_instant_utc_v(v, n, z);
+	for (size_t k = 0U; k < n; k++) {
+		const echs_instant_t x = echs_instant_utc(in[k], z);
+
+		nbad += !echs_instant_eq_p(v[k], x);
+		nmov -= !echs_instant_eq_p(in[k], x);
+	}
+	return nbad + (nmov != 0U);
+}
+
+static size_t
+zone(const char *zn)
+{
+	static const echs_instant_t sw[] = {
+		/* the 2015 switches in Europe, the US and Australia */
+		{.y = 2015U, .m = 3U, .d = 8U},
+		{.y = 2015U, .m = 3U, .d = 29U},
+		{.y = 2015U, .m = 4U, .d = 5U},
+		{.y = 2015U, .m = 10U, .d = 4U},
+		{.y = 2015U, .m = 10U, .d = 25U},
+		{.y = 2015U, .m = 11U, .d = 1U},
+	};
+	const echs_tzob_t z = echs_tzob(zn, strlen(zn));
+	echs_instant_t in[countof(sw) * 96U];
+	size_t n = 0U;
+	size_t nbad;
+
+	/* every 15 minutes on switch days, gaps and overlaps included */
+	for (size_t i = 0U; i < countof(sw); i++) {
+		for (unsigned int q = 0U; q < 96U; q++) {
+			echs_instant_t x = sw[i];
+
+			x.H = q / 4U, x.M = q % 4U * 15U, x.ms = ECHS_ALL_SEC;
+			in[n++] = x;
+		}
+	}
+	/* sorted, then backwards so every lookup misses the range */
+	nbad = cmp(z, in, n);
+	for (size_t i = 0U, j = n - 1U; i < j; i++, j--) {
+		const echs_instant_t t = in[i];
+		in[i] = in[j];
+		in[j] = t;
+	}
+	nbad += cmp(z, in, n);
+	/* all-day instants stay put */
+	for (size_t i = 0U; i < countof(sw); i++) {
+		in[i] = sw[i];
+		in[i].H = ECHS_ALL_DAY;
+	}
+	nbad += cmp(z, in, countof(sw));
+	printf("%s\t%zu\n", zn, nbad);
+	return nbad;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	size_t nbad = 0U;
+
+	for (int i = 1; i < argc; i++) {
+		nbad += zone(argv[i]);
+	}
+	clear_tzobs();
+	return nbad > 0U;
+}
+
+/* tzob_test_01.c ends here */
@@ -0,0 +1,84 @@
+#if defined HAVE_CONFIG_H
+# include "config.h"
+#endif	/* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "tzraw.h"
+
+/* utc->local and local->utc conversions over 1920 to 2037, once with
+ * stamps in ascending order like unrolled streams produce them, and
+ * once in random order */
+#define NSTMP	(4096U)
+#define TMIN	(-1577923200L)
+#define TSPN	(3700000000L)
+
+static double
+tdiff(struct timespec t0, struct timespec t1)
+{
+	return (double)(t1.tv_sec - t0.tv_sec) * 1e9 +
+		(double)(t1.tv_nsec - t0.tv_nsec);
+}
+
+static int
+cmp_time(const void *a, const void *b)
+{
+	const time_t x = *(const time_t*)a;
+	const time_t y = *(const time_t*)b;
+	return (x > y) - (x < y);
+}
+
+static double
+bench(time_t(*f)(zif_t, time_t), zif_t z, const time_t *ts, size_t nops)
+{
+	struct timespec t0, t1;
+	volatile time_t sink = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (size_t i = 0U; i < nops; i++) {
+		sink += f(z, ts[i % NSTMP]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	(void)sink;
+	return tdiff(t0, t1) / (double)nops;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	const char *zn = "Europe/Berlin";
+	size_t nops = 10000000U;
+	static time_t seq[NSTMP], rnd[NSTMP];
+	zif_t z;
+
+	if (argc > 1) {
+		zn = argv[1];
+	}
+	if (argc > 2) {
+		nops = strtoul(argv[2], NULL, 10);
+	}
+	if ((z = zif_open(zn)) == NULL) {
+		fprintf(stderr, "cannot open zone %s\n", zn);
+		return 1;
+	}
+
+	srand(NSTMP);
+	for (size_t i = 0U; i < NSTMP; i++) {
+		rnd[i] = seq[i] = TMIN + (time_t)rand() * 2 % TSPN;
+	}
+	qsort(seq, NSTMP, sizeof(*seq), cmp_time);
+
+	printf("%s\tlocal\tseq %.1f ns/op\trnd %.1f ns/op\n", zn,
+	       bench(zif_local_time, z, seq, nops),
+	       bench(zif_local_time, z, rnd, nops));
+	printf("%s\tutc\tseq %.1f ns/op\trnd %.1f ns/op\n", zn,
+	       bench(zif_utc_time, z, seq, nops),
+	       bench(zif_utc_time, z, rnd, nops));
+
+	zif_close(z);
+	return 0;
+}
+
+/* tzraw_bench.c ends here */